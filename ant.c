@@ -2,8 +2,13 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
 #include "id.h"
 #include "pbserial.h"
+#include "config.h"
+#include "hist.h"
+#include "rtsched.h"
 #include "protobuf-c/data.pb-c.h"
 
 /**************************************************************************************
@@ -12,46 +17,158 @@
 #define MAX_ANT_SIZE     200
 #define MAX_CONTEXT_SIZE 100
 
+/**************************************************************************************
+* Description    : 天线采样缺省参数
+**************************************************************************************/
+#define ANT_INTERVAL_MS  200                  // 后台采样周期, 0时在请求中同步采样
+#define ANT_DEBOUNCE     3                    // 连续相同的采样次数达到该值才更新状态
+
 /**************************************************************************************
 * Description    : 定义ADC路径
 **************************************************************************************/
 static char *adcm_path = "/sys/devices/qpnp-vadc-8/mpp4_vadc";
 static char *adca_path = "/sys/devices/qpnp-vadc-8/mpp6_vadc";
 
+/**************************************************************************************
+* Description    : 天线状态, 与上报的字符串对应
+**************************************************************************************/
+enum {
+	ANT_UNKNOWN = 0,
+	ANT_OPEN,
+	ANT_OK,
+	ANT_SHORT,
+};
+
+static char *ant_names[] = {
+	[ANT_UNKNOWN] = "unknown",
+	[ANT_OPEN]    = "open",
+	[ANT_OK]      = "ok",
+	[ANT_SHORT]   = "short",
+};
+
+/**************************************************************************************
+* Description    : 一路ADC, 文件一直打开, 每次从偏移0读取(sysfs重新转换)
+**************************************************************************************/
+struct ant_adc {
+	char *path;                               // ADC状态路径
+	int fd;                                   // 打开的ADC文件, 打开失败为-1
+	int state;                                // 去抖后的状态, 采样线程写, 接收线程读
+	int pending;                              // 待确认的状态
+	int count;                                // 待确认状态连续出现的次数
+};
+
+/**************************************************************************************
+* Description    : 天线检测, 后台线程按周期采样, IOC__GET直接使用缓存的状态
+**************************************************************************************/
+static struct ant_detect {
+	int inited;                               // 采样线程已启动
+	int interval_ms;                          // 采样周期
+	int debounce;                             // 去抖次数
+	pthread_t tid;                            // 采样线程
+	struct ant_adc adc[2];                    // 0:M主天线, 1:A副天线
+	struct hist sample_time;                  // 两路采样耗时
+} ant_det = {
+	.adc = {
+		{ .fd = -1 },
+		{ .fd = -1 },
+	},
+};
+
 /**************************************************************************************
  * * FunctionName   : vadc_get()
- * * Description    : 获取ADC数据
- * * EntryParameter : path,ADC状态路径
- * * ReturnValue    : 返回结果
+ * * Description    : 获取ADC数据, 文件未打开时重新打开
+ * * EntryParameter : adc,ADC通道
+ * * ReturnValue    : 返回天线状态
  * **************************************************************************************/
-static char *vadc_get(char *path)
+static int vadc_get(struct ant_adc *adc)
 {
-	int fd;
 	int count;
 	int value = 0;
 	char buffer[40];
+	char *p;
+
+	if(unlikely(adc->fd < 0)) {
+		adc->fd = open(adc->path, O_RDONLY | O_CLOEXEC);
+		if(adc->fd < 0) return ANT_UNKNOWN;
+	}
 
-	if((fd = open(path, O_RDONLY)) < 0) {
-		return "unknown";
+	count = pread(adc->fd, buffer, sizeof(buffer) - 1, 0);
+	if(unlikely(count <= 0)) {
+		// 读取失败时关闭, 下次采样重新打开
+		close(adc->fd);
+		adc->fd = -1;
+		return ANT_UNKNOWN;
 	}
-	memset(buffer, 0, 40);
-	count = read(fd, buffer, 40);
-	close(fd);
+	buffer[count] = '\0';
 
-	if(count <= 0) return "unknown";
-	value = atoi(strchr(buffer, ':') + 1);
+	p = strchr(buffer, ':');
+	if(unlikely(p == NULL)) return ANT_UNKNOWN;
+	value = atoi(p + 1);
 
 	// 电压大于2V为open， 0.9v到2v之间为天线在位，否则为短路
-	if(value > 2000000) return "open";
-	else if(value > 900000) return "ok";
-	else return "short";
+	if(value > 2000000) return ANT_OPEN;
+	else if(value > 900000) return ANT_OK;
+	else return ANT_SHORT;
+}
+
+/**************************************************************************************
+ * * FunctionName   : vadc_debounce()
+ * * Description    : 采样一次并去抖, 连续debounce次相同时更新缓存的状态
+ * * EntryParameter : adc,ADC通道, debounce,去抖次数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void vadc_debounce(struct ant_adc *adc, int debounce)
+{
+	int state = vadc_get(adc);
+
+	if(state != adc->pending) {
+		adc->pending = state;
+		adc->count = 0;
+	}
+	if(adc->count < debounce) adc->count++;
+
+	if(adc->count >= debounce && adc->state != state) {
+		DEBUG("ant %s %s -> %s\n", adc->path, ant_names[adc->state], ant_names[state]);
+		__atomic_store_n(&adc->state, state, __ATOMIC_RELAXED);
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : ant_tasklet()
+ * * Description    : 天线采样线程, 按绝对时间周期采样两路ADC
+ * * EntryParameter : arg,天线检测
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void *ant_tasklet(void *arg)
+{
+	int i;
+	uint64_t start;
+	struct timespec next;
+	struct ant_detect *det = (struct ant_detect *)arg;
 
-	return "unknown";
+	// 缺省ant_priority=0, 保持sched_thread_attr()设置的SCHED_OTHER, 不使用实时调度
+	sched_apply("ant");
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (1) {
+		// 1.按周期睡眠, 采样耗时不累积到周期中
+		next.tv_nsec += det->interval_ms % 1000 * 1000000L;
+		next.tv_sec += det->interval_ms / 1000 + next.tv_nsec / 1000000000L;
+		next.tv_nsec %= 1000000000L;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+
+		// 2.采样并去抖
+		start = monotonic_us();
+		for (i = 0; i < 2; i++) vadc_debounce(&det->adc[i], det->debounce);
+		hist_add(&det->sample_time, monotonic_us() - start);
+	}
+
+	return NULL;
 }
 
 /**************************************************************************************
  * * FunctionName   : handle_ant_data()
- * * Description    : 读取天线检测数据
+ * * Description    : 上报天线检测数据, 后台采样时使用缓存的状态
  * * EntryParameter : fd, 串口句柄
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
@@ -67,30 +184,34 @@ static int handle_ant_data(int fd)
 	msg.n_subdata = 1;
 	msg.subdata = &pdata;
 
-	// 2.获取M 主天线数据
-	ant.ant_m = vadc_get(adcm_path);
-	// 3.获取A 负天线数据
-	ant.ant_a = vadc_get(adca_path);
+	// 2.获取M 主天线和A 副天线数据, 没有采样线程时同步采样
+	if(likely(ant_det.inited)) {
+		ant.ant_m = ant_names[__atomic_load_n(&ant_det.adc[0].state, __ATOMIC_RELAXED)];
+		ant.ant_a = ant_names[__atomic_load_n(&ant_det.adc[1].state, __ATOMIC_RELAXED)];
+	} else {
+		ant.ant_m = ant_names[vadc_get(&ant_det.adc[0])];
+		ant.ant_a = ant_names[vadc_get(&ant_det.adc[1])];
+	}
 
 	DEBUG("Sample ant a:%s ant m:%s\n", ant.ant_a, ant.ant_m)
 	msg.subdata->len = ant__get_packed_size(&ant);
 	msg.subdata->data = (uint8_t *)oob;
 
-	// 4.打包获取的数据
+	// 3.打包获取的数据
 	ant__pack(&ant, msg.subdata->data);
 	subid__pack(&msg, (uint8_t *)buffer);
 
-	// 5.发送数据
+	// 4.发送数据
 	return packages_send(fd, ANT_ID, buffer, subid__get_packed_size(&msg));
 }
 
 /**************************************************************************************
  * * FunctionName   : ant_handler()
  * * Description    : 天线数据处理函数
- * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度
+ * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度, rx_us,接收时间
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int ant_handler(int fd, char *data, int len)
+static int ant_handler(int fd, char *data, int len, uint64_t rx_us)
 {
 	Subid *msg = NULL;
 
@@ -104,5 +225,72 @@ static int ant_handler(int fd, char *data, int len)
 	subid__free_unpacked(msg, NULL);
 }
 
+/**************************************************************************************
+ * * FunctionName   : ant_init()
+ * * Description    : 打开ADC并同步采样一次作为初始状态, 启动后台采样线程
+ * * EntryParameter : fd, 串口句柄
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static int ant_init(int fd)
+{
+	int i;
+	pthread_attr_t attr;
+
+	// 1.读取配置
+	ant_det.interval_ms = config_get_int("ANT", "interval_ms", ANT_INTERVAL_MS);
+	ant_det.debounce = config_get_int("ANT", "debounce", ANT_DEBOUNCE);
+	if(ant_det.debounce < 1) ant_det.debounce = 1;
+
+	// 2.打开ADC, 第一次采样直接作为初始状态, 打开失败时采样中重试
+	ant_det.adc[0].path = adcm_path;
+	ant_det.adc[1].path = adca_path;
+	for (i = 0; i < 2; i++) {
+		ant_det.adc[i].state = vadc_get(&ant_det.adc[i]);
+		ant_det.adc[i].pending = ant_det.adc[i].state;
+		ant_det.adc[i].count = ant_det.debounce;
+		if(ant_det.adc[i].fd < 0) {
+			syslog(LOG_WARNING, "ant open %s failed: %s\n", ant_det.adc[i].path, strerror(errno));
+		}
+	}
+	if(ant_det.interval_ms <= 0) return 0;
+
+	// 3.启动采样线程(SCHED_OTHER, 不继承rx线程的实时调度), 失败时退回到请求中同步采样
+	hist_init(&ant_det.sample_time, "ant sample", "us", config_get_int("STATS", "interval", 60));
+	sched_thread_attr(&attr);
+	if(pthread_create(&ant_det.tid, &attr, ant_tasklet, (void *)&ant_det) != 0) {
+		syslog(LOG_ERR, "ant create sample thread failed\n");
+		pthread_attr_destroy(&attr);
+		return 0;
+	}
+	pthread_attr_destroy(&attr);
+	ant_det.inited = 1;
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : ant_deinit()
+ * * Description    : 结束采样线程, 关闭ADC
+ * * EntryParameter : fd, 串口句柄
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static int ant_deinit(int fd)
+{
+	int i;
+	void *ret;
+
+	if(ant_det.inited) {
+		pthread_cancel(ant_det.tid);
+		pthread_join(ant_det.tid, &ret);
+		ant_det.inited = 0;
+	}
+	for (i = 0; i < 2; i++) {
+		if(ant_det.adc[i].fd >= 0) close(ant_det.adc[i].fd);
+		ant_det.adc[i].fd = -1;
+	}
+
+	return 0;
+}
+
 // 注册ID
-register_id(ANT_ID, NULL, NULL, ant_handler);
+register_id(ANT_ID, ant_init, ant_deinit, ant_handler);
@@ -124,10 +124,10 @@ static int write_antchg_data(ProtobufCBinaryData *data, int n_data)
 /**************************************************************************************
  * * FunctionName   : antchg_handler()
  * * Description    : 天线切换处理函数
- * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度
+ * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度, rx_us,接收时间
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int antchg_handler(int fd, char *data, int len)
+static int antchg_handler(int fd, char *data, int len, uint64_t rx_us)
 {
 	Subid *msg = NULL;
 
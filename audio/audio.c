@@ -3,13 +3,25 @@
 #include "pbserial.h"
 #include "iav2hp.h"
 #include "minmea.h"
-#include "ql_oe.h"
-#include "list.h"
+#include "ring.h"
+#include "hist.h"
+#include "config.h"
+#include "rtsched.h"
+#include "audio_codec.h"
+#include "jitter.h"
+#include "audio_clock.h"
+#include "audio_hal.h"
+#include "audio_dsp.h"
+#include "mixer.h"
+#include "resample.h"
 #include <time.h>
+#include <limits.h>
 #include <memory.h>
+#include <errno.h>
+#include <unistd.h>
 #include <pthread.h>
-#include <speex/speex_echo.h>
-#include "speex/speex_preprocess.h"
+#include <semaphore.h>
+#include <sys/eventfd.h>
 #include <protobuf-c/data.pb-c.h>
 
 /**************************************************************************************
@@ -18,17 +30,76 @@
 #define MAX_AUDIO_SIZE                  200
 #define MAX_CONTEXT_SIZE                100
 #define MIN_TRANSFER_SIZE               8000
-#define ECHO_TAIL                       2400         // cancel 300ms
-#define EC20_SAMPLE_PER_20MS            (8000/50)    // 每20ms一帧数据（每20ms采样个数）
+#define AUDIO_MAX_SAMPLES               (16000/50)   // 每20ms一帧的最大采样数(16k)
 #define EC20_SAMPLE_BITS                2            // 采样位宽
+#define PLAY_FRAMES                     512          // 播放队列缺省帧数(约10s)
+#define DSP_FRAMES                      16           // 待处理的采集帧队列长度
+#define TX_FRAMES                       64           // 待发送的处理后帧队列长度
+#define JITTER_MIN_MS                   40           // 抖动缓冲缺省最小延迟
+#define JITTER_MAX_MS                   400          // 抖动缓冲缺省最大延迟
+#define AUDIO_STREAMS                   4            // 最多同时播放的下行语音路数
+#define AUDIO_DUCK_DB                   -18          // 低优先级语音被压低的缺省电平
+// 发送缓冲区在录音数据之前预留传输头部和protobuf头部(Subid.id, Subid.subdata, Audio.record, Audio.data),
+// 之后预留Audio.codec, 打包时直接在录音数据前后写入, 不再分配和复制
+#define AUDIO_TX_HEADROOM               (sizeof(struct transport) + 4 * (1 + PB_VARINT_MAX))
+#define AUDIO_TX_TAILROOM               (1 + PB_VARINT_MAX)
 
 /**************************************************************************************
-* Description    : 定义语音音频数据块结构
+* Description    : 流水线中20ms帧的标记
 **************************************************************************************/
-struct speak_v {
-	int len;                                // 当前块音频数据长度
-	char *data;                             // 当期快音频数据内容
-	struct list_head list;                  // 链表头
+#define AUDIO_FRAME_PLAY                0x01         // 采集时正在播放, ref为同时播放的数据
+#define AUDIO_FRAME_SILENCE             0x02         // VAD判断为噪音或者静音
+#define AUDIO_FRAME_FLUSH               0x04         // 录音状态切换, 发送缓冲区中剩余的录音
+
+/**************************************************************************************
+* Description    : 流水线各级之间传递的20ms帧, I/O线程 -> DSP线程 -> 发送线程
+**************************************************************************************/
+struct audio_frame {
+	int record;                               // 采集时的录音状态CODEC__xxx
+	int flags;                                // 帧标记AUDIO_FRAME_xxx
+	int len;                                  // 录音数据长度(字节)
+	uint64_t ts;                              // 采集时间(monotonic_us)
+	spx_int16_t pcm[AUDIO_MAX_SAMPLES];       // 录音数据, DSP处理后为链路采样率的处理结果
+	spx_int16_t ref[AUDIO_MAX_SAMPLES];       // 回声参考, 采集时播放的数据
+};
+
+/**************************************************************************************
+* Description    : 播放队列中的20ms帧, 压缩数据由I/O线程在播放前解码
+**************************************************************************************/
+struct play_frame {
+	uint64_t rx_us;                           // 所在消息的接收时间
+	int codec;                                // 数据编码方式CODEC__xxx
+	int len;                                  // 数据长度
+	uint8_t data[0];                          // 一帧PCM或者一帧编码数据
+};
+
+/**************************************************************************************
+* Description    : 一路下行语音, 各路独立排队, 抖动缓冲和解码, 由I/O线程按增益混音后播放
+*                  同一路内的语音依次播放, 不同路的语音同时播放, 如导航提示叠加在提示音上
+**************************************************************************************/
+struct audio_stream {
+	struct ring play;                         // 待播放的20ms帧, RX线程写, 音频线程读
+	unsigned long play_drops;                 // 播放队列满丢弃的帧数, 只由RX线程修改
+	struct audio_decoder dec;                 // 下行解码器, 只由I/O线程使用
+	struct jitter jb;                         // 下行抖动缓冲, 只由I/O线程使用
+	struct resampler rs;                      // 链路采样率转换为codec采样率, 只由I/O线程使用
+	int gain;                                 // Q15音量, 只由RX线程修改
+	int priority;                             // 优先级, 大的压低小的, 只由RX线程修改
+	int duck;                                 // 当前压低增益(Q15), 只由I/O线程修改
+};
+
+/**************************************************************************************
+* Description    : 发送线程的打包状态, 只在发送线程中使用
+**************************************************************************************/
+struct audio_tx {
+	int record;                               // 缓冲区中录音的录音状态CODEC__xxx
+	int codec;                                // 缓冲区中录音的编码方式CODEC__xxx
+	int frames;                               // 缓冲区中的帧数
+	int ops;                                  // 缓冲区中的数据长度
+	int silence;                              // 最后一条记录为静音记录时的位置, 否则为-1
+	uint64_t first;                           // 缓冲区中第一帧的采集时间
+	uint8_t *buf;                             // 录音数据, 指向slot中预留的头部之后
+	uint8_t slot[AUDIO_TX_HEADROOM + MIN_TRANSFER_SIZE + AUDIO_REC_HEAD + AUDIO_REC_MAXLEN + AUDIO_TX_TAILROOM];
 };
 
 /**************************************************************************************
@@ -36,240 +107,729 @@ struct speak_v {
 **************************************************************************************/
 static struct audio {
 	int fd;                                   // 发送套接字
-	int pcm;                                  // PCM句柄
+	const struct audio_hal *hal;              // 音频设备(录音和播放)
 	int inited;                               // 程序初始化状态
-	int record;                               // 录音状态 1,表示录音中， 0表示未录音
-	int frame_size;                           // pcm一帧大小
-	pthread_t tid;                            // 线程id
-	pthread_cond_t wait;                      // 线程条件
-	pthread_mutex_t lock;                     // 线程锁
-	struct list_head list;                    // 音频列表
-	SpeexEchoState *e_st;                     // 回音消除器
-	SpeexPreprocessState *d_st;               // 噪音消除器
+	int record;                               // 当前录音状态CODEC__xxx, 只由音频线程修改
+	int want;                                 // 请求的录音状态CODEC__xxx, 只由RX线程修改
+	int rate;                                 // codec采样率, 录音, 播放, 回声消除和混音使用
+	int samples;                              // codec每帧采样数
+	int frame_size;                           // codec一帧字节数
+	int link_rate;                            // 与MPU之间语音的采样率, 上行编码和下行解码使用
+	int link_samples;                         // 链路每帧采样数
+	int link_size;                            // 链路一帧字节数(原始PCM)
+	int tx_frames;                            // 每包上报的帧数
+	int dtx;                                  // 压缩编码时静音只发送帧数和舒适噪声电平
+	pthread_t tid;                            // I/O线程id, 负责录音和播放
+	pthread_t dsp_tid;                        // DSP线程id, 负责回声消除和噪声抑制
+	pthread_t tx_tid;                         // 发送线程id, 负责打包上报录音
+	int wake;                                 // 唤醒音频线程的eventfd
+	int idle;                                 // 线程空闲等待中, 有新的请求时需要唤醒
+	struct audio_clock clock;                 // I/O线程的20ms帧时钟, 空闲时停止
+	struct audio_stream stream[AUDIO_STREAMS];// 下行语音, 按消息中的stream编号区分
+	int streams;                              // 使用的路数
+	int duck_gain;                            // 低优先级语音被压低后的增益(Q15)
+	spx_int16_t mix[AUDIO_MAX_SAMPLES];       // 混音结果, 只由I/O线程使用
+	spx_int16_t conv[AUDIO_MAX_SAMPLES];      // 下行采样率转换结果, 只由I/O线程使用
+	struct hist play_fill;                    // 每播放一帧时队列中剩余的帧数, 只由音频线程修改
+	unsigned long decode_errors;              // 解码失败的帧数, 只由I/O线程修改
+	struct hist decode_time;                  // 每帧解码耗时, 只由I/O线程修改
+	struct ring dsp;                          // 采集帧, I/O线程写, DSP线程读
+	struct ring tx;                           // 处理后的帧, DSP线程写, 发送线程读
+	sem_t dsp_sem;                            // dsp队列中的帧数, 队列空时DSP线程休眠
+	sem_t tx_sem;                             // tx队列中的帧数, 队列空时发送线程休眠
+	unsigned long dsp_drops;                  // dsp队列满丢弃的帧数, 只由I/O线程修改
+	unsigned long tx_drops;                   // tx队列满丢弃的帧数, 只由DSP线程修改
+	struct hist io_time;                      // 每帧录音和播放耗时(含设备阻塞), 只由I/O线程修改
+	struct hist dsp_time;                     // 每帧回声消除和噪声抑制耗时, 只由DSP线程修改
+	struct hist tx_time;                      // 每包打包发送耗时, 只由发送线程修改
+	struct hist tx_size;                      // 每包录音数据长度, 只由发送线程修改
+	struct hist tx_latency;                   // 每包第一帧从采集到发送的延迟, 只由发送线程修改
+	struct audio_encoder enc;                 // SPEEX模式上行编码器, 只由发送线程使用
+	struct audio_dsp speex;                   // 回音消除和噪声抑制, 只由DSP线程使用
+	struct resampler up;                      // 上行codec采样率转换为链路采样率, 只由DSP线程使用
 } sound;
 
-static int sample_rate = 8000;                //采样率
-
 /**************************************************************************************
 * Description    : 函数申明
 **************************************************************************************/
-static int response_rec_data(struct audio *ad, unsigned char *data, int len);
+static int response_rec_data(struct audio *ad, int record, int codec, unsigned char *data, int len);
+
+/**************************************************************************************
+ * * FunctionName   : audio_play_idle()
+ * * Description    : 各路下行语音是否都已播放完成, 只在音频I/O线程中调用
+ * * EntryParameter : ad, 全局音频模块
+ * * ReturnValue    : 返回1表示没有待播放的语音
+ * **************************************************************************************/
+static int audio_play_idle(struct audio *ad)
+{
+	int i;
+
+	for (i = 0; i < ad->streams; i++) {
+		if(ring_used(&ad->stream[i].play) > 0 || jitter_active(&ad->stream[i].jb)) return 0;
+	}
+
+	return 1;
+}
 
 /**************************************************************************************
  * * FunctionName   : wait_a_moment()
- * * Description    : 休息一会儿
+ * * Description    : 没有录音也没有待播放的语音时休眠, 直到audio_wakeup()唤醒
  * * EntryParameter : ad, 全局音频模块
- * * ReturnValue    : 返回状态码
+ * * ReturnValue    : None
  * **************************************************************************************/
-static int wait_a_moment(struct audio *ad)
+static void wait_a_moment(struct audio *ad)
 {
-	struct timespec timeout = {0,0};
+	uint64_t n;
+
+	// 先置idle再检查请求, 与audio_wakeup()的顺序相反, 保证唤醒不会丢失
+	__atomic_store_n(&ad->idle, 1, __ATOMIC_SEQ_CST);
+	if(likely(__atomic_load_n(&ad->want, __ATOMIC_SEQ_CST) == CODEC__NONE && audio_play_idle(ad))) {
+		read(ad->wake, &n, sizeof(n));
+	}
+	__atomic_store_n(&ad->idle, 0, __ATOMIC_RELAXED);
+}
 
-	timeout.tv_sec = time(NULL) + 1;
+/**************************************************************************************
+ * * FunctionName   : audio_wakeup()
+ * * Description    : 音频线程空闲时唤醒, 不加锁不阻塞, 由RX线程在发布请求后调用
+ * * EntryParameter : ad, 全局音频模块
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static inline void audio_wakeup(struct audio *ad)
+{
+	uint64_t one = 1;
 
-	return pthread_cond_timedwait(&ad->wait, &ad->lock,&timeout);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(unlikely(__atomic_load_n(&ad->idle, __ATOMIC_RELAXED))) {
+		write(ad->wake, &one, sizeof(one));
+	}
 }
 
 /**************************************************************************************
- * * FunctionName   : insert_speak_v()
- * * Description    : 插入一个音频数据处理块， 由线程使用
- * * EntryParameter : ad,,指向音频结构,data,数据内容,len,数据内容长度
- * * ReturnValue    : 返回错误码
+ * * FunctionName   : audio_record_switch()
+ * * Description    : 切换录音状态, 录音设备只在音频线程中打开和关闭
+ * * EntryParameter : ad, 全局音频模块, record,新的录音状态
+ * * ReturnValue    : None
  * **************************************************************************************/
-static inline int insert_speak_v(struct audio *ad, char *data, int len) 
+static void audio_record_switch(struct audio *ad, int record)
 {
-	struct speak_v *inode = (struct speak_v *)malloc(sizeof(struct speak_v));
-	
-	if(unlikely(inode == NULL)) {
-		DEBUG("%s can't malloc %d!!!\n", __func__, sizeof(struct speak_v));
-		return -1;
+	// 1. 开始录音
+	if(record != CODEC__NONE && ad->record == CODEC__NONE) {
+		if(unlikely(ad->hal->record_open() < 0)) {
+			syslog(LOG_ERR, "audio %s record open failed\n", ad->hal->name);
+		}
 	}
 
-	memset(inode, 0, sizeof(struct speak_v));
-	if(likely(data && len > 0)) {
-		inode->len = len;
-		inode->data = memdup(data, len);
+	// 2. 结束录音
+	if(ad->record != CODEC__NONE && record == CODEC__NONE) {
+		ad->hal->record_close();
 	}
 
-	list_add_tail(&inode->list, &ad->list);
-	pthread_cond_signal(&ad->wait);
+	__atomic_store_n(&ad->record, record, __ATOMIC_RELEASE);
+	DEBUG("audio thread %s\n", record != CODEC__NONE ? "recording" : "idle");
+}
 
-	return 0;
+/**************************************************************************************
+ * * FunctionName   : audio_queue_drop()
+ * * Description    : 记录流水线队列满丢弃的帧, 按2的幂次输出日志, 避免持续丢帧时刷日志
+ * * EntryParameter : name,队列名字, drops,丢帧计数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static inline void audio_queue_drop(const char *name, unsigned long *drops)
+{
+	(*drops)++;
+	if(((*drops) & (*drops - 1)) == 0) {
+		syslog(LOG_WARNING, "audio %s queue full, total %lu frames dropped\n", name, *drops);
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_queue_wait()
+ * * Description    : 等待流水线队列中的帧, 队列空时休眠
+ * * EntryParameter : r,队列, sem,队列帧数信号量
+ * * ReturnValue    : 返回最早的帧
+ * **************************************************************************************/
+static struct audio_frame *audio_queue_wait(struct ring *r, sem_t *sem)
+{
+	struct audio_frame *af = NULL;
+
+	while (af == NULL) {
+		if(unlikely(sem_wait(sem) < 0)) continue;
+		af = (struct audio_frame *)ring_read_slot(r);
+	}
+
+	return af;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_play_decode()
+ * * Description    : 获取待播放帧的PCM数据, 压缩数据解码, 解码失败时播放静音
+ * * EntryParameter : ad,音频结构, st,所在的一路语音, pf,待播放帧
+ * * ReturnValue    : 返回一帧PCM
+ * **************************************************************************************/
+static spx_int16_t *audio_play_decode(struct audio *ad, struct audio_stream *st, struct play_frame *pf)
+{
+	uint64_t start = 0;
+	static spx_int16_t pcm[AUDIO_MAX_SAMPLES];
+
+	if(likely(pf->codec == CODEC__RAW)) return (spx_int16_t *)pf->data;
+
+	start = monotonic_us();
+	if(unlikely(audio_decode(&st->dec, pf->codec, pf->data, pf->len, pcm) < 0)) {
+		memset(pcm, 0x00, ad->link_size);
+		ad->decode_errors++;
+		if((ad->decode_errors & (ad->decode_errors - 1)) == 0) {
+			syslog(LOG_WARNING, "audio decode codec %d failed, total %lu frames\n", pf->codec, ad->decode_errors);
+		}
+	}
+	hist_add(&ad->decode_time, monotonic_us() - start);
+
+	return pcm;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_play_mix()
+ * * Description    : 每个20ms周期由各路的抖动缓冲决定播放队列中的帧, 补偿帧还是不播放,
+ *                    转换为codec采样率后按音量饱和相加为一帧, 有更高优先级的语音时压低其他各路
+ * * EntryParameter : ad,音频结构, now,本周期开始时间
+ * * ReturnValue    : 返回混音后的一帧, 各路都不播放时返回NULL
+ * **************************************************************************************/
+static spx_int16_t *audio_play_mix(struct audio *ad, uint64_t now)
+{
+	int i, prio, top = -1, gain, mixed = 0;
+	spx_int16_t *pcm = NULL;
+	struct play_frame *pf = NULL;
+	struct audio_stream *st = NULL;
+
+	// 1.正在播放的语音中的最高优先级
+	for (i = 0; i < ad->streams; i++) {
+		st = &ad->stream[i];
+		if(ring_used(&st->play) == 0 && !jitter_active(&st->jb)) continue;
+		prio = __atomic_load_n(&st->priority, __ATOMIC_RELAXED);
+		if(prio > top) top = prio;
+	}
+
+	// 2.各路按抖动缓冲的决定取一帧, 队列中的帧由audio_play()切分好, 压缩数据在这里解码
+	for (i = 0; i < ad->streams; i++) {
+		st = &ad->stream[i];
+		pcm = NULL;
+		pf = (struct play_frame *)ring_read_slot(&st->play);
+		switch (jitter_action(&st->jb, ring_used(&st->play), pf ? pf->rx_us : 0,
+					pf && pf->codec == CODEC__NONE, now)) {
+		case JITTER_PLAY:
+			hist_add(&ad->play_fill, ring_used(&st->play) - 1);
+			pcm = audio_play_decode(ad, st, pf);
+			jitter_played(&st->jb, pcm, pf->rx_us, now);
+			break;
+		case JITTER_SKIP:
+			ring_pop(&st->play);
+			pf = NULL;
+			break;
+		case JITTER_FILL:
+			pcm = jitter_fill(&st->jb);
+			pf = NULL;
+			break;
+		default:
+			// 不播放时清除采样率转换的历史, 下一段语音从静音开始
+			resampler_reset(&st->rs);
+			pf = NULL;
+			break;
+		}
+
+		// 3.优先级低于最高优先级的语音快速压低, 高优先级语音结束后缓慢恢复
+		st->duck = mixer_duck_step(st->duck,
+				__atomic_load_n(&st->priority, __ATOMIC_RELAXED) < top ? ad->duck_gain : MIXER_UNITY);
+		if(pcm == NULL) continue;
+
+		// 4.链路采样率与codec不同时转换
+		if(unlikely(resampler_active(&st->rs))) {
+			resampler_process(&st->rs, pcm, ad->conv);
+			pcm = ad->conv;
+		}
+
+		// 5.按音量饱和累加, 第一路累加前清零混音结果, 累加后释放队列槽位
+		gain = mixer_gain_mul(__atomic_load_n(&st->gain, __ATOMIC_RELAXED), st->duck);
+		if(mixed++ == 0) memset(ad->mix, 0x00, sizeof(ad->mix));
+		mixer_scale_add(ad->mix, pcm, gain, ad->samples);
+		if(pf != NULL) ring_pop(&st->play);
+	}
+
+	return mixed > 0 ? ad->mix : NULL;
 }
 
 /**************************************************************************************
  * * FunctionName   : alsa_sound_tasklet()
- * * Description    : 音频数据处理线程
+ * * Description    : 音频I/O线程, 每20ms播放一帧并采集一帧, 采集帧交给DSP线程处理
  * * EntryParameter : private,指向音频结构
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
 static void *alsa_sound_tasklet(void *private)
 {
-	int ops = 0;
-	int bufsize = 0;
-	int play_ops = 0;
-	char *play = NULL;
-	struct speak_v *speak = NULL;
+	int record = 0;
+	uint64_t start = 0, begin = 0, end = 0;
+	spx_int16_t *play = NULL;
+	struct audio_frame *af = NULL;
 	struct audio *ad = (struct audio *)private;
-	static char frame[MIN_TRANSFER_SIZE+1];
-	static spx_int16_t in_frame[EC20_SAMPLE_PER_20MS];
-	static spx_int16_t out_frame[EC20_SAMPLE_PER_20MS];
+	static struct audio_frame discard;
 
+	sched_apply("audio");
 	while (1) {
-		if(unlikely(!ad->inited)) {
+		// 1.同步RX线程请求的录音状态, 切换前通知发送线程发送剩余的录音
+		record = __atomic_load_n(&ad->want, __ATOMIC_ACQUIRE);
+		if(unlikely(record != ad->record)) {
+			if(ad->record != CODEC__NONE) {
+				af = (struct audio_frame *)ring_write_slot(&ad->dsp);
+				if(likely(af != NULL)) {
+					af->record = ad->record;
+					af->flags = AUDIO_FRAME_FLUSH;
+					af->len = 0;
+					ring_push(&ad->dsp);
+					sem_post(&ad->dsp_sem);
+				}
+			}
+			audio_record_switch(ad, record);
+		}
+
+		// 2.没有录音也没有待播放的语音时停止帧时钟并休眠
+		if(unlikely(ad->record == CODEC__NONE && audio_play_idle(ad))) {
+			audio_clock_stop(&ad->clock);
 			wait_a_moment(ad);
 			continue;
 		}
 
-		// 1.加锁等待
-		if(likely(!(ad->record != CODEC__NONE || !list_empty(&ad->list)))) {
-			if(likely(wait_a_moment(ad) == ETIMEDOUT)) {
-				continue;
+		// 3. 等待下一个20ms帧周期, 各路下行语音混音为本帧播放的数据
+		audio_clock_start(&ad->clock);
+		audio_clock_wait(&ad->clock);
+		start = monotonic_us();
+		begin = end = 0;
+		play = audio_play_mix(ad, start);
+
+		// 4. 获取一帧录音直接存放到DSP队列, 队列满时仍然读取录音, 保持与播放同步
+		af = NULL;
+		if(likely(ad->record != CODEC__NONE)) {
+			af = (struct audio_frame *)ring_write_slot(&ad->dsp);
+			if(unlikely(af == NULL)) af = &discard;
+
+			af->record = ad->record;
+			af->flags = 0;
+			af->ts = start;
+			begin = monotonic_us();
+			af->len = ad->hal->record_read(af->pcm);
+			end = monotonic_us();
+			if(unlikely(play != NULL)) {
+				af->flags |= AUDIO_FRAME_PLAY;
+				memcpy(af->ref, play, ad->frame_size);
 			}
 		}
 
-		// 2. 获取音频数据
-		if(!list_empty(&ad->list)) {
-			speak = list_first_entry(&ad->list, struct speak_v, list);
-			list_del(&speak->list);
+		// 5.发送一帧语音到codec
+		if(unlikely(play != NULL)) {
+			if(af == NULL) begin = monotonic_us();
+			ad->hal->play(play);
+			if(af == NULL) end = monotonic_us();
 		}
-		pthread_mutex_unlock(&ad->lock);
 
-		// 3.判断speak结构有效性， 不为NULL，表明有语音需要发送
-		if(unlikely(speak!= NULL && speak->data != NULL)) {
-			//speex_echo_state_reset(ad->e_st);
-			play = speak->data;
-			play_ops = 0;
-		}
+		// 录音时以录音为codec时钟参考, 只播放时以播放为参考, 修正帧时钟的漂移
+		audio_clock_sync(&ad->clock, begin, end);
 
-replay:
-		pthread_mutex_lock(&ad->lock);
-		// 4. 获取一帧录音,采用speex进行音频处理或者发送原始数据
-		if(likely(ad->record == CODEC__SPEEX)) {
-			bufsize = ql_voice_record_read((char *)in_frame);
-			// 4.1 回声消除
-			speex_echo_capture(ad->e_st, in_frame, out_frame);
-
-			// 4.2 噪声抑制, 当vad为0的时候，表示当前声音是噪声或者静音
-			//     当没有播放声音的时候，不进行噪音静音判断，只需要去噪声
-			if(unlikely(speex_preprocess_run(ad->d_st, out_frame))) {
-				// 4.3 将语音数据存放到发送缓冲区
-				memcpy(frame + ops , out_frame, bufsize);
-			} else if(unlikely(play != NULL && ops > 0)) {
-				// 4.3 检测到无效数据（噪音或者静音）
-				//     该数据(噪音或者静音)不发送，
-				//     为了保持时间同步，将之前接收到的声音直接发送
-				ops -= response_rec_data(ad, frame, ops);
-				ops -= bufsize;
+		// 6.录音交给DSP线程处理
+		if(likely(af != NULL && af->len > 0)) {
+			if(unlikely(af == &discard)) {
+				audio_queue_drop("dsp", &ad->dsp_drops);
 			} else {
-				// 4.3 将没有播放情况下的，静音数据改为NULL数据存放到发送缓冲区
-				memset(frame + ops , 0x00, bufsize);
+				ring_push(&ad->dsp);
+				sem_post(&ad->dsp_sem);
 			}
-			ops += bufsize;
-			//DEBUG("capture %d size\n", bufsize);
-		} else if(unlikely(ad->record == CODEC__RAW)) {
-			ops += ql_voice_record_read(frame + ops);
-			//DEBUG("capture %d size\n", bufsize);
 		}
-		pthread_mutex_unlock(&ad->lock);
+		hist_add(&ad->io_time, monotonic_us() - start);
+	}
+}
 
-		// 5.发送一帧语音到codec
-		if(unlikely(play != NULL)) {
-			Ql_AudPlayer_Play(ad->pcm, play + play_ops, ad->frame_size);
-			if(likely(ad->record == CODEC__SPEEX)) {
-				speex_echo_playback(ad->e_st, (spx_int16_t *)(play + play_ops));
+/**************************************************************************************
+ * * FunctionName   : audio_dsp_tasklet()
+ * * Description    : 音频DSP线程, SPEEX模式下对采集帧进行回声消除和噪声抑制, 结果交给发送线程
+ * * EntryParameter : private,指向音频结构
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static void *audio_dsp_tasklet(void *private)
+{
+	uint64_t start = 0;
+	spx_int16_t *src = NULL;
+	struct audio_frame *in = NULL;
+	struct audio_frame *out = NULL;
+	struct audio *ad = (struct audio *)private;
+	spx_int16_t clean[AUDIO_MAX_SAMPLES];
+
+	sched_apply("dsp");
+	while (1) {
+		// 1.等待采集帧
+		in = audio_queue_wait(&ad->dsp, &ad->dsp_sem);
+		start = monotonic_us();
+
+		// SPEEX录音结束时复位回声路径和噪声估计, 发送队列满丢弃该帧时也要复位
+		if(unlikely((in->flags & AUDIO_FRAME_FLUSH) && in->record == CODEC__SPEEX)) audio_dsp_reset(&ad->speex);
+
+		out = (struct audio_frame *)ring_write_slot(&ad->tx);
+		if(unlikely(out == NULL)) {
+			audio_queue_drop("tx", &ad->tx_drops);
+			ring_pop(&ad->dsp);
+			continue;
+		}
+		out->record = in->record;
+		out->flags = in->flags;
+		out->len = in->len;
+		out->ts = in->ts;
+
+		// 2.SPEEX模式回声消除, 参考信号是采集时同时播放的帧, 没有播放时为静音
+		//   在codec采样率上处理, 需要转换采样率时先输出到临时缓冲区
+		src = in->pcm;
+		if(likely(in->record == CODEC__SPEEX && in->len > 0)) {
+			src = resampler_active(&ad->up) ? clean : out->pcm;
+			if(!(in->flags & AUDIO_FRAME_PLAY)) memset(in->ref, 0x00, sizeof(in->ref));
+			speex_echo_cancellation(ad->speex.e_st, in->pcm, in->ref, src);
+
+			// 3.噪声抑制, 当vad为0的时候，表示当前声音是噪声或者静音, 由发送线程处理
+			if(!speex_preprocess_run(ad->speex.d_st, src)) out->flags |= AUDIO_FRAME_SILENCE;
+		}
+
+		// 4.codec采样率与链路不同时转换为链路采样率, 不足一帧的录音补静音, 录音切换时清除历史
+		if(unlikely(resampler_active(&ad->up))) {
+			if(in->len > 0) {
+				if(unlikely(in->len < ad->frame_size)) memset((char *)src + in->len, 0x00, ad->frame_size - in->len);
+				resampler_process(&ad->up, src, out->pcm);
+				out->len = ad->link_size;
+			} else if(in->flags & AUDIO_FRAME_FLUSH) {
+				resampler_reset(&ad->up);
 			}
-			play_ops += ad->frame_size;
-			//DEBUG("play:%d(%d) size\n", ad->frame_size, play_ops);
+		} else if(src != out->pcm && in->len > 0) {
+			memcpy(out->pcm, src, in->len);
+		}
+		ring_pop(&ad->dsp);
+
+		// 5.交给发送线程
+		ring_push(&ad->tx);
+		sem_post(&ad->tx_sem);
+		hist_add(&ad->dsp_time, monotonic_us() - start);
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_tx_send()
+ * * Description    : 上报缓冲区中的录音, 记录打包耗时和采集到发送的延迟
+ * * EntryParameter : ad,音频结构, tx,打包状态
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void audio_tx_send(struct audio *ad, struct audio_tx *tx)
+{
+	uint64_t start = monotonic_us();
+
+	response_rec_data(ad, tx->record, tx->codec, tx->buf, tx->ops);
+	hist_add(&ad->tx_time, monotonic_us() - start);
+	hist_add(&ad->tx_latency, monotonic_us() - tx->first);
+	hist_add(&ad->tx_size, tx->ops);
+	tx->ops = 0;
+	tx->frames = 0;
+	tx->silence = -1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_tx_append()
+ * * Description    : 一帧录音存放到发送缓冲区, 压缩编码时每帧一条记录, 包内总是完整的帧
+ * * EntryParameter : ad,音频结构, tx,打包状态, af,处理后的帧
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void audio_tx_append(struct audio *ad, struct audio_tx *tx, struct audio_frame *af)
+{
+	int n = 0;
+
+	// 1.原始数据直接存放
+	if(tx->codec == CODEC__RAW) {
+		memcpy(tx->buf + tx->ops, af->pcm, af->len);
+		tx->ops += af->len;
+	} else {
+		// 2.编码器每次处理完整的一帧, 不足一帧的录音补静音
+		if(unlikely(af->len < ad->link_size)) {
+			memset((char *)af->pcm + af->len, 0x00, ad->link_size - af->len);
 		}
+		n = audio_encode(&ad->enc, af->pcm, tx->buf + tx->ops + AUDIO_REC_HEAD, AUDIO_REC_MAXLEN);
+		if(unlikely(n < 0)) return;
+
+		tx->buf[tx->ops] = AUDIO_REC_VOICE;
+		tx->buf[tx->ops + 1] = n;
+		tx->ops += AUDIO_REC_HEAD + n;
+	}
+
+	tx->silence = -1;
+	if(tx->frames++ == 0) tx->first = af->ts;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_tx_silence()
+ * * Description    : 一帧静音存放到发送缓冲区, 连续的静音合并为一条记录, 只有帧数和舒适噪声电平
+ * * EntryParameter : ad,音频结构, tx,打包状态, af,处理后的帧
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void audio_tx_silence(struct audio *ad, struct audio_tx *tx, struct audio_frame *af)
+{
+	int count = 0;
+	uint8_t *rec = NULL;
+	int level = audio_cng_level(af->pcm, af->len / EC20_SAMPLE_BITS);
+
+	if(likely(tx->silence >= 0)) {
+		// 1.接着上一条静音记录计数, 电平取平均
+		rec = tx->buf + tx->silence + AUDIO_REC_HEAD;
+		count = (rec[0] | rec[1] << 8) + 1;
+		rec[0] = count & 0xff;
+		rec[1] = (count >> 8) & 0xff;
+		rec[2] = (rec[2] * (count - 1) + level) / count;
+	} else {
+		// 2.新的静音记录
+		tx->silence = tx->ops;
+		rec = tx->buf + tx->ops;
+		rec[0] = AUDIO_REC_SILENCE;
+		rec[1] = AUDIO_REC_SILENCE_LEN;
+		rec[2] = 1;
+		rec[3] = 0;
+		rec[4] = level;
+		tx->ops += AUDIO_REC_HEAD + AUDIO_REC_SILENCE_LEN;
+	}
+
+	if(tx->frames++ == 0) tx->first = af->ts;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_tx_tasklet()
+ * * Description    : 音频发送线程, 按VAD结果缓存处理后的帧, 满tx_frames帧后上报
+ *                    SPEEX模式按配置的上行编码方式压缩, RAW模式上报原始数据
+ * * EntryParameter : private,指向音频结构
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static void *audio_tx_tasklet(void *private)
+{
+	struct audio_frame *af = NULL;
+	struct audio *ad = (struct audio *)private;
+	static struct audio_tx tx = {.record = CODEC__NONE, .codec = CODEC__RAW, .silence = -1};
+
+	sched_apply("tx");
+	tx.buf = tx.slot + AUDIO_TX_HEADROOM;
+	while (1) {
+		// 1.等待处理后的帧
+		af = audio_queue_wait(&ad->tx, &ad->tx_sem);
 
-		// 6.满足条件，上报录音
-		if(unlikely(ops >= MIN_TRANSFER_SIZE)) {
-			//DEBUG("transfer %d size\n", ops);
-			ops -= response_rec_data(ad, frame, ops);
+		// 2.录音状态切换时发送剩余的录音, 不同状态的录音不合并到一包
+		if(unlikely(tx.ops > 0 && (af->record != tx.record || (af->flags & AUDIO_FRAME_FLUSH)))) {
+			audio_tx_send(ad, &tx);
+		}
+		if(unlikely(af->record != tx.record)) {
+			tx.record = af->record;
+			tx.codec = af->record == CODEC__SPEEX ? ad->enc.codec : CODEC__RAW;
+			audio_encoder_reset(&ad->enc);
 		}
 
-		// 7.判断语音是否发送完成，还有语音未发送到codec， 到replay继续发送
-		if(unlikely(speak != NULL && play_ops < speak->len)) {
-			goto replay;
+		// 3.检测到无效数据（噪音或者静音）
+		if(unlikely(af->flags & AUDIO_FRAME_FLUSH)) {
+			// 3.1 录音结束标记, 没有录音数据
+		} else if(unlikely(af->flags & AUDIO_FRAME_SILENCE)) {
+			if(ad->dtx && tx.codec != CODEC__RAW) {
+				// 3.2 不连续发送: 播放中语音结束时先发送之前的语音,
+				//     静音不编码, 只发送帧数和舒适噪声电平, 由接收端恢复时间线
+				if((af->flags & AUDIO_FRAME_PLAY) && tx.ops > 0 && tx.silence < 0) {
+					audio_tx_send(ad, &tx);
+				}
+				audio_tx_silence(ad, &tx, af);
+			} else if((af->flags & AUDIO_FRAME_PLAY) && tx.ops > 0) {
+				// 3.3 播放中的噪音或者静音不发送，
+				//     为了保持时间同步，将之前接收到的声音直接发送
+				audio_tx_send(ad, &tx);
+			} else {
+				// 3.4 将没有播放情况下的，静音数据改为NULL数据存放到发送缓冲区
+				memset(af->pcm, 0x00, af->len);
+				audio_tx_append(ad, &tx, af);
+			}
+		} else {
+			// 3.5 将语音数据存放到发送缓冲区
+			audio_tx_append(ad, &tx, af);
 		}
+		ring_pop(&ad->tx);
 
-		// 8.经过7后，如果speak不为NULL,则需要释放内存
-		if(unlikely(speak != NULL)) {
-			free(speak->data);
-			free(speak);
+		// 4.满足条件，上报录音
+		if(unlikely(tx.frames >= ad->tx_frames)) {
+			audio_tx_send(ad, &tx);
 		}
-		play = NULL;
-		speak = NULL;
 	}
 }
 
 /*************************************************************************************** 
  * * FunctionName   : response_rec_data()
- * * Description    : 音频数据发送
- * * EntryParameter : ad,音频结构, data,指向录音数据,len，指向数据长度
+ * * Description    : 音频数据发送, 在录音数据前后预留的空间中直接写入protobuf和传输头部, 不分配不复制
+ *                    字段顺序与protobuf-c相同: Subid{id, subdata[0] = Audio{record, data, codec}}
+ * * EntryParameter : ad,音频结构, record,录音状态, codec,数据编码方式,
+ *                    data,指向录音数据(之前预留AUDIO_TX_HEADROOM, 之后预留AUDIO_TX_TAILROOM), len，指向数据长度
  * * ReturnValue    : 返回发送数据长度
  * **************************************************************************************/
-static int response_rec_data(struct audio *ad, unsigned char *data, int len)
+static int response_rec_data(struct audio *ad, int record, int codec, unsigned char *data, int len)
 {
-	int msglen = 0;
-	char *buffer = NULL;
-	Subid msg  = SUBID__INIT;
-	Audio message = AUDIO__INIT;
-	ProtobufCBinaryData pdata;
-
-	// 1.初始化Protobuf数据
-	msg.id = IOC__DATA;
-	msg.n_subdata = 1;
-	msg.subdata = &pdata;
-
-	// 2.打包音频数据
-	message.record = ad->record;
-	message.has_data = 1;
-	message.data.data = data;
-	message.data.len = len;
-
-	// 3.打包子ID
-	msg.subdata->len = audio__get_packed_size(&message);
-	msg.subdata->data = malloc(msg.subdata->len);;
-
-	// 4.打包获取的数据
-	audio__pack(&message, msg.subdata->data);
-
-	msglen = subid__get_packed_size(&msg);
-	buffer = (char *)malloc(msglen);
-	subid__pack(&msg, (uint8_t *)buffer);
+	int tail = 0;
+	int alen = 0, slen = 0;
+	uint8_t *payload = NULL;
+	uint8_t audio[2 * (1 + PB_VARINT_MAX)];
+	uint8_t subid[2 * (1 + PB_VARINT_MAX)];
+
+	// 1.编码方式在录音数据之后, 原始PCM不带编码方式, 与旧版本MPU兼容
+	if(codec != CODEC__RAW) {
+		data[len] = PB_KEY(3, PB_WIRE_VARINT);
+		tail = 1 + pack_varint(codec, data + len + 1);
+	}
 
-	// 5.发送数据
-	packages_send(ad->fd, AUDIO_ID, buffer, msglen);
+	// 2.Audio中录音数据之前的字段: record, data的长度
+	audio[alen++] = PB_KEY(1, PB_WIRE_VARINT);
+	alen += pack_varint(record, audio + alen);
+	audio[alen++] = PB_KEY(2, PB_WIRE_BYTES);
+	alen += pack_varint(len, audio + alen);
+
+	// 3.Subid中Audio之前的字段: id, subdata[0]的长度
+	subid[slen++] = PB_KEY(1, PB_WIRE_VARINT);
+	slen += pack_varint(IOC__DATA, subid + slen);
+	subid[slen++] = PB_KEY(2, PB_WIRE_BYTES);
+	slen += pack_varint(alen + len + tail, subid + slen);
 
-	free(msg.subdata->data);
-	free(buffer);
+	// 4.头部写入录音数据之前, 传输头部由packages_send_inplace()填写
+	payload = data - alen - slen;
+	memcpy(payload, subid, slen);
+	memcpy(payload + slen, audio, alen);
+
+	// 5.发送数据
+	packages_send_inplace(ad->fd, AUDIO_ID, (struct transport *)(payload - sizeof(struct transport)),
+			slen + alen + len + tail);
 
 	return len;
 }
 
+/**************************************************************************************
+ * * FunctionName   : audio_play_frame()
+ * * Description    : 一帧数据写入播放队列, PCM不足一帧的部分补静音
+ * * EntryParameter : ad,音频结构，st,一路语音, codec,编码方式, data,一帧数据, len,数据长度, rx_us,接收时间
+ * * ReturnValue    : 成功返回0, 队列满返回-1
+ * **************************************************************************************/
+static inline int audio_play_frame(struct audio *ad, struct audio_stream *st, int codec, const uint8_t *data, int len, uint64_t rx_us)
+{
+	struct play_frame *pf = (struct play_frame *)ring_write_slot(&st->play);
+
+	if(unlikely(pf == NULL)) return -1;
+
+	pf->rx_us = rx_us;
+	pf->codec = codec;
+	pf->len = len;
+	memcpy(pf->data, data, len);
+	if(codec == CODEC__RAW && len < ad->link_size) {
+		memset(pf->data + len, 0x00, ad->link_size - len);
+		pf->len = ad->link_size;
+	}
+	ring_push(&st->play);
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_stream_select()
+ * * Description    : 按消息中的stream编号选择一路语音, 消息带音量或者优先级时更新, 之后保持不变
+ * * EntryParameter : ad,音频结构，audio,下行消息
+ * * ReturnValue    : 返回一路语音, 编号超出配置的路数时返回NULL
+ * **************************************************************************************/
+static struct audio_stream *audio_stream_select(struct audio *ad, Audio *audio)
+{
+	struct audio_stream *st = NULL;
+
+	// stream为uint32, 先按无符号比较再转换, 避免大于INT_MAX时变为负数越界
+	if(unlikely(audio->has_stream && audio->stream >= (uint32_t)ad->streams)) {
+		syslog(LOG_WARNING, "audio stream %u not configured, %d streams\n", audio->stream, ad->streams);
+		return NULL;
+	}
+	st = &ad->stream[audio->has_stream ? audio->stream : 0];
+
+	// 音量为百分比, 转换为Q15增益
+	if(audio->has_gain) {
+		__atomic_store_n(&st->gain, (audio->gain >= 100 ? 100 : audio->gain) * MIXER_UNITY / 100, __ATOMIC_RELAXED);
+	}
+	if(audio->has_priority) {
+		// priority为uint32, 超过INT_MAX时限制为INT_MAX, 不能变为负数被压低
+		__atomic_store_n(&st->priority, audio->priority > INT_MAX ? INT_MAX : (int)audio->priority, __ATOMIC_RELAXED);
+	}
+
+	return st;
+}
+
 /**************************************************************************************
  * * FunctionName   : audio_play()
- * * Description    : 处理音频数据
- * * EntryParameter : ad,音频结构，data，指向数据， n_data,数据个数
+ * * Description    : 处理音频数据, 原始PCM按20ms切分, 压缩数据按帧记录切分, 由线程解码播放
+ * * EntryParameter : ad,音频结构，data，指向数据， n_data,数据个数, rx_us,接收时间
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int audio_play(struct audio *ad, ProtobufCBinaryData *data, int n_data)
+static int audio_play(struct audio *ad, ProtobufCBinaryData *data, int n_data, uint64_t rx_us)
 {
-	int  i;
+	int  i, k, ops, len;
+	int count = 0;
+	int drops = 0;
+	int codec = CODEC__RAW;
+	uint8_t *rec = NULL;
 	Audio *audio = NULL;
+	struct audio_stream *st = NULL;
 
-	// 1.音频数据发送到线程链表，由线程处理
 	for (i = 0; i < n_data; i++) {
 		audio = audio__unpack(NULL, data[i].len, data[i].data);
-		if(unlikely(audio == NULL || audio->has_data != 1)) continue;
-
-		insert_speak_v(ad, audio->data.data, audio->data.len);
+		if(unlikely(audio == NULL)) continue;
+		st = audio_stream_select(ad, audio);
+		if(unlikely(st == NULL || audio->has_data != 1)) goto next;
+		drops = 0;
+
+		codec = audio->has_codec ? audio->codec : CODEC__RAW;
+		if(likely(codec == CODEC__RAW)) {
+			// 1.原始PCM按20ms切分后写入播放队列，最后不足一帧的部分补静音
+			for (ops = 0; ops < audio->data.len; ops += ad->link_size) {
+				len = audio->data.len - ops;
+				if(likely(len > ad->link_size)) len = ad->link_size;
+				if(unlikely(audio_play_frame(ad, st, codec, audio->data.data + ops, len, rx_us) < 0)) drops++;
+			}
+		} else if(codec == CODEC__SPEEX || codec == CODEC__ADPCM) {
+			// 2.压缩数据每条记录一帧, 记录不完整时丢弃剩余数据
+			for (ops = 0; ops + AUDIO_REC_HEAD <= audio->data.len; ops += AUDIO_REC_HEAD + len) {
+				rec = audio->data.data + ops;
+				len = rec[1];
+				if(unlikely(ops + AUDIO_REC_HEAD + len > audio->data.len)) {
+					syslog(LOG_WARNING, "audio record truncated at %d/%d\n", ops, (int)audio->data.len);
+					break;
+				}
+				if(rec[0] == AUDIO_REC_SILENCE && len >= AUDIO_REC_SILENCE_LEN) {
+					// 2.1 连续静音恢复为相同帧数的舒适噪声, 保持时间线
+					count = rec[2] | rec[3] << 8;
+					for (k = 0; k < count; k++) {
+						if(unlikely(audio_play_frame(ad, st, CODEC__NONE, rec + AUDIO_REC_HEAD + 2, 1, rx_us) < 0)) {
+							drops += count - k;
+							break;
+						}
+					}
+					continue;
+				}
+				if(unlikely(rec[0] != AUDIO_REC_VOICE)) continue;
+				if(unlikely(audio_play_frame(ad, st, codec, rec + AUDIO_REC_HEAD, len, rx_us) < 0)) drops++;
+			}
+		} else {
+			syslog(LOG_WARNING, "audio codec %d not supported\n", codec);
+		}
 
+		// 3.队列满时丢弃新数据, 已排队的语音保持连续
+		if(unlikely(drops > 0)) {
+			st->play_drops += drops;
+			syslog(LOG_WARNING, "audio play queue %d full, %d frames dropped, total %lu\n",
+					(int)(st - ad->stream), drops, st->play_drops);
+		}
+next:
 		audio__free_unpacked(audio, NULL);
 	}
 
+	// 4.线程空闲时唤醒, 线程运行中会自己从队列取数据
+	audio_wakeup(ad);
+
 	return 0;
 }
 
@@ -281,34 +841,17 @@ static int audio_play(struct audio *ad, ProtobufCBinaryData *data, int n_data)
  * **************************************************************************************/
 static int set_record_state(struct audio *ad, ProtobufCBinaryData *data, int n_data)
 {
-	int  i;
-	void *ret;
 	Audio *audio = NULL;
 
 	audio = audio__unpack(NULL, data[0].len, data[0].data);
 	if(unlikely(audio == NULL)) return -1;
 
-	DEBUG("set record:%d, current state:%s\n",
-			audio->record, ad->record != CODEC__NONE?"recording":"idle");
+	DEBUG("set record:%d, current state:%s\n", audio->record,
+			__atomic_load_n(&ad->record, __ATOMIC_RELAXED) != CODEC__NONE ? "recording" : "idle");
 
-	// 1. 开始录音
-	pthread_mutex_lock(&ad->lock);
-	if(audio->record != CODEC__NONE && ad->record == CODEC__NONE) {
-		ad->record = audio->record;
-		ql_voice_record_dev_set(AUD_DOWN_LINK);
-		ql_voice_record_open(QUEC_PCM_8K, QUEC_PCM_MONO);
-	}
-
-	// 2. 结束录音
-	if(ad->record != CODEC__NONE && audio->record == CODEC__NONE) {
-		ad->record = audio->record;
-		ql_voice_record_close();
-		ql_voice_record_dev_clear(AUD_DOWN_LINK);
-	}
-	pthread_mutex_unlock(&ad->lock);
-
-	DEBUG("wakeup thread to %s\n",ad->record != CODEC__NONE?"recording":"idle");
-	pthread_cond_signal(&ad->wait);
+	// 1.发布录音状态, 由音频线程在下一帧开始前打开或关闭录音设备
+	__atomic_store_n(&ad->want, audio->record, __ATOMIC_RELEASE);
+	audio_wakeup(ad);
 	audio__free_unpacked(audio, NULL);
 
 	return 0;
@@ -317,10 +860,10 @@ static int set_record_state(struct audio *ad, ProtobufCBinaryData *data, int n_d
 /**************************************************************************************
  * * FunctionName   : audio_handler()
  * * Description    : audio数据处理函数
- * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度
+ * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度, rx_us,接收时间
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int audio_handler(int fd, char *data, int len)
+static int audio_handler(int fd, char *data, int len, uint64_t rx_us)
 {
 	Subid *msg = NULL;
 
@@ -330,7 +873,7 @@ static int audio_handler(int fd, char *data, int len)
 	switch (msg->id) {
 	case IOC__SET: set_record_state(&sound, msg->subdata, msg->n_subdata);
 		break;
-	case IOC__DATA: audio_play(&sound, msg->subdata, msg->n_subdata);
+	case IOC__DATA: audio_play(&sound, msg->subdata, msg->n_subdata, rx_us);
 		break;
 	}
 	subid__free_unpacked(msg, NULL);
@@ -338,6 +881,24 @@ static int audio_handler(int fd, char *data, int len)
 	return 0;
 }
 
+/**************************************************************************************
+ * * FunctionName   : audio_config_rate()
+ * * Description    : 读取采样率配置, 支持8000和16000(移远codec和speex窄带/宽带)
+ * * EntryParameter : key,配置项
+ * * ReturnValue    : 返回采样率, 配置无效时返回8000
+ * **************************************************************************************/
+static int audio_config_rate(const char *key)
+{
+	int rate = config_get_int("AUDIO", key, 8000);
+
+	if(unlikely(rate != 8000 && rate != 16000)) {
+		syslog(LOG_WARNING, "audio %s %d not supported, use 8000\n", key, rate);
+		rate = 8000;
+	}
+
+	return rate;
+}
+
 /**************************************************************************************
  * * FunctionName   : audio_init()
  * * Description    : audio初始化
@@ -346,87 +907,156 @@ static int audio_handler(int fd, char *data, int len)
  * **************************************************************************************/
 static int audio_init(int fd)
 {
-	int on;
-	float f;
-	int noise;
+	int i;
+	int slot;
+	int codec;
+	int interval;
+	char name[32];
 	void *ret = NULL;
+	pthread_attr_t attr;
 
 	// 0.设置初始化状态
 	sound.fd = fd;
-	sound.frame_size = EC20_SAMPLE_PER_20MS * EC20_SAMPLE_BITS; // ec20 default is 320bytes a frame
-
-	/* 1.噪音消除初始化， 每帧的大小（建议帧长为20ms）
-	 * 帧长20ms等于160个采样, 采样率8000 
-	 */
-	sound.d_st = speex_preprocess_state_init(EC20_SAMPLE_PER_20MS, sample_rate);
-	on = 1;
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_DENOISE, &on);
-	noise = -60; // 低于60db的都认为是噪声
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_NOISE_SUPPRESS, &noise); 
-	on = 1;
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_DEREVERB, &on);
-	f = .0;
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_DEREVERB_DECAY, &f);
-	f = .0;
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_DEREVERB_LEVEL, &f);
-
-	// 2.设置噪音和静音检测模块
-	on = 1;
-	speex_preprocess_ctl(sound.d_st,SPEEX_PREPROCESS_SET_VAD, &on);
-	on = 99;
-	speex_preprocess_ctl(sound.d_st,SPEEX_PREPROCESS_SET_PROB_START, &on);
-	on = 98;
-	speex_preprocess_ctl(sound.d_st,SPEEX_PREPROCESS_SET_PROB_CONTINUE, &on);
-
-	// 3.当近端活动状态时，设置残差回波衰减db
-	on = -15;
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS_ACTIVE,&on);
-	// 4.设置噪声衰减分贝
-	on = -40;
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS,&on);
-
-	// 5.创建回音抑制器
-	sound.e_st = speex_echo_state_init(EC20_SAMPLE_PER_20MS, ECHO_TAIL);
-	speex_echo_ctl(sound.e_st, SPEEX_ECHO_SET_SAMPLING_RATE, &sample_rate);
-	speex_preprocess_ctl(sound.d_st, SPEEX_PREPROCESS_SET_ECHO_STATE, sound.e_st);
-
-	// 6.初始化锁
-	pthread_mutex_init(&sound.lock, NULL);
-	pthread_cond_init(&sound.wait, NULL);
-
-	// 7.初始化voice相关
-	INIT_LIST_HEAD(&sound.list);
-	Ql_AudPlayer_SetBufsize_ms(NULL/*"hw:0,0"*/,20);/* store and playing 20ms */
-	Ql_clt_set_mixer_value("SEC_AUX_PCM_RX Audio Mixer MultiMedia1", 1, "1");
-	Ql_clt_set_mixer_value("MultiMedia1 Mixer SEC_AUX_PCM_UL_TX", 1, "1");
-
-	sound.pcm = Ql_AudPlayer_Open(NULL, NULL);
-	if(unlikely(sound.pcm < 0)) {
+	sound.rate = audio_config_rate("rate");
+	sound.samples = sound.rate / 50;
+	sound.frame_size = sound.samples * EC20_SAMPLE_BITS; // ec20 default is 320bytes a frame
+	sound.link_rate = audio_config_rate("link_rate");
+	sound.link_samples = sound.link_rate / 50;
+	sound.link_size = sound.link_samples * EC20_SAMPLE_BITS;
+	sound.tx_frames = MIN_TRANSFER_SIZE / sound.link_size;
+	sound.dtx = config_get_int("AUDIO", "dtx", 1);
+	sound.streams = config_get_int("AUDIO", "streams", 2);
+	if(sound.streams < 1) sound.streams = 1;
+	if(sound.streams > AUDIO_STREAMS) sound.streams = AUDIO_STREAMS;
+	sound.duck_gain = mixer_gain_db(config_get_int("AUDIO", "duck_db", AUDIO_DUCK_DB));
+
+	// 1.创建回音消除器和噪音消除器
+	if(unlikely(audio_dsp_init(&sound.speex, sound.samples, sound.rate) < 0)) {
+		syslog(LOG_ERR, "audio speex echo/preprocess init failed\n");
+		return -1;
+	}
+
+	// 2.初始化SPEEX模式的上行编码器, 失败时上报原始数据
+	codec = audio_codec_lookup(config_get_string("AUDIO", "uplink_codec", "speex"));
+	if(unlikely(codec < 0 || audio_encoder_init(&sound.enc, codec, sound.link_samples,
+			config_get_int("AUDIO", "speex_quality", SPEEX_QUALITY)) < 0)) {
+		syslog(LOG_ERR, "audio uplink codec %s unavailable, send raw pcm\n",
+				config_get_string("AUDIO", "uplink_codec", "speex"));
+		audio_encoder_init(&sound.enc, CODEC__RAW, sound.link_samples, 0);
+	}
+	syslog(LOG_NOTICE, "audio uplink codec %d, codec %d Hz, link %d Hz\n", sound.enc.codec, sound.rate, sound.link_rate);
+
+	// 下行解码器失败时只影响speex下行, 原始PCM和ADPCM仍可播放
+	for (i = 0; i < sound.streams; i++) {
+		if(unlikely(audio_decoder_init(&sound.stream[i].dec, sound.link_samples) < 0)) {
+			syslog(LOG_ERR, "audio stream %d speex decoder init failed\n", i);
+		}
+	}
+
+	// 3.初始化唤醒音频线程的eventfd和20ms帧时钟
+	sound.wake = eventfd(0, EFD_CLOEXEC);
+	if(unlikely(sound.wake < 0)) {
+		syslog(LOG_ERR, "audio eventfd failed: %s\n", strerror(errno));
+		goto destory_init0;
+	}
+	if(unlikely(audio_clock_init(&sound.clock, 20000, config_get_int("STATS", "interval", 60)) < 0)) {
+		syslog(LOG_ERR, "audio timerfd failed: %s\n", strerror(errno));
+		close(sound.wake);
+		goto destory_init0;
+	}
+
+	// 4.初始化voice相关, 各路播放队列和流水线队列一次分配, 运行过程中不再分配内存
+	interval = config_get_int("STATS", "interval", 60);
+	slot = sizeof(struct play_frame) + (sound.link_size > AUDIO_REC_MAXLEN ? sound.link_size : AUDIO_REC_MAXLEN);
+	for (i = 0; i < sound.streams; i++) {
+		if(unlikely(ring_init(&sound.stream[i].play, config_get_int("AUDIO", "play_frames", PLAY_FRAMES), (slot + 7) & ~7) < 0
+				|| resampler_init(&sound.stream[i].rs, sound.link_rate, sound.rate, 20) < 0)) {
+			syslog(LOG_ERR, "audio queue alloc failed\n");
+			goto destory_init1;
+		}
+	}
+	if(unlikely(ring_init(&sound.dsp, DSP_FRAMES, sizeof(struct audio_frame)) < 0
+			|| ring_init(&sound.tx, TX_FRAMES, sizeof(struct audio_frame)) < 0
+			|| resampler_init(&sound.up, sound.rate, sound.link_rate, 20) < 0)) {
+		syslog(LOG_ERR, "audio queue alloc failed\n");
+		goto destory_init1;
+	}
+	sem_init(&sound.dsp_sem, 0, 0);
+	sem_init(&sound.tx_sem, 0, 0);
+	hist_init(&sound.play_fill, "audio play fill", "frames", interval);
+	hist_init(&sound.decode_time, "audio decode", "us", interval);
+	for (i = 0; i < sound.streams; i++) {
+		// 第一路的统计名字与单路播放时相同
+		snprintf(name, sizeof(name), i == 0 ? "audio play" : "audio play %d", i);
+		jitter_init(&sound.stream[i].jb, name, sound.link_samples, 20000,
+				config_get_int("AUDIO", "jitter_min_ms", JITTER_MIN_MS),
+				config_get_int("AUDIO", "jitter_max_ms", JITTER_MAX_MS), interval);
+		sound.stream[i].gain = MIXER_UNITY;
+		sound.stream[i].priority = 0;
+		sound.stream[i].duck = MIXER_UNITY;
+	}
+	hist_init(&sound.io_time, "audio io", "us", interval);
+	hist_init(&sound.dsp_time, "audio dsp", "us", interval);
+	hist_init(&sound.tx_time, "audio tx", "us", interval);
+	hist_init(&sound.tx_size, "audio tx size", "bytes", interval);
+	hist_init(&sound.tx_latency, "audio capture to tx", "us", interval);
+
+	// 打开音频设备, 模块上为移远SDK, 主机上可配置为WAV文件
+	sound.hal = audio_hal_select(config_get_string("AUDIO", "device", "quectel"), sound.rate, sound.frame_size);
+	if(unlikely(sound.hal == NULL)) {
 		goto destory_init1;
 	}
 
-	// 8.初始化record
+	// 5.初始化record
 	sound.record = CODEC__NONE;
+	sound.want = CODEC__NONE;
 
-	// 9.初始化线程
-	if(pthread_create(&sound.tid, NULL, alsa_sound_tasklet,(void *)&sound) != 0) {
-		DEBUG("audio create thread failed\n");
+	// 6.初始化线程, 先启动下游的发送和DSP线程, 调度策略由各线程入口按[SCHED]设置
+	sched_thread_attr(&attr);
+	if(pthread_create(&sound.tx_tid, &attr, audio_tx_tasklet, (void *)&sound) != 0) {
+		DEBUG("audio create tx thread failed\n");
 		goto destory_init2;
 	}
+	if(pthread_create(&sound.dsp_tid, &attr, audio_dsp_tasklet, (void *)&sound) != 0) {
+		DEBUG("audio create dsp thread failed\n");
+		goto destory_init3;
+	}
+	if(pthread_create(&sound.tid, &attr, alsa_sound_tasklet,(void *)&sound) != 0) {
+		DEBUG("audio create thread failed\n");
+		goto destory_init4;
+	}
 
+	pthread_attr_destroy(&attr);
 	sound.inited = 1;
 	DEBUG("audio thread running\n");
 
 	return 0;
+destory_init4:
+	pthread_cancel(sound.dsp_tid);
+	pthread_join(sound.dsp_tid, &ret);
+destory_init3:
+	pthread_cancel(sound.tx_tid);
+	pthread_join(sound.tx_tid, &ret);
 destory_init2:
-	Ql_AudPlayer_Stop(sound.pcm);
-	Ql_AudPlayer_Close(sound.pcm);
+	pthread_attr_destroy(&attr);
+	sound.hal->close();
+	sem_destroy(&sound.dsp_sem);
+	sem_destroy(&sound.tx_sem);
 destory_init1:
-	pthread_mutex_destroy(&sound.lock);
-	pthread_cond_destroy(&sound.wait);
-
-	speex_echo_state_destroy(sound.e_st);
-	speex_preprocess_state_destroy(sound.d_st);
+	for (i = 0; i < sound.streams; i++) {
+		ring_free(&sound.stream[i].play);
+		resampler_free(&sound.stream[i].rs);
+	}
+	ring_free(&sound.dsp);
+	ring_free(&sound.tx);
+	resampler_free(&sound.up);
+	audio_clock_free(&sound.clock);
+	close(sound.wake);
+destory_init0:
+	audio_encoder_free(&sound.enc);
+	for (i = 0; i < sound.streams; i++) audio_decoder_free(&sound.stream[i].dec);
+
+	audio_dsp_free(&sound.speex);
 	sound.inited = 0;
 
 	return -1;
@@ -440,31 +1070,43 @@ destory_init1:
  * **************************************************************************************/
 static int audio_deinit(int fd)
 {
+	int i;
 	void *ret;
 
 	DEBUG("audio thread exit\n");
 
 	if(!sound.inited) return 0;
 
-	// 1.结束voice
-	Ql_AudPlayer_Stop(sound.pcm);
-	Ql_AudPlayer_Close(sound.pcm);
-
-	// 2.结束线程
+	// 1.结束线程, 线程退出后才能关闭播放和录音设备
 	pthread_cancel(sound.tid);
 	pthread_join(sound.tid, &ret);
-	pthread_mutex_destroy(&sound.lock);
-	pthread_cond_destroy(&sound.wait);
-
-	// 3.销毁speex相关
-	speex_echo_state_destroy(sound.e_st);
-	speex_preprocess_state_destroy(sound.d_st);
+	pthread_cancel(sound.dsp_tid);
+	pthread_join(sound.dsp_tid, &ret);
+	pthread_cancel(sound.tx_tid);
+	pthread_join(sound.tx_tid, &ret);
+	audio_clock_free(&sound.clock);
+	close(sound.wake);
+	sem_destroy(&sound.dsp_sem);
+	sem_destroy(&sound.tx_sem);
+	for (i = 0; i < sound.streams; i++) {
+		ring_free(&sound.stream[i].play);
+		resampler_free(&sound.stream[i].rs);
+	}
+	ring_free(&sound.dsp);
+	ring_free(&sound.tx);
+	resampler_free(&sound.up);
 
-	// 4.结束录音
+	// 2.结束录音, 关闭音频设备
 	if(likely(sound.record)) {
-		ql_voice_record_close();
-		ql_voice_record_dev_clear(AUD_DOWN_LINK);
+		sound.hal->record_close();
 	}
+	sound.hal->close();
+
+	// 3.销毁speex相关
+	audio_encoder_free(&sound.enc);
+	for (i = 0; i < sound.streams; i++) audio_decoder_free(&sound.stream[i].dec);
+	audio_dsp_free(&sound.speex);
+
 	sound.inited = 0;
 
 	return  0;
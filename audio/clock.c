@@ -0,0 +1,168 @@
+#include <string.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <sys/timerfd.h>
+#include "audio_clock.h"
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_now()
+ * * Description    : 获取单调时间
+ * * EntryParameter : None
+ * * ReturnValue    : 返回单调时间(ns)
+ * **************************************************************************************/
+static inline uint64_t audio_clock_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_arm()
+ * * Description    : 设置定时器在绝对时间到期, 0表示停止
+ * * EntryParameter : c,音频时钟, ns,到期的单调时间
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void audio_clock_arm(struct audio_clock *c, uint64_t ns)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = ns / 1000000000ULL;
+	its.it_value.tv_nsec = ns % 1000000000ULL;
+	timerfd_settime(c->fd, ns ? TFD_TIMER_ABSTIME : 0, &its, NULL);
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_init()
+ * * Description    : 初始化音频时钟
+ * * EntryParameter : c,音频时钟, period_us,帧周期, interval,统计输出周期(秒)
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_clock_init(struct audio_clock *c, int period_us, int interval)
+{
+	memset(c, 0, sizeof(struct audio_clock));
+	c->nominal_ns = (int64_t)period_us * 1000;
+	c->period_ns = c->nominal_ns;
+	hist_init(&c->wakeup, "audio clock wakeup", "us", interval);
+
+	c->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (c->fd < 0) return -1;
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_free()
+ * * Description    : 释放音频时钟
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_free(struct audio_clock *c)
+{
+	if (c->fd >= 0) close(c->fd);
+	c->fd = -1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_start()
+ * * Description    : 开始定时, 第一帧立即到期, 保留上次的周期修正
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_start(struct audio_clock *c)
+{
+	if (c->running) return;
+
+	c->running = 1;
+	c->frames = 0;
+	c->window = 0;
+	c->first_us = 0;
+	c->next_ns = audio_clock_now();
+	audio_clock_arm(c, c->next_ns);
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_stop()
+ * * Description    : 停止定时, 空闲时线程不再被定时器唤醒
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_stop(struct audio_clock *c)
+{
+	if (!c->running) return;
+
+	c->running = 0;
+	audio_clock_arm(c, 0);
+	syslog(LOG_NOTICE, "audio clock stop after %lu frames, drift %d ppm, %lu late\n",
+			c->frames, audio_clock_ppm(c), c->late);
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_wait()
+ * * Description    : 等待下一帧到期, 并设置再下一帧的到期时间
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : 返回到期的单调时间(us)
+ * **************************************************************************************/
+uint64_t audio_clock_wait(struct audio_clock *c)
+{
+	uint64_t n, now, due = c->next_ns;
+
+	// 1.等待到期, 被信号中断时重新等待
+	while (read(c->fd, &n, sizeof(n)) < 0 && audio_clock_now() < due);
+	now = audio_clock_now();
+	hist_add(&c->wakeup, (now - due) / 1000);
+
+	// 2.唤醒太晚时不补帧, 从当前时间重新开始计时, 避免连续突发
+	c->next_ns += c->period_ns;
+	if (now > c->next_ns) {
+		c->late++;
+		c->next_ns = now + c->period_ns;
+	}
+	audio_clock_arm(c, c->next_ns);
+
+	return due / 1000;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_sync()
+ * * Description    : 每帧调用一次, 输入本帧阻塞的设备调用的开始和结束时间, 修正帧周期
+ *                    阻塞的调用在codec帧边界返回, 窗口内第一次和最后一次阻塞返回的
+ *                    时间差除以帧数为codec的实际周期; 整个窗口都没有阻塞说明定时
+ *                    比codec慢, 数据在驱动中积累, 缩短周期
+ * * EntryParameter : c,音频时钟, begin,调用开始时间(us), end,调用结束时间(us)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_sync(struct audio_clock *c, uint64_t begin, uint64_t end)
+{
+	int64_t period;
+	int64_t limit = c->nominal_ns * CLOCK_MAX_PPM / 1000000;
+
+	// 1.记录窗口内等待codec的帧
+	if (end - begin >= CLOCK_BLOCK_US) {
+		if (c->first_us == 0) {
+			c->first_us = end;
+			c->first_frame = c->frames;
+		}
+		c->last_us = end;
+		c->last_frame = c->frames;
+	}
+	c->frames++;
+	if (c->frames - c->window < CLOCK_WINDOW_FRAMES) return;
+
+	// 2.窗口结束, 估计codec周期并平滑
+	if (c->first_us && c->last_frame - c->first_frame >= CLOCK_WINDOW_FRAMES / 2) {
+		period = (int64_t)(c->last_us - c->first_us) * 1000 / (int64_t)(c->last_frame - c->first_frame);
+		c->period_ns = (c->period_ns * 3 + period) / 4;
+	} else if (c->first_us == 0) {
+		c->period_ns -= c->nominal_ns * CLOCK_STEP_PPM / 1000000;
+	}
+
+	if (c->period_ns > c->nominal_ns + limit) c->period_ns = c->nominal_ns + limit;
+	if (c->period_ns < c->nominal_ns - limit) c->period_ns = c->nominal_ns - limit;
+
+	c->window = c->frames;
+	c->first_us = 0;
+}
@@ -0,0 +1,385 @@
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+#include <syslog.h>
+#include <protobuf-c/data.pb-c.h>
+#include "audio_codec.h"
+
+/**************************************************************************************
+* Description    : IMA-ADPCM步长序号调整表和步长表
+**************************************************************************************/
+static const int adpcm_index_table[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+static const int adpcm_step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+/**************************************************************************************
+* Description    : 编码方式名字
+**************************************************************************************/
+static const struct {
+	const char *name;
+	int codec;
+} audio_codecs[] = {
+	{"speex", CODEC__SPEEX},
+	{"adpcm", CODEC__ADPCM},
+	{"raw",   CODEC__RAW},
+};
+
+/**************************************************************************************
+ * * FunctionName   : adpcm_update()
+ * * Description    : 根据4位编码更新ADPCM状态, 编码和解码共用, 保证两端状态一致
+ * * EntryParameter : st,ADPCM状态, code,4位编码
+ * * ReturnValue    : 返回更新后的预测值(解码输出)
+ * **************************************************************************************/
+static inline int adpcm_update(struct adpcm_state *st, int code)
+{
+	int step = adpcm_step_table[st->index];
+	int diff = step >> 3;
+
+	if (code & 4) diff += step;
+	if (code & 2) diff += step >> 1;
+	if (code & 1) diff += step >> 2;
+	if (code & 8) st->pred -= diff;
+	else st->pred += diff;
+
+	if (st->pred > 32767) st->pred = 32767;
+	else if (st->pred < -32768) st->pred = -32768;
+
+	st->index += adpcm_index_table[code];
+	if (st->index < 0) st->index = 0;
+	else if (st->index > 88) st->index = 88;
+
+	return st->pred;
+}
+
+/**************************************************************************************
+ * * FunctionName   : adpcm_code()
+ * * Description    : 计算一个采样的4位编码并更新状态
+ * * EntryParameter : st,ADPCM状态, sample,采样值
+ * * ReturnValue    : 返回4位编码
+ * **************************************************************************************/
+static inline int adpcm_code(struct adpcm_state *st, int sample)
+{
+	int code = 0;
+	int diff = sample - st->pred;
+	int step = adpcm_step_table[st->index];
+
+	if (diff < 0) {
+		code = 8;
+		diff = -diff;
+	}
+	if (diff >= step) {
+		code |= 4;
+		diff -= step;
+	}
+	if (diff >= step >> 1) {
+		code |= 2;
+		diff -= step >> 1;
+	}
+	if (diff >= step >> 2) code |= 1;
+
+	adpcm_update(st, code);
+
+	return code;
+}
+
+/**************************************************************************************
+ * * FunctionName   : adpcm_encode()
+ * * Description    : ADPCM编码一帧, 帧头保存起始状态
+ * * EntryParameter : st,ADPCM状态, pcm,一帧PCM, samples,采样数, out,输出缓冲区
+ * * ReturnValue    : 返回编码后的长度
+ * **************************************************************************************/
+static int adpcm_encode(struct adpcm_state *st, const int16_t *pcm, int samples, uint8_t *out)
+{
+	int i, code;
+	uint8_t *p = out + ADPCM_HEAD;
+
+	// 1.帧头为本帧起始状态
+	out[0] = st->pred & 0xff;
+	out[1] = (st->pred >> 8) & 0xff;
+	out[2] = st->index;
+
+	// 2.每字节两个采样, 先低4位后高4位
+	for (i = 0; i < samples; i++) {
+		code = adpcm_code(st, pcm[i]);
+		if (i & 1) *p++ |= code << 4;
+		else *p = code;
+	}
+
+	return ADPCM_FRAME_SIZE(samples);
+}
+
+/**************************************************************************************
+ * * FunctionName   : adpcm_decode()
+ * * Description    : ADPCM解码一帧, 从帧头的起始状态开始
+ * * EntryParameter : data,编码数据, len,数据长度, samples,采样数, pcm,输出PCM
+ * * ReturnValue    : 成功返回0, 长度不对返回-1
+ * **************************************************************************************/
+static int adpcm_decode(const uint8_t *data, int len, int samples, int16_t *pcm)
+{
+	int i;
+	struct adpcm_state st;
+	const uint8_t *p = data + ADPCM_HEAD;
+
+	if (len != ADPCM_FRAME_SIZE(samples) || data[2] > 88) return -1;
+
+	// 1.帧头为本帧起始状态
+	st.pred = (int16_t)(data[0] | data[1] << 8);
+	st.index = data[2];
+
+	// 2.每字节两个采样, 先低4位后高4位
+	for (i = 0; i < samples; i++) {
+		if (i & 1) pcm[i] = adpcm_update(&st, *p++ >> 4);
+		else pcm[i] = adpcm_update(&st, *p & 0x0f);
+	}
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_cng_generate()
+ * * Description    : 生成指定电平的舒适噪声(均匀分布白噪声)
+ * * EntryParameter : seed,随机数种子, level,电平(-dBFS), pcm,输出PCM, samples,采样数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void audio_cng_generate(uint32_t *seed, int level, int16_t *pcm, int samples)
+{
+	int i, amp;
+
+	if (level >= AUDIO_CNG_MUTE) {
+		memset(pcm, 0x00, samples * sizeof(int16_t));
+		return;
+	}
+
+	// 均匀分布[-amp, amp]的有效值为amp/sqrt(3)
+	amp = (int)(32768.0 * pow(10.0, -level / 20.0) * 1.7320508);
+	if (amp > 32767) amp = 32767;
+	for (i = 0; i < samples; i++) {
+		*seed = *seed * 1664525 + 1013904223;
+		pcm[i] = (int16_t)((int)((*seed >> 16) % (2 * amp + 1)) - amp);
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_cng_level()
+ * * Description    : 计算一帧静音的舒适噪声电平
+ * * EntryParameter : pcm,一帧PCM, samples,采样数
+ * * ReturnValue    : 返回电平(-dBFS), 0~AUDIO_CNG_MUTE
+ * **************************************************************************************/
+int audio_cng_level(const int16_t *pcm, int samples)
+{
+	int i, level;
+	int64_t energy = 0;
+
+	for (i = 0; i < samples; i++) energy += pcm[i] * pcm[i];
+	if (energy == 0) return AUDIO_CNG_MUTE;
+
+	level = (int)(-10.0 * log10((double)energy / samples / (32768.0 * 32768.0)) + 0.5);
+	if (level < 0) return 0;
+	if (level > AUDIO_CNG_MUTE) return AUDIO_CNG_MUTE;
+
+	return level;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_codec_lookup()
+ * * Description    : 根据名字获取编码方式
+ * * EntryParameter : name,编码名字(speex/adpcm/raw)
+ * * ReturnValue    : 返回CODEC__xxx, 不支持时返回-1
+ * **************************************************************************************/
+int audio_codec_lookup(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(audio_codecs) / sizeof(audio_codecs[0]); i++) {
+		if (!strcasecmp(name, audio_codecs[i].name)) return audio_codecs[i].codec;
+	}
+
+	return -1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_speex_mode()
+ * * Description    : 按每帧(20ms)采样数选择speex模式, 160为窄带(8k), 320为宽带(16k)
+ * * EntryParameter : samples,每帧采样数
+ * * ReturnValue    : 返回speex模式, 不支持时返回窄带模式, 由帧长检查报错
+ * **************************************************************************************/
+static const SpeexMode *audio_speex_mode(int samples)
+{
+	return samples == 320 ? &speex_wb_mode : &speex_nb_mode;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_encoder_init()
+ * * Description    : 初始化编码器
+ * * EntryParameter : enc,编码器, codec,编码方式CODEC__xxx, samples,每帧采样数, quality,speex编码质量
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_encoder_init(struct audio_encoder *enc, int codec, int samples, int quality)
+{
+	int size = 0;
+
+	memset(enc, 0, sizeof(struct audio_encoder));
+	enc->codec = codec;
+	enc->samples = samples;
+	if (codec != CODEC__SPEEX) return 0;
+
+	// 1.speex窄带或宽带编码器, 每帧采样数必须与编码器一致
+	enc->speex = speex_encoder_init(audio_speex_mode(samples));
+	if (enc->speex == NULL) return -1;
+
+	speex_encoder_ctl(enc->speex, SPEEX_GET_FRAME_SIZE, &size);
+	if (size != samples) {
+		syslog(LOG_ERR, "speex frame size %d, expect %d\n", size, samples);
+		speex_encoder_destroy(enc->speex);
+		enc->speex = NULL;
+		return -1;
+	}
+	speex_encoder_ctl(enc->speex, SPEEX_SET_QUALITY, &quality);
+	speex_bits_init(&enc->bits);
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_encoder_reset()
+ * * Description    : 开始新的录音时复位编码状态
+ * * EntryParameter : enc,编码器
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_encoder_reset(struct audio_encoder *enc)
+{
+	enc->adpcm.pred = 0;
+	enc->adpcm.index = 0;
+
+	// speex编码器的预测和增益状态也清除, 不从上一次录音的语音预测
+	if (enc->speex) speex_encoder_ctl(enc->speex, SPEEX_RESET_STATE, NULL);
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_encoder_free()
+ * * Description    : 释放编码器
+ * * EntryParameter : enc,编码器
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_encoder_free(struct audio_encoder *enc)
+{
+	if (enc->speex) {
+		speex_bits_destroy(&enc->bits);
+		speex_encoder_destroy(enc->speex);
+		enc->speex = NULL;
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_encode()
+ * * Description    : 编码一帧PCM, 不带记录头
+ * * EntryParameter : enc,编码器, pcm,一帧PCM, out,输出缓冲区, size,缓冲区大小
+ * * ReturnValue    : 返回编码后的长度, 失败返回-1
+ * **************************************************************************************/
+int audio_encode(struct audio_encoder *enc, int16_t *pcm, uint8_t *out, int size)
+{
+	switch (enc->codec) {
+	case CODEC__SPEEX:
+		speex_bits_reset(&enc->bits);
+		speex_encode_int(enc->speex, pcm, &enc->bits);
+		if (speex_bits_nbytes(&enc->bits) > size) return -1;
+		return speex_bits_write(&enc->bits, (char *)out, size);
+	case CODEC__ADPCM:
+		if (ADPCM_FRAME_SIZE(enc->samples) > size) return -1;
+		return adpcm_encode(&enc->adpcm, pcm, enc->samples, out);
+	default:
+		if (enc->samples * 2 > size) return -1;
+		memcpy(out, pcm, enc->samples * 2);
+		return enc->samples * 2;
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_decoder_init()
+ * * Description    : 初始化解码器, 支持所有编码方式
+ * * EntryParameter : dec,解码器, samples,每帧采样数
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_decoder_init(struct audio_decoder *dec, int samples)
+{
+	int on = 1;
+	int size = 0;
+
+	memset(dec, 0, sizeof(struct audio_decoder));
+	dec->samples = samples;
+	dec->seed = 1;
+
+	// 1.speex窄带或宽带解码器, 打开感知增强
+	dec->speex = speex_decoder_init(audio_speex_mode(samples));
+	if (dec->speex == NULL) return -1;
+
+	speex_decoder_ctl(dec->speex, SPEEX_GET_FRAME_SIZE, &size);
+	if (size != samples) {
+		syslog(LOG_ERR, "speex frame size %d, expect %d\n", size, samples);
+		speex_decoder_destroy(dec->speex);
+		dec->speex = NULL;
+		return -1;
+	}
+	speex_decoder_ctl(dec->speex, SPEEX_SET_ENH, &on);
+	speex_bits_init(&dec->bits);
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_decoder_free()
+ * * Description    : 释放解码器
+ * * EntryParameter : dec,解码器
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_decoder_free(struct audio_decoder *dec)
+{
+	if (dec->speex) {
+		speex_bits_destroy(&dec->bits);
+		speex_decoder_destroy(dec->speex);
+		dec->speex = NULL;
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_decode()
+ * * Description    : 解码一帧数据(不带记录头), 输出samples个采样
+ *                    codec为CODEC__NONE时data[0]为舒适噪声电平, 输出该电平的噪声
+ * * EntryParameter : dec,解码器, codec,编码方式CODEC__xxx, data,编码数据, len,数据长度, pcm,输出PCM
+ * * ReturnValue    : 成功返回0, 数据错误或不支持的编码返回-1
+ * **************************************************************************************/
+int audio_decode(struct audio_decoder *dec, int codec, const uint8_t *data, int len, int16_t *pcm)
+{
+	switch (codec) {
+	case CODEC__NONE:
+		if (len < 1) return -1;
+		audio_cng_generate(&dec->seed, data[0], pcm, dec->samples);
+		return 0;
+	case CODEC__SPEEX:
+		if (dec->speex == NULL) return -1;
+		speex_bits_read_from(&dec->bits, (const char *)data, len);
+		return speex_decode_int(dec->speex, &dec->bits, pcm) == 0 ? 0 : -1;
+	case CODEC__ADPCM:
+		return adpcm_decode(data, len, dec->samples, pcm);
+	case CODEC__RAW:
+		if (len > dec->samples * 2) return -1;
+		memcpy(pcm, data, len);
+		memset((uint8_t *)pcm + len, 0x00, dec->samples * 2 - len);
+		return 0;
+	}
+
+	return -1;
+}
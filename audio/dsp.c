@@ -0,0 +1,109 @@
+#include <stddef.h>
+#include "audio_dsp.h"
+
+/**************************************************************************************
+ * * FunctionName   : audio_preprocess_init()
+ * * Description    : 创建并配置噪音消除器, 不关联回音消除器
+ * * EntryParameter : samples,每帧采样数, rate,采样率
+ * * ReturnValue    : 返回噪音消除器, 失败返回NULL
+ * **************************************************************************************/
+static SpeexPreprocessState *audio_preprocess_init(int samples, int rate)
+{
+	int on;
+	float f;
+	int noise;
+	SpeexPreprocessState *d_st;
+
+	/* 1.噪音消除初始化， 每帧的大小（建议帧长为20ms）
+	 * 帧长20ms, 采样率8000时160个采样, 16000时320个采样
+	 */
+	d_st = speex_preprocess_state_init(samples, rate);
+	if (d_st == NULL) return NULL;
+	on = 1;
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_DENOISE, &on);
+	noise = -60; // 低于60db的都认为是噪声
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_NOISE_SUPPRESS, &noise); 
+	on = 1;
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_DEREVERB, &on);
+	f = .0;
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_DEREVERB_DECAY, &f);
+	f = .0;
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_DEREVERB_LEVEL, &f);
+
+	// 2.设置噪音和静音检测模块
+	on = 1;
+	speex_preprocess_ctl(d_st,SPEEX_PREPROCESS_SET_VAD, &on);
+	on = 99;
+	speex_preprocess_ctl(d_st,SPEEX_PREPROCESS_SET_PROB_START, &on);
+	on = 98;
+	speex_preprocess_ctl(d_st,SPEEX_PREPROCESS_SET_PROB_CONTINUE, &on);
+
+	// 3.当近端活动状态时，设置残差回波衰减db
+	on = -15;
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS_ACTIVE,&on);
+	// 4.设置噪声衰减分贝
+	on = -40;
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_ECHO_SUPPRESS,&on);
+
+	return d_st;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_dsp_init()
+ * * Description    : 创建并配置回音消除器和噪音消除器, 音频模块和基准测试使用同一配置
+ * * EntryParameter : dsp,语音处理, samples,每帧采样数, rate,采样率
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_dsp_init(struct audio_dsp *dsp, int samples, int rate)
+{
+	dsp->samples = samples;
+	dsp->rate = rate;
+	dsp->d_st = audio_preprocess_init(samples, rate);
+	if (dsp->d_st == NULL) return -1;
+
+	// 5.创建回音抑制器
+	dsp->e_st = speex_echo_state_init(samples, rate * ECHO_TAIL_MS / 1000);
+	if (dsp->e_st == NULL) {
+		speex_preprocess_state_destroy(dsp->d_st);
+		dsp->d_st = NULL;
+		return -1;
+	}
+	speex_echo_ctl(dsp->e_st, SPEEX_ECHO_SET_SAMPLING_RATE, &rate);
+	speex_preprocess_ctl(dsp->d_st, SPEEX_PREPROCESS_SET_ECHO_STATE, dsp->e_st);
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_dsp_reset()
+ * * Description    : 录音结束时复位回音消除器和噪音消除器, 下次录音不使用上次的回声路径和噪声估计
+ *                    噪音消除器没有复位接口, 重新创建, 创建失败时继续使用原来的
+ * * EntryParameter : dsp,语音处理
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_dsp_reset(struct audio_dsp *dsp)
+{
+	SpeexPreprocessState *d_st;
+
+	speex_echo_state_reset(dsp->e_st);
+
+	d_st = audio_preprocess_init(dsp->samples, dsp->rate);
+	if (d_st == NULL) return;
+	speex_preprocess_ctl(d_st, SPEEX_PREPROCESS_SET_ECHO_STATE, dsp->e_st);
+	speex_preprocess_state_destroy(dsp->d_st);
+	dsp->d_st = d_st;
+}
+
+/**************************************************************************************
+ * * FunctionName   : audio_dsp_free()
+ * * Description    : 释放回音消除器和噪音消除器
+ * * EntryParameter : dsp,语音处理
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_dsp_free(struct audio_dsp *dsp)
+{
+	if (dsp->e_st) speex_echo_state_destroy(dsp->e_st);
+	if (dsp->d_st) speex_preprocess_state_destroy(dsp->d_st);
+	dsp->e_st = NULL;
+	dsp->d_st = NULL;
+}
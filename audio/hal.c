@@ -0,0 +1,325 @@
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <syslog.h>
+#include "config.h"
+#include "pbserial.h"
+#include "audio_hal.h"
+
+/**************************************************************************************
+* Description    : WAV文件格式(RIFF, PCM 16位单声道)
+**************************************************************************************/
+struct wav_chunk {
+	char id[4];                               // 块名字
+	uint32_t size;                            // 块长度(小端)
+};
+
+struct wav_fmt {
+	uint16_t format;                          // 1为PCM
+	uint16_t channels;                        // 声道数
+	uint32_t rate;                            // 采样率
+	uint32_t byte_rate;                       // 每秒字节数
+	uint16_t align;                           // 每个采样点字节数
+	uint16_t bits;                            // 采样位数
+};
+
+struct wav_header {
+	struct wav_chunk riff;                    // "RIFF", 文件长度-8
+	char wave[4];                             // "WAVE"
+	struct wav_chunk fmt;                     // "fmt ", 16
+	struct wav_fmt pcm;                       // PCM格式
+	struct wav_chunk data;                    // "data", 数据长度
+};
+
+/**************************************************************************************
+* Description    : 文件音频设备状态, 录音从WAV文件循环读取, 播放写入WAV文件或者丢弃,
+*                  按单调时钟模拟codec的节奏阻塞
+**************************************************************************************/
+static struct {
+	int rate;                                 // 采样率
+	int frame_size;                           // 一帧字节数
+	uint64_t frame_us;                        // 一帧时长
+	int in;                                   // 录音WAV文件, -1时录音为静音
+	off_t in_start;                           // 录音数据开始位置
+	off_t in_len;                             // 录音数据长度(整帧)
+	off_t in_pos;                             // 当前读取位置(相对数据开始)
+	uint64_t in_next;                         // 下一帧录音产生的时间
+	int out;                                  // 播放WAV文件, -1时丢弃
+	uint32_t out_len;                         // 已写入的播放数据长度
+	uint64_t out_next;                        // 播放缓冲(一帧)空出的时间
+} wav = {.in = -1, .out = -1};
+
+/**************************************************************************************
+ * * FunctionName   : wav_sleep_until()
+ * * Description    : 休眠到指定的单调时间
+ * * EntryParameter : us,单调时间
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void wav_sleep_until(uint64_t us)
+{
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_open_capture()
+ * * Description    : 打开录音WAV文件, 查找fmt和data块, 只支持PCM 16位单声道
+ * * EntryParameter : path,文件路径
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+static int wav_open_capture(const char *path)
+{
+	char wave[4];
+	uint32_t size;
+	off_t pos = 12;
+	struct wav_chunk chunk;
+	struct wav_fmt fmt;
+	int fmt_ok = 0;
+
+	wav.in = open(path, O_RDONLY | O_CLOEXEC);
+	if (wav.in < 0) {
+		syslog(LOG_ERR, "audio capture %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	// 1.RIFF头
+	if (pread(wav.in, &chunk, sizeof(chunk), 0) != sizeof(chunk) || memcmp(chunk.id, "RIFF", 4) != 0
+			|| pread(wav.in, wave, sizeof(wave), 8) != sizeof(wave) || memcmp(wave, "WAVE", 4) != 0) {
+		goto invalid;
+	}
+
+	// 2.逐块查找fmt和data, 其他块跳过
+	while (pread(wav.in, &chunk, sizeof(chunk), pos) == sizeof(chunk)) {
+		unpack_le32(chunk.size, &size);
+		pos += sizeof(chunk);
+		if (memcmp(chunk.id, "fmt ", 4) == 0 && size >= sizeof(fmt)) {
+			if (pread(wav.in, &fmt, sizeof(fmt), pos) != sizeof(fmt)) goto invalid;
+			unpack_le16(fmt.format, &fmt.format);
+			unpack_le16(fmt.channels, &fmt.channels);
+			unpack_le32(fmt.rate, &fmt.rate);
+			unpack_le16(fmt.bits, &fmt.bits);
+			if (fmt.format != 1 || fmt.channels != 1 || fmt.bits != 16) goto invalid;
+			if ((int)fmt.rate != wav.rate) {
+				syslog(LOG_WARNING, "audio capture %s is %u Hz, played as %d Hz\n", path, fmt.rate, wav.rate);
+			}
+			fmt_ok = 1;
+		} else if (memcmp(chunk.id, "data", 4) == 0 && fmt_ok) {
+			wav.in_start = pos;
+			wav.in_len = size - size % wav.frame_size;
+			if (wav.in_len == 0) goto invalid;
+			wav.in_pos = 0;
+			return 0;
+		}
+		pos += size + (size & 1);
+	}
+
+invalid:
+	syslog(LOG_ERR, "audio capture %s: not a 16 bit mono pcm wav file\n", path);
+	close(wav.in);
+	wav.in = -1;
+
+	return -1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_write_header()
+ * * Description    : 写入播放WAV文件头, 数据长度为已写入的长度
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void wav_write_header(void)
+{
+	struct wav_header h;
+
+	memcpy(h.riff.id, "RIFF", 4);
+	pack_le32(sizeof(h) - 8 + wav.out_len, &h.riff.size);
+	memcpy(h.wave, "WAVE", 4);
+	memcpy(h.fmt.id, "fmt ", 4);
+	pack_le32(sizeof(h.pcm), &h.fmt.size);
+	pack_le16(1, &h.pcm.format);
+	pack_le16(1, &h.pcm.channels);
+	pack_le32(wav.rate, &h.pcm.rate);
+	pack_le32(wav.rate * 2, &h.pcm.byte_rate);
+	pack_le16(2, &h.pcm.align);
+	pack_le16(16, &h.pcm.bits);
+	memcpy(h.data.id, "data", 4);
+	pack_le32(wav.out_len, &h.data.size);
+
+	pwrite(wav.out, &h, sizeof(h), 0);
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_open()
+ * * Description    : 打开文件音频设备, [AUDIO] capture_file为录音WAV文件, 不配置时录音为静音,
+ *                    play_file为播放输出WAV文件, 不配置时丢弃
+ * * EntryParameter : rate,采样率, frame_size,一帧字节数
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+static int wav_open(int rate, int frame_size)
+{
+	const char *capture = config_get_string("AUDIO", "capture_file", "");
+	const char *play = config_get_string("AUDIO", "play_file", "");
+
+	wav.rate = rate;
+	wav.frame_size = frame_size;
+	wav.frame_us = (uint64_t)frame_size / 2 * 1000000 / rate;
+	wav.out_len = 0;
+	wav.out_next = 0;
+
+	// 1.录音文件打开失败时录音为静音, 继续运行
+	if (*capture) wav_open_capture(capture);
+
+	// 2.播放输出文件
+	if (*play) {
+		wav.out = open(play, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (wav.out < 0) {
+			syslog(LOG_ERR, "audio play %s: %s\n", play, strerror(errno));
+			if (wav.in >= 0) close(wav.in);
+			wav.in = -1;
+			return -1;
+		}
+		wav_write_header();
+	}
+	syslog(LOG_NOTICE, "audio file device, capture %s, play %s\n", *capture ? capture : "silence", *play ? play : "null");
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_close()
+ * * Description    : 关闭文件音频设备, 更新播放文件头中的长度
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void wav_close(void)
+{
+	if (wav.in >= 0) close(wav.in);
+	wav.in = -1;
+
+	if (wav.out >= 0) {
+		wav_write_header();
+		close(wav.out);
+	}
+	wav.out = -1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_record_open()
+ * * Description    : 开始录音, 一帧时长后产生第一帧
+ * * EntryParameter : None
+ * * ReturnValue    : 返回0
+ * **************************************************************************************/
+static int wav_record_open(void)
+{
+	wav.in_next = monotonic_us() + wav.frame_us;
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_record_read()
+ * * Description    : 读取一帧录音, 阻塞到下一帧产生的时间, 文件结束后从头循环
+ * * EntryParameter : data,输出一帧
+ * * ReturnValue    : 返回字节数
+ * **************************************************************************************/
+static int wav_record_read(int16_t *data)
+{
+	uint64_t now = monotonic_us();
+
+	// 1.模拟codec节奏, 读取太慢(超过1秒)时丢弃积压的帧
+	if (now < wav.in_next) wav_sleep_until(wav.in_next);
+	else if (now - wav.in_next > 1000000) wav.in_next = now;
+	wav.in_next += wav.frame_us;
+
+	// 2.读取一帧
+	if (wav.in < 0 || pread(wav.in, data, wav.frame_size, wav.in_start + wav.in_pos) != wav.frame_size) {
+		memset(data, 0x00, wav.frame_size);
+	}
+	wav.in_pos += wav.frame_size;
+	if (wav.in_pos >= wav.in_len) wav.in_pos = 0;
+
+	return wav.frame_size;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_record_close()
+ * * Description    : 结束录音, 下次录音继续文件中的位置
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void wav_record_close(void)
+{
+}
+
+/**************************************************************************************
+ * * FunctionName   : wav_play()
+ * * Description    : 播放一帧, 模拟一帧的播放缓冲, 缓冲满时阻塞到空出, 欠载后重新开始计时
+ * * EntryParameter : data,一帧PCM
+ * * ReturnValue    : 返回字节数
+ * **************************************************************************************/
+static int wav_play(const int16_t *data)
+{
+	uint64_t now = monotonic_us();
+
+	if (wav.out_next < now) wav.out_next = now;
+	if (wav.out_next - now > wav.frame_us) wav_sleep_until(wav.out_next - wav.frame_us);
+	wav.out_next += wav.frame_us;
+
+	// 文件头由wav_write_header()在偏移0写入, 数据从文件头之后写入
+	if (wav.out >= 0 && pwrite(wav.out, data, wav.frame_size, sizeof(struct wav_header) + wav.out_len) == wav.frame_size) {
+		wav.out_len += wav.frame_size;
+	}
+
+	return wav.frame_size;
+}
+
+/**************************************************************************************
+* Description    : 文件音频设备后端
+**************************************************************************************/
+const struct audio_hal audio_hal_file = {
+	.name = "file",
+	.open = wav_open,
+	.close = wav_close,
+	.record_open = wav_record_open,
+	.record_read = wav_record_read,
+	.record_close = wav_record_close,
+	.play = wav_play,
+};
+
+/**************************************************************************************
+ * * FunctionName   : audio_hal_select()
+ * * Description    : 按名字选择并打开音频设备后端, 名字错误或者后端没有编译进来时失败
+ * * EntryParameter : name,后端名字(quectel/file), rate,采样率, frame_size,一帧字节数
+ * * ReturnValue    : 返回打开的后端, 后端不存在或者打开失败返回NULL
+ * **************************************************************************************/
+const struct audio_hal *audio_hal_select(const char *name, int rate, int frame_size)
+{
+	size_t i;
+	const struct audio_hal *hal;
+	const struct audio_hal *hals[] = {&audio_hal_quectel, &audio_hal_file};
+
+	// 1.查找后端, 没有链接移远SDK(主机编译)时audio_hal_quectel为NULL,
+	//   不回退到文件后端, 否则模块上配置错误时没有声音也不报初始化失败
+	for (i = 0; i < sizeof(hals)/sizeof(hals[0]); i++) {
+		if (hals[i] != NULL && strcmp(hals[i]->name, name) == 0) break;
+	}
+	if (i == sizeof(hals)/sizeof(hals[0])) {
+		syslog(LOG_ERR, "audio device %s not available\n", name);
+		return NULL;
+	}
+	hal = hals[i];
+
+	// 2.打开后端
+	if (hal->open(rate, frame_size) < 0) {
+		syslog(LOG_ERR, "audio device %s open failed\n", hal->name);
+		return NULL;
+	}
+	syslog(LOG_NOTICE, "audio device %s\n", hal->name);
+
+	return hal;
+}
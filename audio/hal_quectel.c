@@ -0,0 +1,110 @@
+#include <stddef.h>
+#include <syslog.h>
+#include "ql_oe.h"
+#include "audio_hal.h"
+
+/**************************************************************************************
+* Description    : 移远SDK音频设备状态
+**************************************************************************************/
+static int pcm = -1;                          // 播放句柄
+static int pcm_rate = QUEC_PCM_8K;            // 录音采样率
+static int pcm_frame_size = 0;                // 一帧字节数
+
+/**************************************************************************************
+ * * FunctionName   : quectel_open()
+ * * Description    : 打开播放设备, 播放缓冲为一帧(20ms), 配置AUX PCM混音通路
+ * * EntryParameter : rate,采样率, frame_size,一帧字节数
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+static int quectel_open(int rate, int frame_size)
+{
+	pcm_rate = rate == 16000 ? QUEC_PCM_16K : QUEC_PCM_8K;
+	pcm_frame_size = frame_size;
+
+	Ql_AudPlayer_SetBufsize_ms(NULL/*"hw:0,0"*/,20);/* store and playing 20ms */
+	Ql_clt_set_mixer_value("SEC_AUX_PCM_RX Audio Mixer MultiMedia1", 1, "1");
+	Ql_clt_set_mixer_value("MultiMedia1 Mixer SEC_AUX_PCM_UL_TX", 1, "1");
+
+	pcm = Ql_AudPlayer_Open(NULL, NULL);
+	if (pcm < 0) {
+		syslog(LOG_ERR, "audio player open failed\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : quectel_close()
+ * * Description    : 关闭播放设备
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void quectel_close(void)
+{
+	if (pcm < 0) return;
+
+	Ql_AudPlayer_Stop(pcm);
+	Ql_AudPlayer_Close(pcm);
+	pcm = -1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : quectel_record_open()
+ * * Description    : 开始录音, 录取下行(通话对端)语音
+ * * EntryParameter : None
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+static int quectel_record_open(void)
+{
+	ql_voice_record_dev_set(AUD_DOWN_LINK);
+
+	return ql_voice_record_open(pcm_rate, QUEC_PCM_MONO) < 0 ? -1 : 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : quectel_record_read()
+ * * Description    : 读取一帧录音, 阻塞到codec产生一帧
+ * * EntryParameter : data,输出一帧
+ * * ReturnValue    : 返回字节数
+ * **************************************************************************************/
+static int quectel_record_read(int16_t *data)
+{
+	return ql_voice_record_read((char *)data);
+}
+
+/**************************************************************************************
+ * * FunctionName   : quectel_record_close()
+ * * Description    : 结束录音
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void quectel_record_close(void)
+{
+	ql_voice_record_close();
+	ql_voice_record_dev_clear(AUD_DOWN_LINK);
+}
+
+/**************************************************************************************
+ * * FunctionName   : quectel_play()
+ * * Description    : 播放一帧, 播放缓冲满时阻塞
+ * * EntryParameter : data,一帧PCM
+ * * ReturnValue    : 返回字节数
+ * **************************************************************************************/
+static int quectel_play(const int16_t *data)
+{
+	return Ql_AudPlayer_Play(pcm, (unsigned char *)data, pcm_frame_size);
+}
+
+/**************************************************************************************
+* Description    : 移远SDK音频设备后端
+**************************************************************************************/
+const struct audio_hal audio_hal_quectel = {
+	.name = "quectel",
+	.open = quectel_open,
+	.close = quectel_close,
+	.record_open = quectel_record_open,
+	.record_read = quectel_record_read,
+	.record_close = quectel_record_close,
+	.play = quectel_play,
+};
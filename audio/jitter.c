@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <string.h>
+#include "jitter.h"
+
+/**************************************************************************************
+ * * FunctionName   : jitter_init()
+ * * Description    : 初始化抖动缓冲
+ * * EntryParameter : jb,抖动缓冲, name,统计名字前缀, samples,每帧采样数, frame_us,每帧时长, min_ms,max_ms,目标延迟范围,
+ *                    interval,统计输出周期(秒)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void jitter_init(struct jitter *jb, const char *name, int samples, int frame_us, int min_ms, int max_ms, int interval)
+{
+	memset(jb, 0, sizeof(struct jitter));
+	jb->state = JITTER_IDLE;
+	jb->samples = samples > JITTER_MAX_SAMPLES ? JITTER_MAX_SAMPLES : samples;
+	jb->frame_us = frame_us;
+	jb->min_frames = (min_ms * 1000 + frame_us - 1) / frame_us;
+	jb->max_frames = (max_ms * 1000 + frame_us - 1) / frame_us;
+	if (jb->min_frames < 1) jb->min_frames = 1;
+	if (jb->max_frames < jb->min_frames) jb->max_frames = jb->min_frames;
+	jb->target = jb->min_frames;
+
+	snprintf(jb->names[0], sizeof(jb->names[0]), "%s latency", name);
+	snprintf(jb->names[1], sizeof(jb->names[1]), "%s underrun", name);
+	snprintf(jb->names[2], sizeof(jb->names[2]), "%s jitter", name);
+	hist_init(&jb->latency, jb->names[0], "ms", interval);
+	hist_init(&jb->underrun, jb->names[1], "frames", interval);
+	hist_init(&jb->estimate, jb->names[2], "ms", interval);
+}
+
+/**************************************************************************************
+ * * FunctionName   : jitter_action()
+ * * Description    : 每帧周期调用一次, 决定本周期的处理方式
+ * * EntryParameter : jb,抖动缓冲, depth,队列中的帧数, head_rx,第一帧接收时间, head_silent,第一帧是否为静音, now,当前时间
+ * * ReturnValue    : 返回JITTER_xxx
+ * **************************************************************************************/
+int jitter_action(struct jitter *jb, int depth, uint64_t head_rx, int head_silent, uint64_t now)
+{
+	// 1.队列空: 播放中为欠载, 先补偿再播放静音, 超过JITTER_END_FRAMES认为语音结束
+	if (depth == 0) {
+		if (jb->state == JITTER_IDLE) return JITTER_NONE;
+		if (jb->state != JITTER_CONCEAL) {
+			jb->state = JITTER_CONCEAL;
+			jb->gap = 0;
+		}
+		if (++jb->gap > JITTER_END_FRAMES) {
+			jb->state = JITTER_IDLE;
+			return JITTER_NONE;
+		}
+		return JITTER_FILL;
+	}
+
+	// 2.新的一段语音从头开始计算媒体时间
+	if (jb->state == JITTER_IDLE) {
+		jb->state = JITTER_BUFFERING;
+		jb->index = 0;
+		jb->last_rx = 0;
+	}
+
+	// 3.欠载后数据到达, 记录欠载并重新缓冲, 目标深度已经随迟到的数据增大
+	if (jb->state == JITTER_CONCEAL) {
+		jb->underruns++;
+		hist_add(&jb->underrun, jb->gap);
+		jb->state = JITTER_BUFFERING;
+	}
+
+	// 4.缓冲到目标深度, 或者第一帧已经等待了目标延迟(短语音)后开始播放
+	if (jb->state == JITTER_BUFFERING) {
+		if (depth < jb->target && now - head_rx < (uint64_t)jb->target * jb->frame_us) return JITTER_FILL;
+		jb->state = JITTER_PLAYING;
+	}
+
+	// 5.缓冲过深时丢弃静音帧, 减小延迟且听不出来
+	if (depth > jb->target + JITTER_SLACK_FRAMES && head_silent) {
+		jb->skips++;
+		jb->index++;
+		return JITTER_SKIP;
+	}
+
+	return JITTER_PLAY;
+}
+
+/**************************************************************************************
+ * * FunctionName   : jitter_played()
+ * * Description    : 队列中的一帧已播放, 更新抖动估计和目标深度
+ *                    每条消息的第一帧计算传输延迟d=接收时间-媒体时间, 相对最小延迟的
+ *                    增量为该消息的迟到时间, 目标深度按迟到时间峰值(缓慢衰减)计算
+ * * EntryParameter : jb,抖动缓冲, pcm,播放的数据, rx_us,接收时间, now,当前时间
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void jitter_played(struct jitter *jb, const int16_t *pcm, uint64_t rx_us, uint64_t now)
+{
+	int64_t d, late;
+
+	// 1.新消息的第一帧
+	if (rx_us != jb->last_rx) {
+		d = (int64_t)rx_us - (int64_t)jb->index * jb->frame_us;
+		if (jb->last_rx == 0 || d < jb->base) jb->base = d;
+		else jb->base += JITTER_DRIFT_US;
+		jb->last_rx = rx_us;
+
+		// 2.抖动峰值, 没有更大的迟到时缓慢衰减
+		late = d - jb->base;
+		if (late > jb->jitter) jb->jitter = late;
+		else jb->jitter -= jb->jitter >> 6;
+		hist_add(&jb->estimate, jb->jitter / 1000);
+
+		// 3.目标深度为抖动峰值加一帧余量
+		jb->target = (int)((jb->jitter + jb->frame_us - 1) / jb->frame_us) + 1;
+		if (jb->target < jb->min_frames) jb->target = jb->min_frames;
+		if (jb->target > jb->max_frames) jb->target = jb->max_frames;
+	}
+
+	jb->index++;
+	memcpy(jb->last, pcm, jb->samples * sizeof(int16_t));
+	hist_add(&jb->latency, (now - rx_us) / 1000);
+}
+
+/**************************************************************************************
+ * * FunctionName   : jitter_fill()
+ * * Description    : 生成补偿帧, 欠载开始时重复上一帧并淡出, 之后为静音
+ * * EntryParameter : jb,抖动缓冲
+ * * ReturnValue    : 返回补偿帧
+ * **************************************************************************************/
+int16_t *jitter_fill(struct jitter *jb)
+{
+	int i, from, to;
+	int total = JITTER_CONCEAL_FRAMES * jb->samples;
+
+	if (jb->state != JITTER_CONCEAL || jb->gap > JITTER_CONCEAL_FRAMES) {
+		memset(jb->fill, 0x00, jb->samples * sizeof(int16_t));
+		return jb->fill;
+	}
+
+	// 增益在JITTER_CONCEAL_FRAMES帧内从1线性降到0, 避免重复帧产生的周期性杂音
+	from = total - (jb->gap - 1) * jb->samples;
+	for (i = 0; i < jb->samples; i++) {
+		to = from - i;
+		jb->fill[i] = (int16_t)(jb->last[i] * to / total);
+	}
+
+	return jb->fill;
+}
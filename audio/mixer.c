@@ -0,0 +1,103 @@
+#include <math.h>
+#include "mixer.h"
+
+/**************************************************************************************
+* Description    : 向量操作定义, 每次处理8个采样
+*                  mixer_vadd   饱和相加
+*                  mixer_vscale 乘以Q15增益并四舍五入, 与标量(pcm * gain + 0x4000) >> 15相同
+*                  依次支持SSE2, NEON, 其他平台逐个采样处理
+**************************************************************************************/
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MIXER_BLOCK                     8
+typedef __m128i mixer_vec;
+
+static inline mixer_vec mixer_vload(const int16_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void mixer_vstore(int16_t *p, mixer_vec v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline mixer_vec mixer_vadd(mixer_vec a, mixer_vec b) { return _mm_adds_epi16(a, b); }
+
+// SSE2没有16位四舍五入乘法, 展开为32位乘积后移位再饱和窄化
+static inline mixer_vec mixer_vscale(mixer_vec v, int gain)
+{
+	__m128i g = _mm_set1_epi16((int16_t)gain);
+	__m128i lo = _mm_mullo_epi16(v, g);
+	__m128i hi = _mm_mulhi_epi16(v, g);
+	__m128i round = _mm_set1_epi32(0x4000);
+	__m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15);
+	__m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15);
+
+	return _mm_packs_epi32(p0, p1);
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXER_BLOCK                     8
+typedef int16x8_t mixer_vec;
+
+static inline mixer_vec mixer_vload(const int16_t *p) { return vld1q_s16(p); }
+static inline void mixer_vstore(int16_t *p, mixer_vec v) { vst1q_s16(p, v); }
+static inline mixer_vec mixer_vadd(mixer_vec a, mixer_vec b) { return vqaddq_s16(a, b); }
+static inline mixer_vec mixer_vscale(mixer_vec v, int gain) { return vqrdmulhq_s16(v, vdupq_n_s16((int16_t)gain)); }
+#else
+#define MIXER_BLOCK                     0
+#endif
+
+/**************************************************************************************
+ * * FunctionName   : mixer_sat()
+ * * Description    : 饱和到16位
+ * * EntryParameter : v,32位值
+ * * ReturnValue    : 返回16位值
+ * **************************************************************************************/
+static inline int16_t mixer_sat(int32_t v)
+{
+	if (v > INT16_MAX) return INT16_MAX;
+	if (v < INT16_MIN) return INT16_MIN;
+
+	return (int16_t)v;
+}
+
+/**************************************************************************************
+ * * FunctionName   : mixer_scale_add()
+ * * Description    : 一帧乘以增益后饱和累加到混音结果, acc = sat(acc + pcm * gain)
+ *                    增益为MIXER_UNITY时直接饱和相加, 单路播放时结果与原始数据相同
+ * * EntryParameter : acc,混音结果, pcm,一帧数据, gain,Q15增益, n,采样数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void mixer_scale_add(int16_t *acc, const int16_t *pcm, int gain, int n)
+{
+	int i = 0;
+
+	if (gain <= 0) return;
+
+#if MIXER_BLOCK
+	// 1.向量处理整块
+	if (gain >= MIXER_UNITY) {
+		for (; i + MIXER_BLOCK <= n; i += MIXER_BLOCK) {
+			mixer_vstore(acc + i, mixer_vadd(mixer_vload(acc + i), mixer_vload(pcm + i)));
+		}
+	} else {
+		for (; i + MIXER_BLOCK <= n; i += MIXER_BLOCK) {
+			mixer_vstore(acc + i, mixer_vadd(mixer_vload(acc + i), mixer_vscale(mixer_vload(pcm + i), gain)));
+		}
+	}
+#endif
+
+	// 2.剩余采样
+	if (gain >= MIXER_UNITY) {
+		for (; i < n; i++) acc[i] = mixer_sat(acc[i] + pcm[i]);
+	} else {
+		for (; i < n; i++) acc[i] = mixer_sat(acc[i] + ((pcm[i] * gain + 0x4000) >> 15));
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : mixer_gain_db()
+ * * Description    : 分贝转换为Q15增益, 不大于0dB
+ * * EntryParameter : db,分贝
+ * * ReturnValue    : 返回Q15增益
+ * **************************************************************************************/
+int mixer_gain_db(int db)
+{
+	if (db >= 0) return MIXER_UNITY;
+
+	return (int)(MIXER_UNITY * pow(10.0, db / 20.0) + 0.5);
+}
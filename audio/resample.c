@@ -0,0 +1,218 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "resample.h"
+
+/**************************************************************************************
+* Description    : 向量点积, 每次处理8个采样, 16位乘积累加到32位
+*                  依次支持SSE2, NEON, 其他平台逐个采样处理, 结果与标量完全相同
+**************************************************************************************/
+#if defined(__SSE2__)
+#include <emmintrin.h>
+static inline int32_t resample_dot(const int16_t *x, const int16_t *c)
+{
+	int i;
+	__m128i acc = _mm_setzero_si128();
+
+	for (i = 0; i < RESAMPLE_TAPS; i += 8) {
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(x + i)),
+					_mm_loadu_si128((const __m128i *)(c + i))));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(acc);
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+static inline int32_t resample_dot(const int16_t *x, const int16_t *c)
+{
+	int i;
+	int16x8_t xv, cv;
+	int32x2_t sum;
+	int32x4_t acc = vdupq_n_s32(0);
+
+	for (i = 0; i < RESAMPLE_TAPS; i += 8) {
+		xv = vld1q_s16(x + i);
+		cv = vld1q_s16(c + i);
+		acc = vmlal_s16(acc, vget_low_s16(xv), vget_low_s16(cv));
+		acc = vmlal_s16(acc, vget_high_s16(xv), vget_high_s16(cv));
+	}
+	sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	sum = vpadd_s32(sum, sum);
+
+	return vget_lane_s32(sum, 0);
+}
+#else
+static inline int32_t resample_dot(const int16_t *x, const int16_t *c)
+{
+	int i;
+	int32_t acc = 0;
+
+	for (i = 0; i < RESAMPLE_TAPS; i++) acc += x[i] * c[i];
+
+	return acc;
+}
+#endif
+
+/**************************************************************************************
+ * * FunctionName   : resample_gcd()
+ * * Description    : 最大公约数
+ * * EntryParameter : a,b,正整数
+ * * ReturnValue    : 返回最大公约数
+ * **************************************************************************************/
+static int resample_gcd(int a, int b)
+{
+	int t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/**************************************************************************************
+ * * FunctionName   : resample_design()
+ * * Description    : 生成各相位的Q15系数, 原型滤波器工作在插值后的采样率,
+ *                    每个相位单独归一化为直流增益1, 避免输出中出现相位间的纹波
+ * * EntryParameter : rs,采样率转换
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void resample_design(struct resampler *rs)
+{
+	int p, j, k, n = RESAMPLE_TAPS * rs->up;
+	int sum, peak;
+	double t, h, fc, center = (n - 1) / 2.0;
+	double phase[RESAMPLE_TAPS];
+	double norm;
+	int16_t *c;
+
+	// 截止频率(周期/采样)为较低采样率的奈奎斯特频率乘以RESAMPLE_CUTOFF
+	fc = 0.5 * RESAMPLE_CUTOFF / (rs->up > rs->down ? rs->up : rs->down);
+
+	for (p = 0; p < rs->up; p++) {
+		// 1.相位p使用原型滤波器的第p, p+up, p+2up...个系数
+		norm = 0;
+		for (j = 0; j < RESAMPLE_TAPS; j++) {
+			k = p + j * rs->up;
+			t = k - center;
+			h = t == 0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t);
+			h *= 0.42 - 0.5 * cos(2 * M_PI * k / (n - 1)) + 0.08 * cos(4 * M_PI * k / (n - 1));
+			phase[j] = h;
+			norm += h;
+		}
+
+		// 2.倒序存放, 与输入窗口按地址顺序做点积, 舍入误差加到最大的系数上
+		c = rs->coef + p * RESAMPLE_TAPS;
+		sum = 0;
+		peak = 0;
+		for (j = 0; j < RESAMPLE_TAPS; j++) {
+			k = RESAMPLE_TAPS - 1 - j;
+			c[k] = (int16_t)lrint(phase[j] / norm * 32768.0);
+			sum += c[k];
+			if (c[k] > c[peak]) peak = k;
+		}
+		t = c[peak] + 32768 - sum;
+		c[peak] = t > 32767 ? 32767 : (int16_t)t;
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : resampler_init()
+ * * Description    : 初始化采样率转换, 按加Blackman窗的sinc生成各相位系数, 运行中不再分配内存
+ * * EntryParameter : rs,采样率转换, in_rate,输入采样率, out_rate,输出采样率, frame_ms,帧长(ms)
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int resampler_init(struct resampler *rs, int in_rate, int out_rate, int frame_ms)
+{
+	int g;
+
+	memset(rs, 0, sizeof(struct resampler));
+	if (in_rate <= 0 || out_rate <= 0 || in_rate * frame_ms % 1000 || out_rate * frame_ms % 1000) return -1;
+
+	rs->in_samples = in_rate * frame_ms / 1000;
+	rs->out_samples = out_rate * frame_ms / 1000;
+	g = resample_gcd(in_rate, out_rate);
+	rs->up = out_rate / g;
+	rs->down = in_rate / g;
+	if (in_rate == out_rate) return 0;
+
+	// 1.各相位系数和历史采样一次分配
+	rs->coef = (int16_t *)malloc(rs->up * RESAMPLE_TAPS * sizeof(int16_t));
+	rs->hist = (int16_t *)calloc(RESAMPLE_TAPS - 1 + rs->in_samples, sizeof(int16_t));
+	if (rs->coef == NULL || rs->hist == NULL) {
+		resampler_free(rs);
+		return -1;
+	}
+
+	// 2.生成系数
+	resample_design(rs);
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : resampler_free()
+ * * Description    : 释放采样率转换
+ * * EntryParameter : rs,采样率转换
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void resampler_free(struct resampler *rs)
+{
+	free(rs->coef);
+	free(rs->hist);
+	rs->coef = NULL;
+	rs->hist = NULL;
+}
+
+/**************************************************************************************
+ * * FunctionName   : resampler_reset()
+ * * Description    : 清除历史采样, 新的一段语音开始时调用
+ * * EntryParameter : rs,采样率转换
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void resampler_reset(struct resampler *rs)
+{
+	if (rs->hist) memset(rs->hist, 0x00, (RESAMPLE_TAPS - 1) * sizeof(int16_t));
+}
+
+/**************************************************************************************
+ * * FunctionName   : resampler_process()
+ * * Description    : 转换一帧, 采样率相同时直接复制
+ *                    第n个输出采样对应输入位置n*down/up, 使用相位(n*down)%up的系数
+ * * EntryParameter : rs,采样率转换, in,in_samples个输入采样, out,out_samples个输出采样
+ * * ReturnValue    : 返回输出采样数
+ * **************************************************************************************/
+int resampler_process(struct resampler *rs, const int16_t *in, int16_t *out)
+{
+	int n, pos = 0, phase = 0;
+	int32_t acc;
+
+	if (rs->coef == NULL) {
+		memcpy(out, in, rs->out_samples * sizeof(int16_t));
+		return rs->out_samples;
+	}
+
+	// 1.输入接在历史采样之后, 输入位置i的窗口为hist[i]~hist[i+RESAMPLE_TAPS-1]
+	memcpy(rs->hist + RESAMPLE_TAPS - 1, in, rs->in_samples * sizeof(int16_t));
+
+	// 2.逐个输出采样做点积, 位置和相位增量计算, 不用除法
+	for (n = 0; n < rs->out_samples; n++) {
+		acc = (resample_dot(rs->hist + pos, rs->coef + phase * RESAMPLE_TAPS) + 0x4000) >> 15;
+		out[n] = acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : (int16_t)acc;
+
+		phase += rs->down;
+		while (phase >= rs->up) {
+			phase -= rs->up;
+			pos++;
+		}
+	}
+
+	// 3.保留本帧末尾的采样作为下一帧的历史
+	memmove(rs->hist, rs->hist + rs->in_samples, (RESAMPLE_TAPS - 1) * sizeof(int16_t));
+
+	return rs->out_samples;
+}
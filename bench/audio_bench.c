@@ -0,0 +1,557 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <syslog.h>
+#include "id.h"
+#include "pbserial.h"
+#include "config.h"
+#include "hist.h"
+#include "audio_codec.h"
+#include "audio_dsp.h"
+#include <protobuf-c/data.pb-c.h>
+
+/**************************************************************************************
+* Description    : 基准测试配置, 与audio.c一致: 8k采样, 20ms帧, 每包8000字节原始PCM
+**************************************************************************************/
+#define BENCH_RATE                      8000
+#define BENCH_SAMPLES                   160
+#define BENCH_FRAME_US                  20000
+#define BENCH_TX_FRAMES                 25
+#define BENCH_FRAMES                    3000         // 单步测试的帧数(60s语音)
+#define BENCH_ECHO_DELAY                320          // 模拟回声路径延迟(40ms)
+#define BENCH_SECONDS                   10           // 整个音频模块实时运行的时间
+#define BENCH_HEADROOM                  (sizeof(struct transport) + 4 * (1 + PB_VARINT_MAX))
+#define BENCH_CONFIG                    "/tmp/audio_bench.conf"
+#define BENCH_CAPTURE                   "/tmp/audio_bench.wav"
+#define BENCH_PLAYBACK                  "/tmp/audio_bench_play.wav"
+#define BENCH_PLAY_FRAMES               100          // 单路原始PCM播放检查的帧数(2s)
+
+int _debug = 0;
+
+static int16_t near_pcm[BENCH_FRAMES * BENCH_SAMPLES];     // 近端语音(录音)
+static int16_t far_pcm[BENCH_FRAMES * BENCH_SAMPLES];      // 远端语音(播放, 回声参考)
+static int16_t play_pcm[BENCH_PLAY_FRAMES * BENCH_SAMPLES]; // 下行播放检查数据, 没有静音帧
+static struct id_proto *audio_proto = NULL;               // audio.c注册的音频协议
+
+/**************************************************************************************
+* Description    : 整个音频模块运行时上报的录音统计, 由packages_send_inplace()在发送线程中更新
+**************************************************************************************/
+static struct {
+	uint64_t open_us;                         // 开始录音的时间, 第k帧在open_us+(k+1)*20ms采集完成
+	unsigned long frames;                     // 已上报的帧数
+	unsigned long packets;                    // 已上报的包数
+	unsigned long bytes;                      // 已上报的录音数据长度
+	struct hist latency;                      // 每包第一帧从采集完成到发送的延迟
+} tx;
+
+/**************************************************************************************
+* FunctionName   : id_register()
+* Description    : 替代pbserial.c的协议注册, 只记录音频协议
+* EntryParameter : id,指向id相关数据信息
+* ReturnValue    : 返回0
+**************************************************************************************/
+int id_register(struct id_proto *id)
+{
+	if (id->id == AUDIO_ID) audio_proto = id;
+
+	return 0;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_count_frames()
+* Description    : 计算一包录音中的帧数, SPEEX模式为记录格式, 原始PCM每帧320字节
+* EntryParameter : audio,录音消息
+* ReturnValue    : 返回帧数
+**************************************************************************************/
+static unsigned long bench_count_frames(Audio *audio)
+{
+	size_t pos = 0;
+	unsigned long frames = 0;
+	uint8_t *data = audio->data.data;
+
+	if (!audio->has_codec || audio->codec == CODEC__RAW) return audio->data.len / (BENCH_SAMPLES * 2);
+
+	while (pos + AUDIO_REC_HEAD <= audio->data.len) {
+		if (data[pos] == AUDIO_REC_SILENCE) frames += data[pos + 2] | (data[pos + 3] << 8);
+		else frames++;
+		pos += AUDIO_REC_HEAD + data[pos + 1];
+	}
+
+	return frames;
+}
+
+/**************************************************************************************
+* FunctionName   : packages_send()
+* Description    : 替代pbserial.c的串口发送, 解析上报的录音并统计采集到发送的延迟
+* EntryParameter : fd,串口句柄, id,数据ID, data,protobuf数据, len,数据长度
+* ReturnValue    : 返回长度
+**************************************************************************************/
+int packages_send(int fd, uint8_t id, char *data, int len)
+{
+	Subid *msg;
+	Audio *audio;
+	uint64_t now = monotonic_us();
+	uint64_t captured;
+
+	msg = subid__unpack(NULL, len, (uint8_t *)data);
+	if (msg == NULL || id != AUDIO_ID || msg->n_subdata < 1) goto out;
+	audio = audio__unpack(NULL, msg->subdata[0].len, msg->subdata[0].data);
+	if (audio == NULL) goto out;
+
+	captured = tx.open_us + (tx.frames + 1) * BENCH_FRAME_US;
+	hist_add(&tx.latency, now > captured ? now - captured : 0);
+	tx.frames += bench_count_frames(audio);
+	tx.bytes += audio->data.len;
+	tx.packets++;
+	audio__free_unpacked(audio, NULL);
+out:
+	if (msg) subid__free_unpacked(msg, NULL);
+
+	return len;
+}
+
+/**************************************************************************************
+* FunctionName   : packages_send_inplace()
+* Description    : 替代pbserial.c的串口发送, audio.c的上报在缓冲区中打包后由此发送
+* EntryParameter : fd,串口句柄, id,数据ID, tdata,传输头部及之后的数据, len,数据长度
+* ReturnValue    : 返回长度
+**************************************************************************************/
+int packages_send_inplace(int fd, uint8_t id, struct transport *tdata, int len)
+{
+	return packages_send(fd, id, (char *)tdata->data, len);
+}
+
+/**************************************************************************************
+* FunctionName   : bench_cpu_us()
+* Description    : 获取进程CPU时间
+* EntryParameter : None
+* ReturnValue    : 返回微秒
+**************************************************************************************/
+static uint64_t bench_cpu_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_now_ns()
+* Description    : 获取单调时间
+* EntryParameter : None
+* ReturnValue    : 返回纳秒
+**************************************************************************************/
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_voice()
+* Description    : 生成类似语音的信号: 基音及谐波, 按音节(200ms有声/150ms无声)调制, 加低电平噪声
+* EntryParameter : pcm,输出, n,采样数, pitch,基音频率, seed,随机数种子
+* ReturnValue    : None
+**************************************************************************************/
+static void bench_voice(int16_t *pcm, int n, double pitch, unsigned int seed)
+{
+	int i, h;
+	double t, env, v;
+
+	srand(seed);
+	for (i = 0; i < n; i++) {
+		t = (double)i / BENCH_RATE;
+		env = fmod(t, 0.35) < 0.2 ? sin(M_PI * fmod(t, 0.35) / 0.2) : 0;
+		v = 0;
+		for (h = 1; h <= 8; h++) v += sin(2 * M_PI * pitch * h * t) / h;
+		pcm[i] = (int16_t)(4000 * env * v + (rand() % 200 - 100));
+	}
+}
+
+/**************************************************************************************
+* FunctionName   : bench_load()
+* Description    : 生成近端和远端语音, 录音为近端语音加延迟衰减的远端语音(回声)
+*                  指定WAV文件时近端语音从文件读取(PCM 16位单声道, 跳过44字节文件头)
+* EntryParameter : path,可选WAV文件
+* ReturnValue    : 成功返回0, 失败返回-1
+**************************************************************************************/
+static int bench_load(const char *path)
+{
+	int i;
+	FILE *fp;
+	size_t n = 0;
+
+	bench_voice(far_pcm, BENCH_FRAMES * BENCH_SAMPLES, 180, 2);
+	if (path == NULL) {
+		bench_voice(near_pcm, BENCH_FRAMES * BENCH_SAMPLES, 120, 1);
+	} else {
+		fp = fopen(path, "rb");
+		if (fp == NULL) {
+			perror(path);
+			return -1;
+		}
+		fseek(fp, 44, SEEK_SET);
+		n = fread(near_pcm, sizeof(int16_t), BENCH_FRAMES * BENCH_SAMPLES, fp);
+		fclose(fp);
+		if (n < BENCH_SAMPLES) return -1;
+		for (i = n; i < BENCH_FRAMES * BENCH_SAMPLES; i++) near_pcm[i] = near_pcm[i % n];
+	}
+
+	for (i = BENCH_ECHO_DELAY; i < BENCH_FRAMES * BENCH_SAMPLES; i++) {
+		near_pcm[i] = (int16_t)(near_pcm[i] / 2 + far_pcm[i - BENCH_ECHO_DELAY] / 2);
+	}
+
+	return 0;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_write_wav()
+* Description    : 录音写入WAV文件, 作为整个音频模块运行时file设备的录音
+* EntryParameter : path,文件路径
+* ReturnValue    : 成功返回0, 失败返回-1
+**************************************************************************************/
+static int bench_write_wav(const char *path)
+{
+	FILE *fp;
+	uint32_t len = sizeof(near_pcm);
+	uint32_t riff = len + 36, fmt_len = 16, rate = BENCH_RATE, byte_rate = BENCH_RATE * 2;
+	uint16_t pcm = 1, channels = 1, align = 2, bits = 16;
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+	fwrite("RIFF", 1, 4, fp); fwrite(&riff, 4, 1, fp); fwrite("WAVE", 1, 4, fp);
+	fwrite("fmt ", 1, 4, fp); fwrite(&fmt_len, 4, 1, fp);
+	fwrite(&pcm, 2, 1, fp); fwrite(&channels, 2, 1, fp); fwrite(&rate, 4, 1, fp);
+	fwrite(&byte_rate, 4, 1, fp); fwrite(&align, 2, 1, fp); fwrite(&bits, 2, 1, fp);
+	fwrite("data", 1, 4, fp); fwrite(&len, 4, 1, fp);
+	fwrite(near_pcm, 1, len, fp);
+	fclose(fp);
+
+	return 0;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_pack()
+* Description    : 与response_rec_data()相同, 在录音数据前后直接写入protobuf头部, 不发送
+* EntryParameter : record,录音状态, codec,编码方式, data,录音数据(前后预留空间), len,长度
+* ReturnValue    : 返回打包后的长度
+**************************************************************************************/
+static int bench_pack(int record, int codec, uint8_t *data, int len)
+{
+	int tail = 0, alen = 0, slen = 0;
+	uint8_t audio[2 * (1 + PB_VARINT_MAX)];
+	uint8_t subid[2 * (1 + PB_VARINT_MAX)];
+
+	if (codec != CODEC__RAW) {
+		data[len] = PB_KEY(3, PB_WIRE_VARINT);
+		tail = 1 + pack_varint(codec, data + len + 1);
+	}
+	audio[alen++] = PB_KEY(1, PB_WIRE_VARINT);
+	alen += pack_varint(record, audio + alen);
+	audio[alen++] = PB_KEY(2, PB_WIRE_BYTES);
+	alen += pack_varint(len, audio + alen);
+	subid[slen++] = PB_KEY(1, PB_WIRE_VARINT);
+	slen += pack_varint(IOC__DATA, subid + slen);
+	subid[slen++] = PB_KEY(2, PB_WIRE_BYTES);
+	slen += pack_varint(alen + len + tail, subid + slen);
+
+	memcpy(data - alen - slen, subid, slen);
+	memcpy(data - alen, audio, alen);
+
+	return slen + alen + len + tail;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_print()
+* Description    : 输出一个阶段的每帧耗时
+* EntryParameter : h,耗时直方图(纳秒)
+* ReturnValue    : None
+**************************************************************************************/
+static void bench_print(struct hist *h)
+{
+	if (h->count == 0) return;
+
+	printf("  %-22s p50 %8.1f us  p99 %8.1f us  max %8.1f us  (n=%lu)\n", h->name,
+			hist_percentile(h, 500) / 1e3, hist_percentile(h, 990) / 1e3, h->max / 1e3, h->count);
+}
+
+/**************************************************************************************
+* FunctionName   : bench_stages()
+* Description    : 不按实时节奏逐帧运行各处理阶段, 统计每阶段耗时和CPU余量
+*                  SPEEX: 回声消除, 噪声抑制(VAD), 编码, 打包; RAW: 拷贝, 打包
+* EntryParameter : record,录音模式CODEC__SPEEX/CODEC__RAW, dsp,语音处理, enc,上行编码器
+* ReturnValue    : None
+**************************************************************************************/
+static void bench_stages(int record, struct audio_dsp *dsp, struct audio_encoder *enc)
+{
+	int k, ret, ops = 0, frames = 0;
+	int codec = record == CODEC__SPEEX ? enc->codec : CODEC__RAW;
+	uint64_t t0, t1, frame_start;
+	int16_t out[BENCH_SAMPLES];
+	static uint8_t slot[BENCH_HEADROOM + BENCH_TX_FRAMES * (BENCH_SAMPLES * 2 + AUDIO_REC_HEAD) + 1 + PB_VARINT_MAX];
+	uint8_t *buf = slot + BENCH_HEADROOM;
+	struct hist echo, pre, encode, copy, pack, total;
+
+	hist_init(&echo, "speex_echo_cancellation", "ns", 0);
+	hist_init(&pre, "speex_preprocess_run", "ns", 0);
+	hist_init(&encode, "audio_encode", "ns", 0);
+	hist_init(&copy, "copy", "ns", 0);
+	hist_init(&pack, "response_rec_data pack", "ns", 0);
+	hist_init(&total, "total per frame", "ns", 0);
+
+	for (k = 0; k < BENCH_FRAMES; k++) {
+		frame_start = bench_now_ns();
+
+		// 1.语音处理和编码
+		if (record == CODEC__SPEEX) {
+			t0 = bench_now_ns();
+			speex_echo_cancellation(dsp->e_st, near_pcm + k * BENCH_SAMPLES, far_pcm + k * BENCH_SAMPLES, out);
+			t1 = bench_now_ns();
+			hist_add(&echo, t1 - t0);
+			speex_preprocess_run(dsp->d_st, out);
+			t0 = bench_now_ns();
+			hist_add(&pre, t0 - t1);
+			if (codec == CODEC__RAW) {
+				memcpy(buf + ops, out, sizeof(out));
+				ops += sizeof(out);
+			} else {
+				ret = audio_encode(enc, out, buf + ops + AUDIO_REC_HEAD, AUDIO_REC_MAXLEN);
+				buf[ops] = AUDIO_REC_VOICE;
+				buf[ops + 1] = ret > 0 ? ret : 0;
+				ops += AUDIO_REC_HEAD + buf[ops + 1];
+			}
+			hist_add(&encode, bench_now_ns() - t0);
+		} else {
+			t0 = bench_now_ns();
+			memcpy(buf + ops, near_pcm + k * BENCH_SAMPLES, BENCH_SAMPLES * 2);
+			ops += BENCH_SAMPLES * 2;
+			hist_add(&copy, bench_now_ns() - t0);
+		}
+
+		// 2.满一包时打包
+		if (++frames >= BENCH_TX_FRAMES) {
+			t0 = bench_now_ns();
+			bench_pack(record, codec, buf, ops);
+			hist_add(&pack, bench_now_ns() - t0);
+			ops = frames = 0;
+		}
+		hist_add(&total, bench_now_ns() - frame_start);
+	}
+
+	printf("%s stages (%d frames, codec %d):\n", record == CODEC__SPEEX ? "CODEC__SPEEX" : "CODEC__RAW", BENCH_FRAMES, codec);
+	bench_print(&echo);
+	bench_print(&pre);
+	bench_print(&encode);
+	bench_print(&copy);
+	bench_print(&pack);
+	bench_print(&total);
+	printf("  cpu per 20ms frame: avg %.2f%%, p99 %.2f%%, headroom %.2f%% at p99\n",
+			total.sum / (double)total.count / (BENCH_FRAME_US * 10.0),
+			hist_percentile(&total, 990) / (BENCH_FRAME_US * 10.0),
+			100.0 - hist_percentile(&total, 990) / (BENCH_FRAME_US * 10.0));
+}
+
+/**************************************************************************************
+* FunctionName   : bench_set_record()
+* Description    : 通过音频协议处理函数设置录音状态, 与MPU下发的请求相同
+* EntryParameter : record,录音状态
+* ReturnValue    : None
+**************************************************************************************/
+static void bench_set_record(int record)
+{
+	int len;
+	char *buf;
+	Subid msg = SUBID__INIT;
+	Audio message = AUDIO__INIT;
+	ProtobufCBinaryData pdata;
+
+	message.record = record;
+	pdata.len = audio__get_packed_size(&message);
+	pdata.data = malloc(pdata.len);
+	audio__pack(&message, pdata.data);
+	msg.id = IOC__SET;
+	msg.n_subdata = 1;
+	msg.subdata = &pdata;
+	len = subid__get_packed_size(&msg);
+	buf = malloc(len);
+	subid__pack(&msg, (uint8_t *)buf);
+
+	audio_proto->handler(-1, buf, len, monotonic_us());
+	free(pdata.data);
+	free(buf);
+}
+
+/**************************************************************************************
+* FunctionName   : bench_play_send()
+* Description    : 通过音频协议处理函数下发一条单路原始PCM语音, 缺省音量和优先级
+* EntryParameter : None
+* ReturnValue    : None
+**************************************************************************************/
+static void bench_play_send(void)
+{
+	int i, len;
+	char *buf;
+	Subid msg = SUBID__INIT;
+	Audio message = AUDIO__INIT;
+	ProtobufCBinaryData pdata;
+
+	// 满幅随机数据没有静音帧, 抖动缓冲不会丢弃, 增益不是1.0时大幅值采样会改变
+	srand(3);
+	for (i = 0; i < BENCH_PLAY_FRAMES * BENCH_SAMPLES; i++) play_pcm[i] = (int16_t)(rand() % 65536 - 32768) | 1;
+
+	message.has_data = 1;
+	message.data.data = (uint8_t *)play_pcm;
+	message.data.len = sizeof(play_pcm);
+	pdata.len = audio__get_packed_size(&message);
+	pdata.data = malloc(pdata.len);
+	audio__pack(&message, pdata.data);
+	msg.id = IOC__DATA;
+	msg.n_subdata = 1;
+	msg.subdata = &pdata;
+	len = subid__get_packed_size(&msg);
+	buf = malloc(len);
+	subid__pack(&msg, (uint8_t *)buf);
+
+	audio_proto->handler(-1, buf, len, monotonic_us());
+	free(pdata.data);
+	free(buf);
+}
+
+/**************************************************************************************
+* FunctionName   : bench_play_check()
+* Description    : 检查单路原始PCM播放结果与下发的数据逐采样相同(音量和压低增益都为1.0)
+* EntryParameter : path,file设备的播放输出文件
+* ReturnValue    : 相同返回0, 否则返回-1
+**************************************************************************************/
+static int bench_play_check(const char *path)
+{
+	int i;
+	FILE *fp;
+	int16_t s;
+	long start = 0;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	// 1.跳过文件头和开始播放前的静音
+	fseek(fp, 44, SEEK_SET);
+	while (fread(&s, sizeof(s), 1, fp) == 1 && s == 0) start++;
+
+	// 2.逐采样比较
+	for (i = 0; i < BENCH_PLAY_FRAMES * BENCH_SAMPLES; i++) {
+		if (i > 0 && fread(&s, sizeof(s), 1, fp) != 1) break;
+		if (s != play_pcm[i]) break;
+	}
+	fclose(fp);
+
+	if (i < BENCH_PLAY_FRAMES * BENCH_SAMPLES) {
+		printf("single stream RAW playback: MISMATCH at sample %d (%d != %d)\n", i, s, play_pcm[i]);
+		return -1;
+	}
+	printf("single stream RAW playback: %d samples bit exact, starts at sample %ld\n", i, start);
+
+	return 0;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_engine()
+* Description    : 按实时节奏运行整个音频模块(I/O, DSP, 发送线程), file设备循环读取录音,
+*                  统计采集到发送的延迟和进程CPU占用
+* EntryParameter : record,录音模式, seconds,运行时间
+* ReturnValue    : None
+**************************************************************************************/
+static void bench_engine(int record, int seconds)
+{
+	uint64_t wall, cpu;
+
+	memset(&tx, 0, sizeof(tx));
+	hist_init(&tx.latency, "capture to tx", "us", 0);
+
+	wall = monotonic_us();
+	cpu = bench_cpu_us();
+	tx.open_us = monotonic_us();
+	bench_set_record(record);
+	sleep(seconds);
+	bench_set_record(CODEC__NONE);
+	usleep(200000);
+	wall = monotonic_us() - wall;
+	cpu = bench_cpu_us() - cpu;
+
+	printf("%s engine (%ds real time): %lu packets, %lu frames, %.1f kbit/s\n",
+			record == CODEC__SPEEX ? "CODEC__SPEEX" : "CODEC__RAW", seconds, tx.packets, tx.frames,
+			tx.frames ? tx.bytes * 8.0 / (tx.frames * BENCH_FRAME_US / 1e6) / 1000 : 0);
+	printf("  capture to tx           p50 %8.1f ms  p99 %8.1f ms  max %8.1f ms\n",
+			hist_percentile(&tx.latency, 500) / 1e3, hist_percentile(&tx.latency, 990) / 1e3,
+			tx.latency.max / 1e3);
+	printf("  process cpu %.2f%%, headroom %.2f%%\n", cpu * 100.0 / wall, 100.0 - cpu * 100.0 / wall);
+}
+
+/**************************************************************************************
+* FunctionName   : main()
+* Description    : 音频基准测试: 使用audio_init()相同的speex配置, 逐阶段统计每帧耗时,
+*                  然后用file设备实时运行整个音频模块, 统计采集到发送的延迟,
+*                  并检查单路原始PCM播放与下发数据逐采样相同
+* EntryParameter : argv[1],可选录音WAV文件(8k 16位单声道, "-"为合成语音), argv[2],可选实时运行秒数(0不运行)
+* ReturnValue    : 错误码
+**************************************************************************************/
+int main(int argc, char *argv[])
+{
+	FILE *fp;
+	struct audio_dsp dsp;
+	struct audio_encoder enc;
+	const char *path = argc > 1 && strcmp(argv[1], "-") != 0 ? argv[1] : NULL;
+	int seconds = argc > 2 ? atoi(argv[2]) : BENCH_SECONDS;
+
+	openlog("audio_bench", LOG_PERROR, LOG_USER);
+	setlogmask(LOG_UPTO(LOG_WARNING));
+	if (bench_load(path) < 0) return 1;
+
+	// 1.各处理阶段耗时
+	if (audio_dsp_init(&dsp, BENCH_SAMPLES, BENCH_RATE) < 0
+			|| audio_encoder_init(&enc, CODEC__SPEEX, BENCH_SAMPLES, SPEEX_QUALITY) < 0) {
+		fprintf(stderr, "speex init failed\n");
+		return 1;
+	}
+	bench_stages(CODEC__SPEEX, &dsp, &enc);
+	bench_stages(CODEC__RAW, &dsp, &enc);
+	audio_encoder_free(&enc);
+	audio_dsp_free(&dsp);
+
+	// 2.整个音频模块, file设备, 不输出周期统计
+	if (seconds <= 0 || audio_proto == NULL) return 0;
+	if (bench_write_wav(BENCH_CAPTURE) < 0) return 1;
+	fp = fopen(BENCH_CONFIG, "w");
+	if (fp == NULL) {
+		perror(BENCH_CONFIG);
+		return 1;
+	}
+	fprintf(fp, "[AUDIO]\ndevice=file\ncapture_file=%s\nplay_file=%s\nuplink_codec=speex\ndtx=0\n[STATS]\ninterval=0\n",
+			BENCH_CAPTURE, BENCH_PLAYBACK);
+	fclose(fp);
+	config_load(BENCH_CONFIG);
+
+	if (audio_proto->init(-1) < 0) {
+		fprintf(stderr, "audio init failed\n");
+		return 1;
+	}
+	bench_engine(CODEC__SPEEX, seconds);
+	bench_engine(CODEC__RAW, seconds);
+
+	// 3.单路播放, 播放设备关闭后检查输出文件
+	bench_play_send();
+	usleep(BENCH_PLAY_FRAMES * BENCH_FRAME_US + 500000);
+	audio_proto->deinit(-1);
+
+	return bench_play_check(BENCH_PLAYBACK) < 0 ? 1 : 0;
+}
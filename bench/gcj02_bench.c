@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "gcj02.h"
+
+/**************************************************************************************
+* Description    : 基准测试配置
+**************************************************************************************/
+#define BENCH_POINTS                    65536
+#define BENCH_MIN_SECONDS               1.0
+#define BENCH_EARTH_RADIUS              6378137.0
+
+typedef void (*bench_convert)(const struct geo_point *in, struct geo_point *out, int n);
+
+static struct geo_point points[BENCH_POINTS];
+static struct geo_point result[BENCH_POINTS];
+static struct geo_point expect[BENCH_POINTS];
+
+/**************************************************************************************
+* FunctionName   : bench_now()
+* Description    : 获取单调时间
+* EntryParameter : None
+* ReturnValue    : 返回秒
+**************************************************************************************/
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**************************************************************************************
+* FunctionName   : ref_batch()
+* Description    : 参考实现逐点转换
+* EntryParameter : in,坐标数组, out,输出数组, n,个数
+* ReturnValue    : None
+**************************************************************************************/
+static void ref_batch(const struct geo_point *in, struct geo_point *out, int n)
+{
+	int k;
+
+	for (k = 0; k < n; k++) wgs84_to_gcj02_ref(&in[k], &out[k]);
+}
+
+/**************************************************************************************
+* FunctionName   : bench_run()
+* Description    : 循环转换全部坐标, 直到运行时间超过BENCH_MIN_SECONDS
+* EntryParameter : name,名字, convert,转换函数
+* ReturnValue    : 返回每秒转换坐标数
+**************************************************************************************/
+static double bench_run(const char *name, bench_convert convert)
+{
+	long rounds = 0;
+	double start, elapsed;
+
+	start = bench_now();
+	do {
+		convert(points, result, BENCH_POINTS);
+		rounds++;
+		elapsed = bench_now() - start;
+	} while (elapsed < BENCH_MIN_SECONDS);
+
+	printf("%-22s %12.0f points/s  (%.1f ns/point)\n", name,
+			rounds * BENCH_POINTS / elapsed, elapsed * 1e9 / (rounds * BENCH_POINTS));
+
+	return rounds * BENCH_POINTS / elapsed;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_accuracy()
+* Description    : 比较查表实现与参考实现的误差
+* EntryParameter : None
+* ReturnValue    : 返回最大误差(米)
+**************************************************************************************/
+static double bench_accuracy(void)
+{
+	int k;
+	double dn, de, err, sum = 0, max = 0;
+
+	ref_batch(points, expect, BENCH_POINTS);
+	wgs84_to_gcj02_batch(points, result, BENCH_POINTS);
+
+	for (k = 0; k < BENCH_POINTS; k++) {
+		dn = (result[k].lat - expect[k].lat) * M_PI / 180 * BENCH_EARTH_RADIUS;
+		de = (result[k].lon - expect[k].lon) * M_PI / 180 * BENCH_EARTH_RADIUS
+			* cos(expect[k].lat * M_PI / 180);
+		err = sqrt(dn * dn + de * de);
+		sum += err;
+		if (err > max) max = err;
+	}
+	printf("error vs reference: mean %.4f m, max %.4f m\n", sum / BENCH_POINTS, max);
+
+	return max;
+}
+
+/**************************************************************************************
+* FunctionName   : main()
+* Description    : WGS84->GCJ02基准测试: 三角函数参考实现与查表插值实现对比,
+*                  坐标在中国范围内均匀随机分布
+* EntryParameter : None
+* ReturnValue    : 错误码
+**************************************************************************************/
+int main(void)
+{
+	int k;
+	double before, after;
+
+	srand(20261019);
+	for (k = 0; k < BENCH_POINTS; k++) {
+		points[k].lat = 0.83 + (55.82 - 0.83) * rand() / RAND_MAX;
+		points[k].lon = 72.01 + (137.83 - 72.01) * rand() / RAND_MAX;
+	}
+	gcj02_init();
+
+	// 误差超过0.1米认为查表实现有问题
+	if (bench_accuracy() > 0.1) {
+		fprintf(stderr, "table transform differs from reference\n");
+		return 1;
+	}
+
+	before = bench_run("trigonometric (ref)", ref_batch);
+	after = bench_run("table (batch)", wgs84_to_gcj02_batch);
+	printf("speedup %.2fx\n", after / before);
+
+	return 0;
+}
@@ -0,0 +1,468 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gps.h"
+#include "minmea.h"
+#include "nmea_scan.h"
+
+/**************************************************************************************
+* Description    : 基准测试配置
+**************************************************************************************/
+#define BENCH_DEFAULT_CORPUS            "bench/nmea_corpus.nmea"
+#define BENCH_MAX_SENTENCES             65536
+#define BENCH_MIN_SECONDS               1.0
+
+/**************************************************************************************
+* Description    : 解析结果, 用于比较新旧解析器输出是否一致
+**************************************************************************************/
+union bench_frame {
+	struct minmea_sentence_rmc rmc;
+	struct minmea_sentence_gga gga;
+	struct minmea_sentence_gsa gsa;
+	struct minmea_sentence_gsv gsv;
+	struct minmea_sentence_vtg vtg;
+};
+
+typedef enum minmea_sentence_id (*bench_parser)(union bench_frame *frame, const char *sentence);
+
+static int n_sentences = 0;
+static char *sentences[BENCH_MAX_SENTENCES];
+static int stream_len = 0;
+static uint8_t *stream;
+
+/**************************************************************************************
+* FunctionName   : bench_now()
+* Description    : 获取单调时间
+* EntryParameter : None
+* ReturnValue    : 返回秒
+**************************************************************************************/
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**************************************************************************************
+* FunctionName   : ref_sentence_id()
+* Description    : 原始实现: 通过minmea_scan("t")获取报文ID
+* EntryParameter : sentence,NMEA报文
+* ReturnValue    : 返回报文ID
+**************************************************************************************/
+static enum minmea_sentence_id ref_sentence_id(const char *sentence)
+{
+	char type[6];
+
+	if (!minmea_check(sentence, false)) return MINMEA_INVALID;
+	if (!minmea_scan(sentence, "t", type)) return MINMEA_INVALID;
+
+	if (!strcmp(type+2, "RMC")) return MINMEA_SENTENCE_RMC;
+	if (!strcmp(type+2, "GGA")) return MINMEA_SENTENCE_GGA;
+	if (!strcmp(type+2, "GSA")) return MINMEA_SENTENCE_GSA;
+	if (!strcmp(type+2, "GSV")) return MINMEA_SENTENCE_GSV;
+	if (!strcmp(type+2, "VTG")) return MINMEA_SENTENCE_VTG;
+
+	return MINMEA_UNKNOWN;
+}
+
+/**************************************************************************************
+* FunctionName   : ref_parse()
+* Description    : 原始实现: 通过minmea_scan()格式串解析五种报文
+* EntryParameter : frame,解析结果, sentence,NMEA报文
+* ReturnValue    : 返回报文ID, 解析失败返回MINMEA_INVALID
+**************************************************************************************/
+static enum minmea_sentence_id ref_parse(union bench_frame *frame, const char *sentence)
+{
+	char type[6], c[5];
+	int d[3];
+	enum minmea_sentence_id id = ref_sentence_id(sentence);
+
+	switch (id) {
+	case MINMEA_SENTENCE_RMC:
+		if (!minmea_scan(sentence, "tTcfdfdffDfd", type, &frame->rmc.time, &c[0],
+				&frame->rmc.latitude, &d[0], &frame->rmc.longitude, &d[1],
+				&frame->rmc.speed, &frame->rmc.course, &frame->rmc.date,
+				&frame->rmc.variation, &d[2]))
+			return MINMEA_INVALID;
+		frame->rmc.valid = (c[0] == 'A');
+		frame->rmc.latitude.value *= d[0];
+		frame->rmc.longitude.value *= d[1];
+		frame->rmc.variation.value *= d[2];
+		break;
+	case MINMEA_SENTENCE_GGA:
+		if (!minmea_scan(sentence, "tTfdfdiiffcfcf_", type, &frame->gga.time,
+				&frame->gga.latitude, &d[0], &frame->gga.longitude, &d[1],
+				&frame->gga.fix_quality, &frame->gga.satellites_tracked,
+				&frame->gga.hdop, &frame->gga.altitude, &frame->gga.altitude_units,
+				&frame->gga.height, &frame->gga.height_units, &frame->gga.dgps_age))
+			return MINMEA_INVALID;
+		frame->gga.latitude.value *= d[0];
+		frame->gga.longitude.value *= d[1];
+		break;
+	case MINMEA_SENTENCE_GSA:
+		if (!minmea_scan(sentence, "tciiiiiiiiiiiiifff", type, &frame->gsa.mode,
+				&frame->gsa.fix_type, &frame->gsa.sats[0], &frame->gsa.sats[1],
+				&frame->gsa.sats[2], &frame->gsa.sats[3], &frame->gsa.sats[4],
+				&frame->gsa.sats[5], &frame->gsa.sats[6], &frame->gsa.sats[7],
+				&frame->gsa.sats[8], &frame->gsa.sats[9], &frame->gsa.sats[10],
+				&frame->gsa.sats[11], &frame->gsa.pdop, &frame->gsa.hdop,
+				&frame->gsa.vdop))
+			return MINMEA_INVALID;
+		break;
+	case MINMEA_SENTENCE_GSV:
+		if (!minmea_scan(sentence, "tiii;iiiiiiiiiiiiiiii", type,
+				&frame->gsv.total_msgs, &frame->gsv.msg_nr, &frame->gsv.total_sats,
+				&frame->gsv.sats[0].nr, &frame->gsv.sats[0].elevation,
+				&frame->gsv.sats[0].azimuth, &frame->gsv.sats[0].snr,
+				&frame->gsv.sats[1].nr, &frame->gsv.sats[1].elevation,
+				&frame->gsv.sats[1].azimuth, &frame->gsv.sats[1].snr,
+				&frame->gsv.sats[2].nr, &frame->gsv.sats[2].elevation,
+				&frame->gsv.sats[2].azimuth, &frame->gsv.sats[2].snr,
+				&frame->gsv.sats[3].nr, &frame->gsv.sats[3].elevation,
+				&frame->gsv.sats[3].azimuth, &frame->gsv.sats[3].snr))
+			return MINMEA_INVALID;
+		break;
+	case MINMEA_SENTENCE_VTG:
+		if (!minmea_scan(sentence, "tfcfcfcfc;c", type,
+				&frame->vtg.true_track_degrees, &c[0],
+				&frame->vtg.magnetic_track_degrees, &c[1],
+				&frame->vtg.speed_knots, &c[2], &frame->vtg.speed_kph, &c[3], &c[4]))
+			return MINMEA_INVALID;
+		if (c[0] != 'T' || c[1] != 'M' || c[2] != 'N' || c[3] != 'K')
+			return MINMEA_INVALID;
+		frame->vtg.faa_mode = (enum minmea_faa_mode)c[4];
+		break;
+	default:
+		break;
+	}
+
+	return id;
+}
+
+/**************************************************************************************
+* FunctionName   : fast_parse()
+* Description    : 当前实现: minmea_sentence_id() + 专用解析函数
+* EntryParameter : frame,解析结果, sentence,NMEA报文
+* ReturnValue    : 返回报文ID, 解析失败返回MINMEA_INVALID
+**************************************************************************************/
+static enum minmea_sentence_id fast_parse(union bench_frame *frame, const char *sentence)
+{
+	bool ok = true;
+	enum minmea_sentence_id id = minmea_sentence_id(sentence, false);
+
+	switch (id) {
+	case MINMEA_SENTENCE_RMC: ok = minmea_parse_rmc(&frame->rmc, sentence); break;
+	case MINMEA_SENTENCE_GGA: ok = minmea_parse_gga(&frame->gga, sentence); break;
+	case MINMEA_SENTENCE_GSA: ok = minmea_parse_gsa(&frame->gsa, sentence); break;
+	case MINMEA_SENTENCE_GSV: ok = minmea_parse_gsv(&frame->gsv, sentence); break;
+	case MINMEA_SENTENCE_VTG: ok = minmea_parse_vtg(&frame->vtg, sentence); break;
+	default: break;
+	}
+
+	return ok ? id : MINMEA_INVALID;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_run()
+* Description    : 循环解析语料, 直到运行时间超过BENCH_MIN_SECONDS
+* EntryParameter : name,名字, parser,解析函数
+* ReturnValue    : 返回每秒解析报文数
+**************************************************************************************/
+static double bench_run(const char *name, bench_parser parser)
+{
+	int i;
+	long rounds = 0, parsed = 0;
+	double start, elapsed;
+	union bench_frame frame;
+
+	start = bench_now();
+	do {
+		for (i = 0; i < n_sentences; i++) {
+			if (parser(&frame, sentences[i]) > MINMEA_UNKNOWN) parsed++;
+		}
+		rounds++;
+		elapsed = bench_now() - start;
+	} while (elapsed < BENCH_MIN_SECONDS);
+
+	printf("%-22s %10.0f sentences/s  (%ld parsed in %.2fs)\n",
+			name, rounds * n_sentences / elapsed, parsed, elapsed);
+
+	return rounds * n_sentences / elapsed;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_verify()
+* Description    : 校验新旧解析器对每条报文输出完全一致
+* EntryParameter : None
+* ReturnValue    : 返回不一致的报文个数
+**************************************************************************************/
+static int bench_verify(void)
+{
+	int i, errors = 0;
+	enum minmea_sentence_id a, b;
+	union bench_frame fa, fb;
+
+	for (i = 0; i < n_sentences; i++) {
+		memset(&fa, 0, sizeof(fa));
+		memset(&fb, 0, sizeof(fb));
+		a = ref_parse(&fa, sentences[i]);
+		b = fast_parse(&fb, sentences[i]);
+		if (a != b || (a > MINMEA_UNKNOWN && memcmp(&fa, &fb, sizeof(fa)) != 0)) {
+			fprintf(stderr, "mismatch: %s\n", sentences[i]);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+/**************************************************************************************
+* FunctionName   : ref_scan()
+* Description    : 原始实现: 逐字节查找'$'和'*', 逐字节计算校验(gps_begin/gps_end/minmea_checksum),
+*                  报文中有0x20~0x7e以外的字节时无效
+* EntryParameter : 同nmea_scan()
+* ReturnValue    : 返回找到的完整报文个数
+**************************************************************************************/
+static int ref_scan(const uint8_t *data, int len, struct nmea_span *spans, int max, int *consumed)
+{
+	int p = 0, e, n = 0;
+	uint8_t csum, bad;
+
+	while (n < max) {
+		// 1.查找'$'
+		while (p < len && data[p] != '$') p++;
+		if (p >= len) break;
+
+		// 2.查找'*'或者回车换行, 同时计算校验
+		for (e = p + 1, csum = 0, bad = 0; e < len; e++) {
+			if (data[e] == '$' || data[e] == '*' || data[e] == '\r' || data[e] == '\n') break;
+			if (data[e] < 0x20 || data[e] > 0x7e) bad = 1;
+			csum ^= data[e];
+		}
+		if (e >= len) break;
+		if (data[e] == '$') {
+			p = e;
+			continue;
+		}
+		if (data[e] == '*') {
+			if (e + 2 >= len) break;
+			char hex[3] = { data[e + 1], data[e + 2], 0 };
+			char *end;
+			long expect = strtol(hex, &end, 16);
+			spans[n].len = e + 3 - p;
+			spans[n].valid = *end == 0 && expect == csum && spans[n].len <= GPS_NMEA_MAXLEN && !bad;
+		} else {
+			spans[n].len = e - p;
+			spans[n].valid = spans[n].len <= GPS_NMEA_MAXLEN && !bad;
+		}
+		spans[n++].offset = p;
+		p = e + 1;
+	}
+	*consumed = p < len ? p : len;
+
+	return n;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_scan_verify()
+* Description    : 校验向量化扫描与逐字节扫描输出一致
+* EntryParameter : None
+* ReturnValue    : 返回不一致的报文个数
+**************************************************************************************/
+static int bench_scan_verify(void)
+{
+	int pos, n, m, k, ca, cb, errors = 0;
+	struct nmea_span a[64], b[64];
+
+	for (pos = 0; pos < stream_len; pos += ca) {
+		n = nmea_scan(stream + pos, stream_len - pos, a, 64, &ca);
+		m = ref_scan(stream + pos, stream_len - pos, b, 64, &cb);
+		if (n != m) {
+			errors++;
+			break;
+		}
+		for (k = 0; k < n; k++) {
+			if (a[k].offset != b[k].offset || a[k].len != b[k].len || a[k].valid != b[k].valid) {
+				fprintf(stderr, "scan mismatch at %d\n", pos + a[k].offset);
+				errors++;
+			}
+		}
+		if (n < 64) break;
+		ca = a[n - 1].offset + a[n - 1].len;
+	}
+
+	return errors;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_feed_bytes()
+* Description    : 逐字节输入流解析器, 除'$'外都走逐字节解析路径
+* EntryParameter : data,NMEA数据, len,数据长度
+* ReturnValue    : 返回输出的报文个数
+**************************************************************************************/
+static int bench_feed_bytes(const uint8_t *data, int len)
+{
+	int i, n = 0;
+	struct nmea_stream s;
+
+	nmea_stream_init(&s, NULL, NULL);
+	for (i = 0; i < len; i++) n += nmea_stream_feed(&s, data + i, 1, 0);
+
+	return n;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_printable_verify()
+* Description    : 同一条含不可打印字节(校验码正确)的报文分别整段输入(向量化扫描及其尾部)
+*                  和逐字节输入, 两条路径都应丢弃; 报文在缓冲区中的偏移和不可打印字节的位置
+*                  遍历向量块内和块尾的各种情况, 同时比较nmea_scan()与逐字节扫描
+* EntryParameter : None
+* ReturnValue    : 返回不一致的次数
+**************************************************************************************/
+static int bench_printable_verify(void)
+{
+	static const char body[] = "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,";
+	static const uint8_t bytes[] = { 'A', 0x01, 0x1f, 0x7f, 0x80, 0xff };
+	int off, pos, k, csum, len, whole, single, errors = 0, ca, cb, n, m, j;
+	uint8_t buf[256];
+	struct nmea_span a[4], b[4];
+	struct nmea_stream s;
+
+	for (off = 0; off < 40; off++) {
+		for (pos = 0; pos < (int)sizeof(body) - 1; pos += 3) {
+			for (k = 0; k < (int)sizeof(bytes); k++) {
+				// 1.生成报文, pos处替换为测试字节, 校验码按替换后的内容计算
+				memset(buf, ' ', off);
+				buf[off] = '$';
+				memcpy(buf + off + 1, body, sizeof(body) - 1);
+				buf[off + 1 + pos] = bytes[k];
+				for (j = 0, csum = 0; j < (int)sizeof(body) - 1; j++) csum ^= buf[off + 1 + j];
+				len = off + 1 + sizeof(body) - 1;
+				len += sprintf((char *)buf + len, "*%02X\r\n", csum);
+
+				// 2.整段输入和逐字节输入的结果一致, 'A'应输出, 其他应丢弃
+				nmea_stream_init(&s, NULL, NULL);
+				whole = nmea_stream_feed(&s, buf, len, 0);
+				single = bench_feed_bytes(buf, len);
+				if (whole != single || whole != (bytes[k] == 'A')) {
+					fprintf(stderr, "printable mismatch: offset %d pos %d byte 0x%02x, whole %d bytewise %d\n",
+							off, pos, bytes[k], whole, single);
+					errors++;
+				}
+
+				// 3.向量化扫描与逐字节扫描一致
+				n = nmea_scan(buf, len, a, 4, &ca);
+				m = ref_scan(buf, len, b, 4, &cb);
+				if (n != m || n != 1 || a[0].valid != b[0].valid) {
+					fprintf(stderr, "printable scan mismatch: offset %d pos %d byte 0x%02x\n", off, pos, bytes[k]);
+					errors++;
+				}
+			}
+		}
+	}
+
+	return errors;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_scan()
+* Description    : 报文分割与校验基准测试
+* EntryParameter : name,名字, scan,扫描函数
+* ReturnValue    : 返回每秒处理的报文数
+**************************************************************************************/
+static double bench_scan(const char *name,
+		int (*scan)(const uint8_t *, int, struct nmea_span *, int, int *))
+{
+	int pos, n, consumed;
+	long rounds = 0, found = 0;
+	double start, elapsed;
+	struct nmea_span spans[64];
+
+	start = bench_now();
+	do {
+		for (pos = 0; pos < stream_len; ) {
+			n = scan(stream + pos, stream_len - pos, spans, 64, &consumed);
+			found += n;
+			if (n < 64) break;
+			pos += consumed;
+		}
+		rounds++;
+		elapsed = bench_now() - start;
+	} while (elapsed < BENCH_MIN_SECONDS);
+
+	printf("%-22s %10.0f sentences/s  %8.1f MB/s\n", name, found / elapsed,
+			rounds * stream_len / elapsed / 1e6);
+
+	return found / elapsed;
+}
+
+/**************************************************************************************
+* FunctionName   : bench_load()
+* Description    : 加载NMEA语料, 每行一条报文
+* EntryParameter : path,语料路径
+* ReturnValue    : 返回报文个数
+**************************************************************************************/
+static int bench_load(const char *path)
+{
+	FILE *fp;
+	char line[256];
+	size_t len;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) && n_sentences < BENCH_MAX_SENTENCES) {
+		len = strcspn(line, "\r\n");
+		if (len == 0 || line[0] != '$') continue;
+		line[len] = '\0';
+		sentences[n_sentences++] = strdup(line);
+	}
+	fclose(fp);
+
+	// 同时保留原始字节流(回车换行结尾), 用于报文分割测试
+	stream = malloc((GPS_NMEA_MAXLEN + 2) * n_sentences + 1);
+	for (len = 0; len < (size_t)n_sentences; len++) {
+		stream_len += sprintf((char *)stream + stream_len, "%s\r\n", sentences[len]);
+	}
+
+	return n_sentences;
+}
+
+/**************************************************************************************
+* FunctionName   : main()
+* Description    : NMEA基准测试: minmea_scan()格式串解析与专用解析对比,
+*                  逐字节分割校验与向量化分割校验对比
+* EntryParameter : argv[1],可选语料路径
+* ReturnValue    : 错误码
+**************************************************************************************/
+int main(int argc, char *argv[])
+{
+	double before, after;
+	const char *path = argc > 1 ? argv[1] : BENCH_DEFAULT_CORPUS;
+
+	if (bench_load(path) <= 0) return 1;
+	printf("corpus %s: %d sentences\n", path, n_sentences);
+
+	if (bench_verify() != 0) {
+		fprintf(stderr, "specialized parsers differ from minmea_scan()\n");
+		return 1;
+	}
+
+	before = bench_run("minmea_scan (before)", ref_parse);
+	after = bench_run("specialized (after)", fast_parse);
+	printf("speedup %.2fx\n", after / before);
+
+	if (bench_scan_verify() != 0 || bench_printable_verify() != 0) {
+		fprintf(stderr, "nmea_scan() differs from bytewise scan\n");
+		return 1;
+	}
+	before = bench_scan("bytewise scan", ref_scan);
+	after = bench_scan("nmea_scan", nmea_scan);
+	printf("speedup %.2fx\n", after / before);
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "hist.h"
+#include "resample.h"
+
+/**************************************************************************************
+* Description    : 基准测试配置, 与audio.c一致: 20ms帧, codec和链路之间8k/16k转换
+**************************************************************************************/
+#define BENCH_FRAME_MS                  20
+#define BENCH_FRAMES                    3000         // 每种转换的帧数(60s语音)
+#define BENCH_TONE_FRAMES               50           // 频率响应测试的帧数(1s)
+#define BENCH_MAX_SAMPLES               (48000 / 50)
+
+int _debug = 0;
+static int16_t input[BENCH_MAX_SAMPLES];
+static int16_t output[BENCH_MAX_SAMPLES];
+static int16_t expect[BENCH_MAX_SAMPLES];
+
+/**************************************************************************************
+* FunctionName   : bench_now_ns()
+* Description    : 获取单调时间
+* EntryParameter : None
+* ReturnValue    : 返回纳秒
+**************************************************************************************/
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**************************************************************************************
+* FunctionName   : ref_process()
+* Description    : 参考实现, 与resampler_process()相同的系数逐个采样计算, 用于校验向量实现
+*                  禁止编译器自动向量化, 作为标量实现的耗时基准
+* EntryParameter : rs,采样率转换(使用系数和历史采样, 不修改), in,一帧输入, out,输出
+* ReturnValue    : None
+**************************************************************************************/
+static void __attribute__((optimize("no-tree-vectorize"))) ref_process(const struct resampler *rs, const int16_t *in, int16_t *out)
+{
+	int n, j, pos, phase;
+	int32_t acc;
+	int16_t x[RESAMPLE_TAPS - 1 + BENCH_MAX_SAMPLES];
+
+	memcpy(x, rs->hist, (RESAMPLE_TAPS - 1) * sizeof(int16_t));
+	memcpy(x + RESAMPLE_TAPS - 1, in, rs->in_samples * sizeof(int16_t));
+	for (n = 0; n < rs->out_samples; n++) {
+		pos = n * rs->down / rs->up;
+		phase = n * rs->down % rs->up;
+		acc = 0;
+		for (j = 0; j < RESAMPLE_TAPS; j++) acc += x[pos + j] * rs->coef[phase * RESAMPLE_TAPS + j];
+		acc = (acc + 0x4000) >> 15;
+		out[n] = acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : (int16_t)acc;
+	}
+}
+
+/**************************************************************************************
+* FunctionName   : bench_signal()
+* Description    : 生成一帧测试信号: 几个语音频段的正弦叠加噪声, 幅度接近满量程
+* EntryParameter : rate,采样率, samples,采样数, frame,帧序号, pcm,输出
+* ReturnValue    : None
+**************************************************************************************/
+static void bench_signal(int rate, int samples, int frame, int16_t *pcm)
+{
+	int i;
+	double t;
+
+	for (i = 0; i < samples; i++) {
+		t = (double)(frame * samples + i) / rate;
+		pcm[i] = (int16_t)(9000 * sin(2 * M_PI * 300 * t) + 9000 * sin(2 * M_PI * 1100 * t)
+				+ 6000 * sin(2 * M_PI * 2900 * t) + (rand() % 8001 - 4000));
+	}
+}
+
+/**************************************************************************************
+* FunctionName   : bench_tone()
+* Description    : 正弦输入的输出电平, 跳过前几帧的滤波器延迟
+* EntryParameter : in_rate,out_rate,采样率, freq,频率(Hz)
+* ReturnValue    : 返回输出与输入的电平差(dB)
+**************************************************************************************/
+static double bench_tone(int in_rate, int out_rate, double freq)
+{
+	int k, i;
+	double in_energy = 0, out_energy = 0;
+	struct resampler rs;
+
+	if (resampler_init(&rs, in_rate, out_rate, BENCH_FRAME_MS) < 0) return 0;
+	for (k = 0; k < BENCH_TONE_FRAMES; k++) {
+		for (i = 0; i < rs.in_samples; i++) {
+			input[i] = (int16_t)(16000 * sin(2 * M_PI * freq * (k * rs.in_samples + i) / in_rate));
+		}
+		resampler_process(&rs, input, output);
+		if (k < 5) continue;
+		for (i = 0; i < rs.in_samples; i++) in_energy += (double)input[i] * input[i] / rs.in_samples;
+		for (i = 0; i < rs.out_samples; i++) out_energy += (double)output[i] * output[i] / rs.out_samples;
+	}
+	resampler_free(&rs);
+
+	return 10 * log10((out_energy + 1e-9) / in_energy);
+}
+
+/**************************************************************************************
+* FunctionName   : bench_convert()
+* Description    : 测试一种转换: 与参考实现逐帧比较, 统计每帧耗时, 输出频率响应
+* EntryParameter : in_rate,out_rate,采样率
+* ReturnValue    : 结果与参考实现一致返回0, 否则返回-1
+**************************************************************************************/
+static int bench_convert(int in_rate, int out_rate)
+{
+	int k;
+	int mismatch = 0;
+	uint64_t t0, ref_ns = 0, simd_ns = 0;
+	double low = in_rate < out_rate ? in_rate : out_rate;
+	struct resampler rs;
+	struct hist frame;
+
+	if (resampler_init(&rs, in_rate, out_rate, BENCH_FRAME_MS) < 0) {
+		printf("%d -> %d Hz: init failed\n", in_rate, out_rate);
+		return -1;
+	}
+	hist_init(&frame, "resampler_process", "ns", 0);
+
+	// 1.逐帧与参考实现比较, 参考实现先运行(使用处理前的历史采样)
+	for (k = 0; k < BENCH_FRAMES; k++) {
+		bench_signal(in_rate, rs.in_samples, k, input);
+		t0 = bench_now_ns();
+		ref_process(&rs, input, expect);
+		ref_ns += bench_now_ns() - t0;
+
+		t0 = bench_now_ns();
+		resampler_process(&rs, input, output);
+		t0 = bench_now_ns() - t0;
+		simd_ns += t0;
+		hist_add(&frame, t0);
+
+		if (memcmp(output, expect, rs.out_samples * sizeof(int16_t))) mismatch++;
+	}
+
+	// 2.耗时和频率响应, 阻带为较低采样率奈奎斯特频率以上(抽取时混叠, 插值时镜像)
+	printf("%d -> %d Hz (%d -> %d samples, %d phases x %d taps):\n", in_rate, out_rate,
+			rs.in_samples, rs.out_samples, rs.up, RESAMPLE_TAPS);
+	printf("  resampler_process      p50 %8.1f us  p99 %8.1f us  max %8.1f us  (n=%lu)\n",
+			hist_percentile(&frame, 500) / 1e3, hist_percentile(&frame, 990) / 1e3, frame.max / 1e3, frame.count);
+	printf("  average per frame      %8.2f us, scalar reference %8.2f us, speedup %.1fx\n",
+			simd_ns / 1e3 / BENCH_FRAMES, ref_ns / 1e3 / BENCH_FRAMES, simd_ns ? (double)ref_ns / simd_ns : 0);
+	printf("  cpu per 20ms frame     %8.3f%%\n", simd_ns / 1e3 / BENCH_FRAMES / (BENCH_FRAME_MS * 10.0));
+	printf("  passband  300 Hz %+6.2f dB, 1000 Hz %+6.2f dB, %.0f Hz %+6.2f dB\n", bench_tone(in_rate, out_rate, 300),
+			bench_tone(in_rate, out_rate, 1000), 0.375 * low, bench_tone(in_rate, out_rate, 0.375 * low));
+	if (in_rate > out_rate) {
+		printf("  alias     %.0f Hz %+6.1f dB\n", 0.75 * in_rate / 2, bench_tone(in_rate, out_rate, 0.75 * in_rate / 2));
+	}
+	printf("  bit exact with reference: %s (%d/%d frames differ)\n", mismatch ? "NO" : "yes", mismatch, BENCH_FRAMES);
+	resampler_free(&rs);
+
+	return mismatch ? -1 : 0;
+}
+
+/**************************************************************************************
+* FunctionName   : main()
+* Description    : 测试codec和链路之间的采样率转换
+* EntryParameter : None
+* ReturnValue    : 全部一致返回0
+**************************************************************************************/
+int main(void)
+{
+	int ret = 0;
+
+#if defined(__SSE2__)
+	printf("resampler: SSE2\n");
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	printf("resampler: NEON\n");
+#else
+	printf("resampler: scalar\n");
+#endif
+	ret |= bench_convert(8000, 16000);
+	ret |= bench_convert(16000, 8000);
+	ret |= bench_convert(16000, 48000);
+	ret |= bench_convert(48000, 16000);
+
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <syslog.h>
+#include "config.h"
+#include "pbserial.h"
+
+/**************************************************************************************
+* Description    : 定义配置项数量及长度
+**************************************************************************************/
+#define MAX_CONFIG_ITEMS                128
+#define MAX_CONFIG_NAME                 32
+#define MAX_CONFIG_VALUE                128
+
+/**************************************************************************************
+* Description    : 定义配置项结构
+**************************************************************************************/
+struct config_item {
+	char section[MAX_CONFIG_NAME];            // 配置段
+	char key[MAX_CONFIG_NAME];                // 配置名
+	char value[MAX_CONFIG_VALUE];             // 配置值
+};
+
+static int n_items = 0;                       // 当前配置项个数
+static struct config_item items[MAX_CONFIG_ITEMS];
+
+/**************************************************************************************
+ * * FunctionName   : config_trim()
+ * * Description    : 去掉字符串首尾空白
+ * * EntryParameter : str,指向字符串
+ * * ReturnValue    : 返回去掉空白后的字符串
+ * **************************************************************************************/
+static char *config_trim(char *str)
+{
+	char *end;
+
+	while (isspace((unsigned char)*str)) str++;
+	end = str + strlen(str);
+	while (end > str && isspace((unsigned char)end[-1])) end--;
+	*end = '\0';
+
+	return str;
+}
+
+/**************************************************************************************
+ * * FunctionName   : config_load()
+ * * Description    : 加载配置文件, 格式与AV2HP.conf一致([SECTION] key=value, #注释)
+ * * EntryParameter : path,配置文件路径
+ * * ReturnValue    : 返回加载的配置项个数或者错误码
+ * **************************************************************************************/
+int config_load(const char *path)
+{
+	FILE *fp;
+	char line[256];
+	char *p, *key, *value;
+	char section[MAX_CONFIG_NAME] = "";
+
+	fp = fopen(path, "r");
+	if (unlikely(fp == NULL)) {
+		syslog(LOG_NOTICE, "config %s not found, use defaults", path);
+		return -errno;
+	}
+
+	n_items = 0;
+	while (fgets(line, sizeof(line), fp) != NULL && n_items < MAX_CONFIG_ITEMS) {
+		p = config_trim(line);
+
+		// 1.跳过空行和注释
+		if (*p == '\0' || *p == '#' || *p == ';') continue;
+
+		// 2.配置段
+		if (*p == '[') {
+			key = strchr(p, ']');
+			if (key == NULL) continue;
+			*key = '\0';
+			snprintf(section, sizeof(section), "%s", config_trim(p + 1));
+			continue;
+		}
+
+		// 3.配置项
+		value = strchr(p, '=');
+		if (value == NULL) continue;
+		*value++ = '\0';
+		key = config_trim(p);
+		value = config_trim(value);
+
+		snprintf(items[n_items].section, MAX_CONFIG_NAME, "%s", section);
+		snprintf(items[n_items].key, MAX_CONFIG_NAME, "%s", key);
+		snprintf(items[n_items].value, MAX_CONFIG_VALUE, "%s", value);
+		n_items++;
+	}
+	fclose(fp);
+	DEBUG("config %s loaded %d items\n", path, n_items)
+
+	return n_items;
+}
+
+/**************************************************************************************
+ * * FunctionName   : config_get_string()
+ * * Description    : 获取字符串配置
+ * * EntryParameter : section,配置段, key,配置名, def,缺省值
+ * * ReturnValue    : 返回配置值，不存在时返回缺省值
+ * **************************************************************************************/
+const char *config_get_string(const char *section, const char *key, const char *def)
+{
+	int i;
+
+	for (i = 0; i < n_items; i++) {
+		if (strcasecmp(items[i].section, section) == 0 &&
+				strcasecmp(items[i].key, key) == 0) {
+			return items[i].value;
+		}
+	}
+
+	return def;
+}
+
+/**************************************************************************************
+ * * FunctionName   : config_get_int()
+ * * Description    : 获取整形配置
+ * * EntryParameter : section,配置段, key,配置名, def,缺省值
+ * * ReturnValue    : 返回配置值，不存在时返回缺省值
+ * **************************************************************************************/
+int config_get_int(const char *section, const char *key, int def)
+{
+	char *end = NULL;
+	long value;
+	const char *str = config_get_string(section, key, NULL);
+
+	if (str == NULL || *str == '\0') return def;
+
+	value = strtol(str, &end, 0);
+	if (end == str) return def;
+
+	return (int)value;
+}
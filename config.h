@@ -0,0 +1,35 @@
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include "pbserial.h"
+
+/**************************************************************************************
+* Description    : 默认配置文件路径
+**************************************************************************************/
+#define CONFIG_DEFAULT_FILE             "/etc/config/pbserial.conf"
+
+/**************************************************************************************
+ * * FunctionName   : config_load()
+ * * Description    : 加载配置文件, 格式与AV2HP.conf一致([SECTION] key=value, #注释)
+ * * EntryParameter : path,配置文件路径
+ * * ReturnValue    : 返回加载的配置项个数或者错误码
+ * **************************************************************************************/
+int config_load(const char *path);
+
+/**************************************************************************************
+ * * FunctionName   : config_get_string()
+ * * Description    : 获取字符串配置
+ * * EntryParameter : section,配置段, key,配置名, def,缺省值
+ * * ReturnValue    : 返回配置值，不存在时返回缺省值
+ * **************************************************************************************/
+const char *config_get_string(const char *section, const char *key, const char *def);
+
+/**************************************************************************************
+ * * FunctionName   : config_get_int()
+ * * Description    : 获取整形配置
+ * * EntryParameter : section,配置段, key,配置名, def,缺省值
+ * * ReturnValue    : 返回配置值，不存在时返回缺省值
+ * **************************************************************************************/
+int config_get_int(const char *section, const char *key, int def);
+
+#endif /* _CONFIG_H_ */
@@ -3,8 +3,18 @@
 #include "pbserial.h"
 #include "iav2hp.h"
 #include "minmea.h"
+#include "config.h"
+#include "socketcan.h"
+#include "hist.h"
+#include "nmea_local.h"
+#include "gps_predict.h"
+#include "gcj02.h"
 #include <time.h>
 #include <memory.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
 #include <protobuf-c/data.pb-c.h>
 
 /**************************************************************************************
@@ -20,6 +30,12 @@
 #define AV2_MSG_TYPE_RESERVED           (7)
 #define MAX_CAN_SIZE                    200
 #define MAX_CONTEXT_SIZE                100
+#define EMAPS_CAN_ID                    0x18F0F69F
+#define EMAPS_EPOCH_TIMEOUT             300         // 不完整历元缺省超时时间(ms)
+#define EMAPS_LOCAL_RETRY               1           // 本地NMEA数据源重新打开的间隔(s)
+#define EMAPS_LOCAL_BUFFER              1024        // 本地NMEA数据单次读取长度
+#define EMAPS_PREDICT_MAX               2000        // 缺省最长推算时间(ms), 超过后等待真实定位
+#define EMAPS_PREDICT_MIN_SPEED         0.5         // 低于该速度(m/s)时不推算
 
 /**************************************************************************************
 * Description    : 定义电子地图需要的结构和配置
@@ -28,72 +44,117 @@ typedef struct data_rain {
 	uint8_t m_buffer[8];
 }emaps_data;
 
+/**************************************************************************************
+* Description    : 定义电子地图CAN数据输出后端
+**************************************************************************************/
+struct emaps_output {
+	const char *name;                                // 后端名字，对应配置[EMAPS] output
+	int (*open)(void);                               // 打开后端
+	int (*queue)(int canid, uint8_t *data, int len); // 输出一帧CAN数据
+	int (*flush)(void);                              // 一次回调结束，发送缓存的数据
+	void (*close)(void);                             // 关闭后端
+};
+
 static int transport_fd = -1;
 static const char *config_file = "/etc/config/AV2HP.conf";
 
+static int can_fd = -1;                              // SocketCAN套接字
+static int n_batch = 0;                              // 待发送的CAN帧数
+static struct can_frame batch[SOCKETCAN_MAX_BATCH];  // 待发送的CAN帧
+static struct emaps_output *output = NULL;           // 当前输出后端
+static int coord_gcj02 = 0;                          // 输出GCJ02坐标给电子地图
+
+static struct nmea_stream gps_stream;                // NMEA流解析器
+static struct gps_epoch gps_epoch;                   // GNSS历元组装器
+static int epoch_timer = -1;                         // 不完整历元超时定时器
+static uint64_t epoch_armed = 0;                     // 定时器当前的超时时间
+static struct hist fix_age;                          // 定位数据输出时的数据年龄
+
+static const char *local_path = NULL;                // 本地NMEA数据源路径, NULL表示使用MCU转发的GPS
+static int local_baud = 9600;                        // 本地串口数据源波特率
+static int local_fd = -1;                            // 本地NMEA数据源句柄
+static int local_timer = -1;                         // 本地数据源重新打开定时器
+
+static int predict_timer = -1;                       // 位置推算定时器, -1表示不推算
+static uint64_t predict_period = 0;                  // 推算周期(us)
+static uint64_t predict_max = 0;                     // 最长推算时间(us)
+static av2hp_gpsInfo last_fix;                       // 最近一次真实定位
+static uint64_t last_fix_us = 0;                     // 最近一次真实定位的时间戳, 0表示没有
+static uint64_t last_push_us = 0;                    // 最近一次输出给电子地图的时间
+static struct hist predict_err;                      // 推算位置与下一个真实定位的误差
+
 /************************************************************************************** * 
  * * FunctionName   : get_gpsinfo()
  * * Description    : GPS数据解析成电子地图需要的格式
- * * EntryParameter : info,电子地图GPS数据结构, data,指向gps数据,len，指向数据长度
+ * * EntryParameter : info,电子地图GPS数据结构, gps,指向解析后的gps数据
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int get_gpsinfo(av2hp_gpsInfo *info, char *data, int len)
+static int get_gpsinfo(av2hp_gpsInfo *info, struct gpsinfo *gps)
 {
 	int i;
-	struct gpsinfo gps = {0};
+	struct gps_sat *sat;
+	struct gps_satview *view = gps->view;
 
-	gpsbuffer_to_gpsinfo(&gps, data, len);
-	
 	// 1.设置GPS数据状态
-	info->m_valid              = gps.rmc.valid;
+	info->m_valid              = gps->rmc.valid;
 
 	// 2.设置获取时间
-	info->m_dateTime.m_hours   = gps.rmc.time.hours;
-	info->m_dateTime.m_minutes = gps.rmc.time.minutes;
-	info->m_dateTime.m_seconds = gps.rmc.time.seconds;
-	info->m_dateTime.m_year    = gps.rmc.date.year+2000;
-	info->m_dateTime.m_month   = gps.rmc.date.month;
-	info->m_dateTime.m_day     = gps.rmc.date.day;
+	info->m_dateTime.m_hours   = gps->rmc.time.hours;
+	info->m_dateTime.m_minutes = gps->rmc.time.minutes;
+	info->m_dateTime.m_seconds = gps->rmc.time.seconds;
+	info->m_dateTime.m_year    = gps->rmc.date.year+2000;
+	info->m_dateTime.m_month   = gps->rmc.date.month;
+	info->m_dateTime.m_day     = gps->rmc.date.day;
 
-	// 3.设置时间戳
-	info->m_timestamp          = 0;
+	// 3.设置时间戳, 历元第一条报文的接收时间(单调时钟ms)
+	info->m_timestamp          = gps->rx_us / 1000;
 
-	// 4.设置位置信息
+	// 4.设置位置信息, 按配置转换为GCJ02坐标
 	info->m_pos.m_kind         = av2hp_coordinate_WGS84;
-	info->m_pos.m_lon          = minmea_tocoord(&gps.rmc.longitude);
-	info->m_pos.m_lat          = minmea_tocoord(&gps.rmc.latitude);
-	info->m_pos.m_alt          = minmea_tofloat(&gps.gga.altitude);
+	info->m_pos.m_lon          = minmea_tocoord(&gps->rmc.longitude);
+	info->m_pos.m_lat          = minmea_tocoord(&gps->rmc.latitude);
+	info->m_pos.m_alt          = minmea_tofloat(&gps->gga.altitude);
+	if (coord_gcj02 && gps->rmc.valid) {
+		struct geo_point point = { info->m_pos.m_lat, info->m_pos.m_lon };
+
+		wgs84_to_gcj02(&point, &point);
+		info->m_pos.m_kind     = av2hp_coordinate_GCJ02;
+		info->m_pos.m_lat      = point.lat;
+		info->m_pos.m_lon      = point.lon;
+	}
 
 	// 5.设置GPS方向（0-360）
-	info->m_orient             = minmea_tofloat(&gps.rmc.course);
+	info->m_orient             = minmea_tofloat(&gps->rmc.course);
 
-	// 6.设置GPS速度
+	// 6.设置GPS速度, 没有VTG时使用RMC的速度(节)
 	info->m_speed.m_unit       = av2hp_speedUnit_ms;
-	info->m_speed.m_value      = minmea_tofloat(&gps.vtg.speed_kph)/3.6;
+	if (gps->mask & GPS_MASK(MINMEA_SENTENCE_VTG))
+		info->m_speed.m_value  = minmea_tofloat(&gps->vtg.speed_kph)/3.6;
+	else
+		info->m_speed.m_value  = minmea_tofloat(&gps->rmc.speed)*0.514444;
 
 	// 7.GPS信号质量
 	info->m_gpsQuality = 1;
 
 	// 8.设置精度
-	info->m_hdop               = minmea_tofloat(&gps.gsa.hdop);
-	info->m_pdop               = minmea_tofloat(&gps.gsa.pdop);
-	info->m_vdop               = minmea_tofloat(&gps.gsa.vdop);
+	info->m_hdop               = minmea_tofloat(&gps->gsa.hdop);
+	info->m_pdop               = minmea_tofloat(&gps->gsa.pdop);
+	info->m_vdop               = minmea_tofloat(&gps->gsa.vdop);
 
-	// 9.设置当前卫星个数
-	info->m_satInViewNum       = gps.gsv[0].total_sats;
+	// 9.设置当前卫星个数(全部系统)
+	info->m_satInViewNum       = view ? view->count : 0;
 
-	// 10.含有信噪比的卫星数量
+	// 10.原始卫星数据, 只取信噪比最强的卫星, 列表随GSV增量维护, 不遍历整个卫星表
 	info->m_satNum             = 0;
-	for (i = 0; i < 12; i++){
-		if (gps.gsa.sats[i] > 0) info->m_satNum++;
-	}
-
-	// 11.原始卫星数据
-	for(i = 0; i < 20; i++) {
-		info->m_satellites[i].satId = gps.gsv[i/4].sats[i%4].nr;
-		info->m_satellites[i].elevation = gps.gsv[i/4].sats[i%4].elevation;
-		info->m_satellites[i].azimuth = gps.gsv[i/4].sats[i%4].azimuth;
-		info->m_satellites[i].SNRatio = gps.gsv[i/4].sats[i%4].snr;
+	for (i = 0; view && i < view->ntop; i++) {
+		sat = &view->sats[view->top[i]];
+		info->m_satellites[i].satId = sat->prn;
+		info->m_satellites[i].elevation = sat->elevation;
+		info->m_satellites[i].azimuth = sat->azimuth;
+		info->m_satellites[i].SNRatio = sat->snr;
+
+		// 11.含有信噪比的卫星数量, 列表按信噪比排序, 有效的卫星都在前面
+		if (sat->snr > 0) info->m_satNum++;
 	}
 
 	return 0;
@@ -137,6 +198,135 @@ static int emaps_can_send(int canid, char *data, int len)
 	return packages_send(transport_fd, EMAPS_ID, buffer, subid__get_packed_size(&msg));
 }
 
+/**************************************************************************************
+ * * FunctionName   : emaps_socketcan_open()
+ * * Description    : 打开SocketCAN输出后端
+ * * EntryParameter : None
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static int emaps_socketcan_open(void)
+{
+	const char *ifname = config_get_string("EMAPS", "can_device", "can0");
+
+	n_batch = 0;
+	can_fd = socketcan_open(ifname);
+
+	return can_fd < 0 ? -1 : 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_socketcan_flush()
+ * * Description    : 批量发送缓存的CAN帧
+ * * EntryParameter : None
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static int emaps_socketcan_flush(void)
+{
+	int ret = 0;
+
+	if (n_batch > 0) {
+		ret = socketcan_send_batch(can_fd, batch, n_batch);
+		n_batch = 0;
+	}
+
+	return ret < 0 ? ret : 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_socketcan_queue()
+ * * Description    : 缓存一帧CAN数据, 缓存满时发送
+ * * EntryParameter : canid,can数据id, data,指向电子地图CAN数据,len，指向数据长度
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static int emaps_socketcan_queue(int canid, uint8_t *data, int len)
+{
+	struct can_frame *frame = &batch[n_batch];
+
+	if (unlikely(len > CAN_MAX_DLEN)) len = CAN_MAX_DLEN;
+
+	// 1.扩展帧
+	frame->can_id = (canid & CAN_EFF_MASK) | CAN_EFF_FLAG;
+	frame->can_dlc = len;
+	memcpy(frame->data, data, len);
+
+	DEBUG("CAN queue %08X#%02X%02X%02X%02X%02X%02X%02X%02X\n",
+			canid, data[0],data[1],data[2],data[3],data[4],data[5],
+			data[6],data[7]);
+
+	// 2.缓存满了，立即发送
+	if (++n_batch >= SOCKETCAN_MAX_BATCH) {
+		return emaps_socketcan_flush();
+	}
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_socketcan_close()
+ * * Description    : 关闭SocketCAN输出后端
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void emaps_socketcan_close(void)
+{
+	socketcan_close(can_fd);
+	can_fd = -1;
+	n_batch = 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_serial_queue()
+ * * Description    : 通过串口protobuf发送一帧CAN数据到MCU
+ * * EntryParameter : canid,can数据id, data,指向电子地图CAN数据,len，指向数据长度
+ * * ReturnValue    : 返回错误码
+ * **************************************************************************************/
+static int emaps_serial_queue(int canid, uint8_t *data, int len)
+{
+	return emaps_can_send(canid, (char *)data, len);
+}
+
+/**************************************************************************************
+* Description    : 电子地图输出后端列表, 第一个为缺省后端
+**************************************************************************************/
+static struct emaps_output outputs[] = {
+	{
+		.name = "serial",
+		.queue = emaps_serial_queue,
+	},
+	{
+		.name = "socketcan",
+		.open = emaps_socketcan_open,
+		.queue = emaps_socketcan_queue,
+		.flush = emaps_socketcan_flush,
+		.close = emaps_socketcan_close,
+	},
+};
+
+/**************************************************************************************
+ * * FunctionName   : emaps_output_select()
+ * * Description    : 根据配置选择并打开输出后端, 打开失败时回退到串口
+ * * EntryParameter : None
+ * * ReturnValue    : 返回选中的后端
+ * **************************************************************************************/
+static struct emaps_output *emaps_output_select(void)
+{
+	size_t i;
+	const char *name = config_get_string("EMAPS", "output", outputs[0].name);
+
+	for (i = 0; i < sizeof(outputs)/sizeof(outputs[0]); i++) {
+		if (strcmp(outputs[i].name, name) != 0) continue;
+		if (outputs[i].open && outputs[i].open() < 0) {
+			syslog(LOG_ERR, "emaps output %s open failed, fallback to %s\n",
+					name, outputs[0].name);
+			break;
+		}
+		syslog(LOG_NOTICE, "emaps output %s\n", name);
+		return &outputs[i];
+	}
+
+	return &outputs[0];
+}
+
 /**************************************************************************************
  * * FunctionName   : emaps_callback()
  * * Description    : 电子地图回调函数
@@ -159,15 +349,15 @@ static int emaps_callback(const char *message, int *n)
 		DEBUG("AV2 MSG TYPE:%d\n", type);
 		switch(type) {
 		case AV2_MSG_TYPE_POSITION:
-			emaps_can_send(0x18F0F69F, p->m_buffer, 8);
+			output->queue(EMAPS_CAN_ID, p->m_buffer, 8);
 			break;
 		case AV2_MSG_TYPE_SEGMENT:
 			break;
 		case AV2_MSG_TYPE_STUB:
-			emaps_can_send(0x18F0F69F, p->m_buffer, 8);
+			output->queue(EMAPS_CAN_ID, p->m_buffer, 8);
 			break;
 		case AV2_MSG_TYPE_PROFILE_SHORT:
-			emaps_can_send(0x18F0F69F, p->m_buffer, 8);
+			output->queue(EMAPS_CAN_ID, p->m_buffer, 8);
 			break;
 		case AV2_MSG_TYPE_PROFILE_lONG:
 			break;
@@ -178,42 +368,280 @@ static int emaps_callback(const char *message, int *n)
 		p = p + 1;
 	}
 
+	// 批量发送本次回调的全部数据
+	if (output->flush) output->flush();
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_epoch_arm()
+ * * Description    : 按当前历元的超时时间设置定时器, 没有等待输出的历元时停止定时器
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void emaps_epoch_arm(void)
+{
+	struct itimerspec its;
+	uint64_t deadline = gps_epoch_deadline(&gps_epoch);
+
+	if (epoch_timer < 0 || deadline == epoch_armed) return;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = deadline / 1000000;
+	its.it_value.tv_nsec = (deadline % 1000000) * 1000;
+	timerfd_settime(epoch_timer, TFD_TIMER_ABSTIME, &its, NULL);
+	epoch_armed = deadline;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_epoch_timeout()
+ * * Description    : 不完整历元超时处理
+ * * EntryParameter : fd,定时器句柄, priv,未使用
+ * * ReturnValue    : 返回0
+ * **************************************************************************************/
+static int emaps_epoch_timeout(int fd, void *priv)
+{
+	uint64_t expired;
+
+	if (read(fd, &expired, sizeof(expired)) < 0) return 0;
+
+	epoch_armed = 0;
+	gps_epoch_poll(&gps_epoch, monotonic_us());
+	emaps_epoch_arm();
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_gps_fix()
+ * * Description    : 历元组装完成, 每个历元向电子地图输出一次定位数据
+ * * EntryParameter : gps,历元的GPS数据, priv,未使用
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void emaps_gps_fix(struct gpsinfo *gps, void *priv)
+{
+	av2hp_gpsInfo predicted;
+	av2hp_gpsInfo gpsinfo = {0x31};
+
+	get_gpsinfo(&gpsinfo, gps);
+	// 以调用Av2HP_setGpsInfo的时刻为准, 不包含库函数本身的耗时
+	last_push_us = monotonic_us();
+	Av2HP_setGpsInfo(&gpsinfo);
+
+	// 统计从串口接收到输出给电子地图的延迟
+	hist_add(&fix_age, last_push_us - gps->rx_us);
+
+	// 用上一个真实定位推算到本次定位的时刻, 统计推算误差(cm)
+	if (predict_timer < 0) return;
+	if (last_fix_us && last_fix.m_valid && gpsinfo.m_valid && gps->rx_us - last_fix_us <= predict_max) {
+		gps_predict(&last_fix, (gps->rx_us - last_fix_us) / 1000000.0, &predicted);
+		hist_add(&predict_err, (uint64_t)(gps_distance(&predicted, &gpsinfo) * 100));
+	}
+	last_fix = gpsinfo;
+	last_fix_us = gps->rx_us;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_predict()
+ * * Description    : 两次真实定位之间按航向和速度推算位置, 以更高的频率输出给电子地图
+ * * EntryParameter : fd,定时器句柄, priv,未使用
+ * * ReturnValue    : 返回0
+ * **************************************************************************************/
+static int emaps_predict(int fd, void *priv)
+{
+	uint64_t expired, now;
+	av2hp_gpsInfo predicted;
+
+	if (read(fd, &expired, sizeof(expired)) < 0) return 0;
+
+	// 1.没有有效定位, 或者真实定位太久没有更新, 不推算
+	now = monotonic_us();
+	if (!last_fix_us || !last_fix.m_valid || now - last_fix_us > predict_max) return 0;
+
+	// 2.刚输出过真实定位, 或者车辆基本静止, 不需要推算
+	if (now - last_push_us < predict_period / 2) return 0;
+	if (last_fix.m_speed.m_value < EMAPS_PREDICT_MIN_SPEED) return 0;
+
+	// 3.推算到当前时刻
+	gps_predict(&last_fix, (now - last_fix_us) / 1000000.0, &predicted);
+	predicted.m_timestamp = now / 1000;
+	Av2HP_setGpsInfo(&predicted);
+	last_push_us = now;
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_predict_init()
+ * * Description    : 按配置启动位置推算定时器, [GPS] predict_hz为0时不推算
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void emaps_predict_init(void)
+{
+	struct itimerspec its;
+	int hz = config_get_int("GPS", "predict_hz", 0);
+
+	last_fix_us = 0;
+	last_push_us = 0;
+	if (hz <= 0) return;
+
+	predict_period = 1000000 / hz;
+	predict_max = (uint64_t)config_get_int("GPS", "predict_max_ms", EMAPS_PREDICT_MAX) * 1000;
+	hist_init(&predict_err, "gps predict error", "cm", config_get_int("STATS", "interval", 60));
+
+	predict_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (predict_timer < 0 || watch_add(predict_timer, emaps_predict, NULL) < 0) {
+		syslog(LOG_ERR, "emaps predict timer failed\n");
+		if (predict_timer >= 0) close(predict_timer);
+		predict_timer = -1;
+		return;
+	}
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = its.it_interval.tv_sec = predict_period / 1000000;
+	its.it_value.tv_nsec = its.it_interval.tv_nsec = (predict_period % 1000000) * 1000;
+	if (timerfd_settime(predict_timer, 0, &its, NULL) < 0) {
+		syslog(LOG_ERR, "emaps predict timer failed\n");
+		watch_del(predict_timer);
+		close(predict_timer);
+		predict_timer = -1;
+		return;
+	}
+	syslog(LOG_NOTICE, "emaps predict %d Hz\n", hz);
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_nmea_sentence()
+ * * Description    : NMEA流解析器输出的完整报文
+ * * EntryParameter : sentence,NMEA报文, len,报文长度, rx_us,接收时间, priv,指向历元组装器
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void emaps_nmea_sentence(const char *sentence, int len, uint64_t rx_us, void *priv)
+{
+	gps_epoch_sentence((struct gps_epoch *)priv, sentence, rx_us);
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_local_retry()
+ * * Description    : 启动或停止本地数据源重新打开定时器
+ * * EntryParameter : on,1启动, 0停止
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void emaps_local_retry(int on)
+{
+	struct itimerspec its;
+
+	if (local_timer < 0) return;
+
+	memset(&its, 0, sizeof(its));
+	if (on) {
+		its.it_value.tv_sec = EMAPS_LOCAL_RETRY;
+		its.it_interval.tv_sec = EMAPS_LOCAL_RETRY;
+	}
+	timerfd_settime(local_timer, 0, &its, NULL);
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_local_read()
+ * * Description    : 读取本地NMEA数据, 与MCU转发的GPS数据进入同一个流解析和历元组装
+ * * EntryParameter : fd,数据源句柄, priv,未使用
+ * * ReturnValue    : 返回0
+ * **************************************************************************************/
+static int emaps_local_read(int fd, void *priv)
+{
+	int len;
+	uint8_t buffer[EMAPS_LOCAL_BUFFER];
+	uint64_t rx_us = monotonic_us();
+
+	len = read(fd, buffer, sizeof(buffer));
+	if (len < 0 && (errno == EINTR || errno == EAGAIN)) return 0;
+
+	// 数据源关闭(套接字服务端退出、串口拔出), 定时重新打开
+	if (len <= 0) {
+		syslog(LOG_ERR, "nmea source %s closed, error: %s\n", local_path,
+				len < 0 ? strerror(errno) : "EOF");
+		watch_del(fd);
+		nmea_local_close(fd);
+		local_fd = -1;
+		emaps_local_retry(1);
+		return 0;
+	}
+
+	nmea_stream_feed(&gps_stream, buffer, len, rx_us);
+	emaps_epoch_arm();
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : emaps_local_open()
+ * * Description    : 打开本地NMEA数据源并加入主循环, 失败时定时重试
+ * * EntryParameter : fd,重试定时器句柄(首次打开时为-1), priv,未使用
+ * * ReturnValue    : 返回0
+ * **************************************************************************************/
+static int emaps_local_open(int fd, void *priv)
+{
+	uint64_t expired;
+
+	if (fd >= 0 && read(fd, &expired, sizeof(expired)) < 0) return 0;
+	if (local_fd >= 0) return 0;
+
+	local_fd = nmea_local_open(local_path, local_baud);
+	if (local_fd < 0) {
+		emaps_local_retry(1);
+		return 0;
+	}
+
+	if (watch_add(local_fd, emaps_local_read, NULL) < 0) {
+		syslog(LOG_ERR, "nmea source %s watch failed\n", local_path);
+		nmea_local_close(local_fd);
+		local_fd = -1;
+		return 0;
+	}
+	emaps_local_retry(0);
+	syslog(LOG_NOTICE, "gps source %s\n", local_path);
+
 	return 0;
 }
 
 /**************************************************************************************
  * * FunctionName   : handle_emaps_data()
  * * Description    : 处理GPS数据
- * * EntryParameter : data，指向数据， n_data,数据个数
+ * * EntryParameter : data，指向数据， n_data,数据个数, rx_us,串口接收时间
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int handle_emaps_data(ProtobufCBinaryData *data, int n_data)
+static int handle_emaps_data(ProtobufCBinaryData *data, int n_data, uint64_t rx_us)
 {
 	int  i;
 	Gps *gps = NULL;
-	av2hp_gpsInfo gpsinfo = {0x31};
+
+	// 使用本地数据源时不处理MCU转发的GPS数据, 避免同一历元重复输入
+	if (local_path) return 0;
 
 	for (i = 0; i < n_data; i++) {
 		gps = gps__unpack(NULL, data[i].len, data[i].data);
 		if(unlikely(gps == NULL || gps->nmea.data == NULL)) continue;
 
-		DEBUG("GPS(%d):%s\n",gps->nmea.len,gps->nmea.data);
-		get_gpsinfo(&gpsinfo, gps->nmea.data, gps->nmea.len);
-
-		Av2HP_setGpsInfo(&gpsinfo);
+		DEBUG("GPS(%d):%.*s\n",(int)gps->nmea.len,(int)gps->nmea.len,gps->nmea.data);
+		nmea_stream_feed(&gps_stream, gps->nmea.data, gps->nmea.len, rx_us);
 		gps__free_unpacked(gps, NULL);
 	}
 
+	// 定位数据由历元组装器输出, 这里只更新不完整历元的超时时间
+	emaps_epoch_arm();
+
 	return 0;
 }
 
 /**************************************************************************************
  * * FunctionName   : emaps_handler()
  * * Description    : emaps数据处理函数
- * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度
+ * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度, rx_us,接收时间
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int emaps_handler(int fd, char *data, int len)
+static int emaps_handler(int fd, char *data, int len, uint64_t rx_us)
 {
 	Subid *msg = NULL;
 
@@ -221,7 +649,7 @@ static int emaps_handler(int fd, char *data, int len)
 	if(unlikely(msg == NULL)) return -1;
 
 	switch (msg->id) {
-	case IOC__DATA: handle_emaps_data(msg->subdata, msg->n_subdata);
+	case IOC__DATA: handle_emaps_data(msg->subdata, msg->n_subdata, rx_us);
 	break;
 	}
 	subid__free_unpacked(msg, NULL);
@@ -229,6 +657,40 @@ static int emaps_handler(int fd, char *data, int len)
 	return 0;
 }
 
+/**************************************************************************************
+ * * FunctionName   : emaps_release()
+ * * Description    : 关闭输出后端, 定时器和本地NMEA数据源, 初始化失败和解初始化时调用
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void emaps_release(void)
+{
+	if(output && output->close) {
+		output->close();
+	}
+	if(epoch_timer >= 0) {
+		watch_del(epoch_timer);
+		close(epoch_timer);
+		epoch_timer = -1;
+	}
+	if(predict_timer >= 0) {
+		watch_del(predict_timer);
+		close(predict_timer);
+		predict_timer = -1;
+	}
+	if(local_timer >= 0) {
+		watch_del(local_timer);
+		close(local_timer);
+		local_timer = -1;
+	}
+	if(local_fd >= 0) {
+		watch_del(local_fd);
+		nmea_local_close(local_fd);
+		local_fd = -1;
+	}
+	output = NULL;
+}
+
 /**************************************************************************************
  * * FunctionName   : emaps_init()
  * * Description    : emaps初始化
@@ -239,10 +701,29 @@ static int emaps_init(int fd)
 {
 	av2hp_meta meta_data;
 
+	// 0.选择CAN数据输出后端和坐标系, 初始化NMEA流解析和历元组装
+	output = emaps_output_select();
+	coord_gcj02 = !strcasecmp(config_get_string("EMAPS", "coordinate", "wgs84"), "gcj02");
+	if (coord_gcj02) gcj02_init();
+	gps_epoch_init(&gps_epoch, config_get_int("GPS", "epoch_timeout_ms", EMAPS_EPOCH_TIMEOUT),
+			emaps_gps_fix, NULL);
+	nmea_stream_init(&gps_stream, emaps_nmea_sentence, &gps_epoch);
+	local_path = config_get_string("GPS", "source", NULL);
+	local_baud = config_get_int("GPS", "baud", local_baud);
+	hist_init(&fix_age, local_path ? "gps fix age(local)" : "gps fix age",
+			"us", config_get_int("STATS", "interval", 60));
+	epoch_armed = 0;
+	epoch_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (epoch_timer < 0 || watch_add(epoch_timer, emaps_epoch_timeout, NULL) < 0) {
+		syslog(LOG_ERR, "emaps epoch timer failed, incomplete epochs wait for next one\n");
+		if (epoch_timer >= 0) close(epoch_timer);
+		epoch_timer = -1;
+	}
+
 	// 1.初始化电子地图
 	if(Av2HP_init(config_file) != IAV2HP_SUCCESS) {
 		syslog(LOG_ERR,"av2hp init(%s) failed!!!\n", config_file);
-		return -1;
+		goto destory_init0;
 	}
 	// 2.获取Meta信息
 	Av2HP_getMeta(&meta_data);
@@ -253,9 +734,28 @@ static int emaps_init(int fd)
 	// 4.运行电子地图
 	if(Av2HP_run() != IAV2HP_SUCCESS) {
 		syslog(LOG_ERR,"av2hp run(%s) failed!!!\n", config_file);
-		return -1;
+		goto destory_init1;
 	}
 	transport_fd = fd;
+
+	// 5.启动位置推算
+	emaps_predict_init();
+
+	// 6.打开本地NMEA数据源
+	if (local_path) {
+		local_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (local_timer >= 0) watch_add(local_timer, emaps_local_open, NULL);
+		emaps_local_open(-1, NULL);
+	}
+
+	return 0;
+destory_init1:
+	Av2HP_destory();
+destory_init0:
+	// 初始化失败时关闭输出后端和定时器, 事件循环不再调用未初始化完成的模块
+	emaps_release();
+
+	return -1;
 }
 
 /**************************************************************************************
@@ -269,6 +769,7 @@ static int emaps_deinit(int fd)
 	if(transport_fd >= 0) {
 		Av2HP_destory();
 	}
+	emaps_release();
 	transport_fd = -1;
 	return  0;
 }
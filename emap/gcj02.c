@@ -0,0 +1,245 @@
+#include <math.h>
+#include "gcj02.h"
+
+/**************************************************************************************
+* Description    : GCJ02参数, 克拉索夫斯基椭球
+**************************************************************************************/
+#define GCJ02_A                         6378245.0
+#define GCJ02_EE                        0.00669342162296594323
+
+/**************************************************************************************
+* Description    : 中国范围, 范围外不转换
+**************************************************************************************/
+#define GCJ02_LON_MIN                   72.004
+#define GCJ02_LON_MAX                   137.8347
+#define GCJ02_LAT_MIN                   0.8293
+#define GCJ02_LAT_MAX                   55.8271
+
+/**************************************************************************************
+* Description    : 查找表步长为1/GCJ02_SCALE度, 最短周期项为1/3度, 线性插值误差小于3cm
+**************************************************************************************/
+#define GCJ02_SCALE                     200
+#define GCJ02_LON_BASE                  72
+#define GCJ02_LAT_BASE                  0
+#define GCJ02_LON_SIZE                  ((138 - GCJ02_LON_BASE) * GCJ02_SCALE + 2)
+#define GCJ02_LAT_SIZE                  ((56 - GCJ02_LAT_BASE) * GCJ02_SCALE + 2)
+
+/**************************************************************************************
+* Description    : 偏移公式按x=lon-105, y=lat-35可以拆成只与x有关、只与y有关的项和0.1xy,
+*                  只与纬度有关的椭球换算系数也放在纬度表中
+**************************************************************************************/
+struct gcj02_lon_entry {
+	float dlat;                                // 纬度偏移中只与x有关的项
+	float dlon;                                // 经度偏移中只与x有关的项
+};
+
+struct gcj02_lat_entry {
+	float dlat;                                // 纬度偏移中只与y有关的项
+	float klat;                                // 纬度偏移(米)换算为度的系数
+	float klon;                                // 经度偏移(米)换算为度的系数
+	float pad;
+};
+
+static int gcj02_ready = 0;
+static struct gcj02_lon_entry lon_table[GCJ02_LON_SIZE];
+static struct gcj02_lat_entry lat_table[GCJ02_LAT_SIZE];
+
+/**************************************************************************************
+ * * FunctionName   : gcj02_out_of_china()
+ * * Description    : 判断坐标是否在中国范围外
+ * * EntryParameter : lat,lon,坐标
+ * * ReturnValue    : 范围外返回1
+ * **************************************************************************************/
+static inline int gcj02_out_of_china(double lat, double lon)
+{
+	return lon < GCJ02_LON_MIN || lon > GCJ02_LON_MAX || lat < GCJ02_LAT_MIN || lat > GCJ02_LAT_MAX;
+}
+
+/**************************************************************************************
+ * * FunctionName   : gcj02_x_lat()/gcj02_x_lon()/gcj02_y_lat()
+ * * Description    : 偏移公式中只与x或y有关的项
+ * * EntryParameter : x,lon-105, y,lat-35
+ * * ReturnValue    : 返回偏移(米)
+ * **************************************************************************************/
+static double gcj02_x_lat(double x)
+{
+	return 2.0 * x + 0.2 * sqrt(fabs(x))
+		+ (20.0 * sin(6.0 * x * M_PI) + 20.0 * sin(2.0 * x * M_PI)) * 2.0 / 3.0;
+}
+
+static double gcj02_x_lon(double x)
+{
+	return 300.0 + x + 0.1 * x * x + 0.1 * sqrt(fabs(x))
+		+ (20.0 * sin(6.0 * x * M_PI) + 20.0 * sin(2.0 * x * M_PI)) * 2.0 / 3.0
+		+ (20.0 * sin(x * M_PI) + 40.0 * sin(x / 3.0 * M_PI)) * 2.0 / 3.0
+		+ (150.0 * sin(x / 12.0 * M_PI) + 300.0 * sin(x / 30.0 * M_PI)) * 2.0 / 3.0;
+}
+
+static double gcj02_y_lat(double y)
+{
+	return -100.0 + 3.0 * y + 0.2 * y * y
+		+ (20.0 * sin(y * M_PI) + 40.0 * sin(y / 3.0 * M_PI)) * 2.0 / 3.0
+		+ (160.0 * sin(y / 12.0 * M_PI) + 320.0 * sin(y * M_PI / 30.0)) * 2.0 / 3.0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : gcj02_scale()
+ * * Description    : 计算纬度处偏移(米)换算为度的系数
+ * * EntryParameter : lat,纬度, klat,klon,输出系数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void gcj02_scale(double lat, double *klat, double *klon)
+{
+	double rad = lat / 180.0 * M_PI;
+	double magic = 1 - GCJ02_EE * sin(rad) * sin(rad);
+	double sqrt_magic = sqrt(magic);
+
+	*klat = 180.0 / ((GCJ02_A * (1 - GCJ02_EE)) / (magic * sqrt_magic) * M_PI);
+	*klon = 180.0 / (GCJ02_A / sqrt_magic * cos(rad) * M_PI);
+}
+
+/**************************************************************************************
+ * * FunctionName   : gcj02_init()
+ * * Description    : 生成偏移查找表, 转换前调用一次, 重复调用直接返回
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void gcj02_init(void)
+{
+	int i;
+	double x, klat, klon;
+
+	if (gcj02_ready) return;
+
+	for (i = 0; i < GCJ02_LON_SIZE; i++) {
+		x = GCJ02_LON_BASE + (double)i / GCJ02_SCALE - 105.0;
+		lon_table[i].dlat = gcj02_x_lat(x);
+		lon_table[i].dlon = gcj02_x_lon(x);
+	}
+	for (i = 0; i < GCJ02_LAT_SIZE; i++) {
+		x = GCJ02_LAT_BASE + (double)i / GCJ02_SCALE;
+		gcj02_scale(x, &klat, &klon);
+		lat_table[i].dlat = gcj02_y_lat(x - 35.0);
+		lat_table[i].klat = klat;
+		lat_table[i].klon = klon;
+		lat_table[i].pad = 0;
+	}
+	gcj02_ready = 1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wgs84_to_gcj02()
+ * * Description    : WGS84坐标转换为GCJ02坐标, 查表插值实现, 国外坐标不转换
+ * * EntryParameter : in,WGS84坐标, out,输出GCJ02坐标(可以与in相同)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void wgs84_to_gcj02(const struct geo_point *in, struct geo_point *out)
+{
+	int i, j;
+	double lat = in->lat, lon = in->lon;
+	double tx, ty, fx, fy, x, y, xy;
+	double xlat, xlon, ylat, klat, klon;
+	const struct gcj02_lon_entry *a;
+	const struct gcj02_lat_entry *b;
+
+	if (gcj02_out_of_china(lat, lon)) {
+		*out = *in;
+		return;
+	}
+
+	// 1.查表位置和插值系数
+	tx = (lon - GCJ02_LON_BASE) * GCJ02_SCALE;
+	ty = (lat - GCJ02_LAT_BASE) * GCJ02_SCALE;
+	i = (int)tx;
+	j = (int)ty;
+	fx = tx - i;
+	fy = ty - j;
+	a = &lon_table[i];
+	b = &lat_table[j];
+
+	// 2.线性插值各项
+	xlat = a[0].dlat + (a[1].dlat - a[0].dlat) * fx;
+	xlon = a[0].dlon + (a[1].dlon - a[0].dlon) * fx;
+	ylat = b[0].dlat + (b[1].dlat - b[0].dlat) * fy;
+	klat = b[0].klat + (b[1].klat - b[0].klat) * fy;
+	klon = b[0].klon + (b[1].klon - b[0].klon) * fy;
+
+	// 3.交叉项和线性项直接计算
+	x = lon - 105.0;
+	y = lat - 35.0;
+	xy = 0.1 * x * y;
+	out->lat = lat + (xlat + ylat + xy) * klat;
+	out->lon = lon + (xlon + 2.0 * y + xy) * klon;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wgs84_to_gcj02_batch()
+ * * Description    : 批量转换WGS84坐标为GCJ02坐标
+ * * EntryParameter : in,WGS84坐标数组, out,输出GCJ02坐标数组(可以与in相同), n,坐标个数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void wgs84_to_gcj02_batch(const struct geo_point *in, struct geo_point *out, int n)
+{
+	int k;
+
+	for (k = 0; k < n; k++) {
+		wgs84_to_gcj02(&in[k], &out[k]);
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : ref_transform_lat()/ref_transform_lon()
+ * * Description    : GCJ02偏移公式原始形式, 只用于参考实现
+ * * EntryParameter : x,lon-105, y,lat-35
+ * * ReturnValue    : 返回偏移(米)
+ * **************************************************************************************/
+static double ref_transform_lat(double x, double y)
+{
+	double ret = -100.0 + 2.0 * x + 3.0 * y + 0.2 * y * y + 0.1 * x * y + 0.2 * sqrt(fabs(x));
+
+	ret += (20.0 * sin(6.0 * x * M_PI) + 20.0 * sin(2.0 * x * M_PI)) * 2.0 / 3.0;
+	ret += (20.0 * sin(y * M_PI) + 40.0 * sin(y / 3.0 * M_PI)) * 2.0 / 3.0;
+	ret += (160.0 * sin(y / 12.0 * M_PI) + 320.0 * sin(y * M_PI / 30.0)) * 2.0 / 3.0;
+
+	return ret;
+}
+
+static double ref_transform_lon(double x, double y)
+{
+	double ret = 300.0 + x + 2.0 * y + 0.1 * x * x + 0.1 * x * y + 0.1 * sqrt(fabs(x));
+
+	ret += (20.0 * sin(6.0 * x * M_PI) + 20.0 * sin(2.0 * x * M_PI)) * 2.0 / 3.0;
+	ret += (20.0 * sin(x * M_PI) + 40.0 * sin(x / 3.0 * M_PI)) * 2.0 / 3.0;
+	ret += (150.0 * sin(x / 12.0 * M_PI) + 300.0 * sin(x / 30.0 * M_PI)) * 2.0 / 3.0;
+
+	return ret;
+}
+
+/**************************************************************************************
+ * * FunctionName   : wgs84_to_gcj02_ref()
+ * * Description    : WGS84坐标转换为GCJ02坐标, 三角函数参考实现, 用于校验和基准测试
+ * * EntryParameter : in,WGS84坐标, out,输出GCJ02坐标(可以与in相同)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void wgs84_to_gcj02_ref(const struct geo_point *in, struct geo_point *out)
+{
+	double lat = in->lat, lon = in->lon;
+	double dlat, dlon, rad, magic, sqrt_magic;
+
+	if (gcj02_out_of_china(lat, lon)) {
+		*out = *in;
+		return;
+	}
+
+	dlat = ref_transform_lat(lon - 105.0, lat - 35.0);
+	dlon = ref_transform_lon(lon - 105.0, lat - 35.0);
+	rad = lat / 180.0 * M_PI;
+	magic = sin(rad);
+	magic = 1 - GCJ02_EE * magic * magic;
+	sqrt_magic = sqrt(magic);
+	dlat = (dlat * 180.0) / ((GCJ02_A * (1 - GCJ02_EE)) / (magic * sqrt_magic) * M_PI);
+	dlon = (dlon * 180.0) / (GCJ02_A / sqrt_magic * cos(rad) * M_PI);
+
+	out->lat = lat + dlat;
+	out->lon = lon + dlon;
+}
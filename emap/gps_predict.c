@@ -0,0 +1,58 @@
+#include <math.h>
+#include "gps_predict.h"
+
+/**************************************************************************************
+ * * Description    : 地球半径(WGS84长半轴)和角度转换
+ * **************************************************************************************/
+#define EARTH_RADIUS                    6378137.0
+#define DEG2RAD                         (M_PI / 180.0)
+#define RAD2DEG                         (180.0 / M_PI)
+#define KNOT2MS                         0.514444
+
+/**************************************************************************************
+ * * FunctionName   : gps_speed_ms()
+ * * Description    : 获取速度, 统一为米/秒
+ * * EntryParameter : info,定位数据
+ * * ReturnValue    : 返回速度(米/秒)
+ * **************************************************************************************/
+static inline double gps_speed_ms(const av2hp_gpsInfo *info)
+{
+	if (info->m_speed.m_unit == av2hp_speedUnit_knot) return info->m_speed.m_value * KNOT2MS;
+	return info->m_speed.m_value;
+}
+
+/**************************************************************************************
+ * * FunctionName   : gps_predict()
+ * * Description    : 按航向(m_orient)和速度(m_speed)从上一个定位推算dt秒后的位置,
+ * *                  短时间内按匀速直线运动, 使用局部平面近似
+ * * EntryParameter : from,上一个定位, dt,推算时间(秒), to,输出推算的定位(可以与from相同)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void gps_predict(const av2hp_gpsInfo *from, double dt, av2hp_gpsInfo *to)
+{
+	double lat = from->m_pos.m_lat;
+	double lon = from->m_pos.m_lon;
+	double d = gps_speed_ms(from) * dt;
+	double course = from->m_orient * DEG2RAD;
+
+	if (to != from) *to = *from;
+
+	// 北向位移改变纬度, 东向位移按当前纬度圈半径改变经度
+	to->m_pos.m_lat = lat + d * cos(course) / EARTH_RADIUS * RAD2DEG;
+	to->m_pos.m_lon = lon + d * sin(course) / (EARTH_RADIUS * cos(lat * DEG2RAD)) * RAD2DEG;
+}
+
+/**************************************************************************************
+ * * FunctionName   : gps_distance()
+ * * Description    : 计算两个定位之间的水平距离, 局部平面近似, 适用于几百米以内
+ * * EntryParameter : a,b,定位
+ * * ReturnValue    : 返回距离(米)
+ * **************************************************************************************/
+double gps_distance(const av2hp_gpsInfo *a, const av2hp_gpsInfo *b)
+{
+	double lat = (a->m_pos.m_lat + b->m_pos.m_lat) / 2 * DEG2RAD;
+	double dn = (b->m_pos.m_lat - a->m_pos.m_lat) * DEG2RAD * EARTH_RADIUS;
+	double de = (b->m_pos.m_lon - a->m_pos.m_lon) * DEG2RAD * EARTH_RADIUS * cos(lat);
+
+	return sqrt(dn * dn + de * de);
+}
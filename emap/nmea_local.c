@@ -0,0 +1,85 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "serial.h"
+#include "nmea_local.h"
+#include "pbserial.h"
+
+/**************************************************************************************
+ * * FunctionName   : nmea_local_connect()
+ * * Description    : 连接Unix套接字数据源
+ * * EntryParameter : path,套接字路径
+ * * ReturnValue    : 返回套接字或者错误码
+ * **************************************************************************************/
+static int nmea_local_connect(const char *path)
+{
+	int fd;
+	struct sockaddr_un addr;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (unlikely(fd < 0)) return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	return fd;
+}
+
+/**************************************************************************************
+ * * FunctionName   : nmea_local_open()
+ * * Description    : 打开本地NMEA数据源, 根据路径类型选择打开方式:
+ * *                  串口设备按波特率配置, FIFO以读写方式打开(写端关闭时不会读到EOF),
+ * *                  Unix套接字连接到服务端
+ * * EntryParameter : path,数据源路径, baud,串口波特率(其他类型忽略)
+ * * ReturnValue    : 返回非阻塞句柄或者错误码
+ * **************************************************************************************/
+int nmea_local_open(const char *path, int baud)
+{
+	int fd = -1;
+	struct stat st;
+
+	if (unlikely(stat(path, &st) < 0)) {
+		syslog(LOG_ERR, "nmea source %s not found, error: %s", path, strerror(errno));
+		return -1;
+	}
+
+	if (S_ISCHR(st.st_mode)) {
+		fd = device_init(path, baud);
+	} else if (S_ISFIFO(st.st_mode)) {
+		fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	} else if (S_ISSOCK(st.st_mode)) {
+		fd = nmea_local_connect(path);
+	} else {
+		syslog(LOG_ERR, "nmea source %s is not a tty, fifo or socket", path);
+		return -1;
+	}
+
+	if (unlikely(fd < 0)) {
+		syslog(LOG_ERR, "nmea source %s open failed, error: %s", path, strerror(errno));
+		return -1;
+	}
+	DEBUG("nmea source %s opened\n", path)
+
+	return fd;
+}
+
+/**************************************************************************************
+ * * FunctionName   : nmea_local_close()
+ * * Description    : 关闭本地NMEA数据源
+ * * EntryParameter : fd,数据源句柄
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void nmea_local_close(int fd)
+{
+	if (fd >= 0) close(fd);
+}
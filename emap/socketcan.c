@@ -0,0 +1,118 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include "socketcan.h"
+#include "pbserial.h"
+
+/**************************************************************************************
+* Description    : 发送队列满时的重试次数和等待时间
+**************************************************************************************/
+#define SOCKETCAN_RETRY                 3
+#define SOCKETCAN_RETRY_MS              10
+
+/**************************************************************************************
+ * * FunctionName   : socketcan_open()
+ * * Description    : 打开SocketCAN接口(只发送, 不接收)
+ * * EntryParameter : ifname,CAN接口名字(如can0, vcan0)
+ * * ReturnValue    : 返回套接字或者错误码
+ * **************************************************************************************/
+int socketcan_open(const char *ifname)
+{
+	int fd;
+	struct ifreq ifr;
+	struct sockaddr_can addr;
+
+	// 1.创建CAN原始套接字
+	fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+	if (unlikely(fd < 0)) {
+		syslog(LOG_ERR, "can socket failed, error: %s", strerror(errno));
+		return -1;
+	}
+
+	// 2.只发送数据，不设置接收过滤器，避免接收缓冲区堆积
+	setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0);
+
+	// 3.获取接口索引
+	memset(&ifr, 0, sizeof(ifr));
+	snprintf(ifr.ifr_name, IFNAMSIZ, "%s", ifname);
+	if (unlikely(ioctl(fd, SIOCGIFINDEX, &ifr) < 0)) {
+		syslog(LOG_ERR, "can %s not found, error: %s", ifname, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	// 4.绑定接口
+	memset(&addr, 0, sizeof(addr));
+	addr.can_family = AF_CAN;
+	addr.can_ifindex = ifr.ifr_ifindex;
+	if (unlikely(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)) {
+		syslog(LOG_ERR, "can %s bind failed, error: %s", ifname, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	DEBUG("socketcan %s opened\n", ifname)
+
+	return fd;
+}
+
+/**************************************************************************************
+ * * FunctionName   : socketcan_send_batch()
+ * * Description    : 批量发送CAN帧, 一次系统调用发送多帧
+ * * EntryParameter : fd,CAN套接字, frames,指向CAN帧数组, n,帧个数
+ * * ReturnValue    : 返回成功发送的帧数或者错误码
+ * **************************************************************************************/
+int socketcan_send_batch(int fd, struct can_frame *frames, int n)
+{
+	int i, ret;
+	int sent = 0, retry = 0;
+	struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+	struct iovec iov[SOCKETCAN_MAX_BATCH];
+	struct mmsghdr msgs[SOCKETCAN_MAX_BATCH];
+
+	if (unlikely(n > SOCKETCAN_MAX_BATCH)) n = SOCKETCAN_MAX_BATCH;
+
+	// 1.每帧对应一个消息
+	memset(msgs, 0, sizeof(struct mmsghdr) * n);
+	for (i = 0; i < n; i++) {
+		iov[i].iov_base = &frames[i];
+		iov[i].iov_len = sizeof(struct can_frame);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	// 2.直到全部发送完成，发送队列满(ENOBUFS)时等待后重试
+	while (sent < n) {
+		ret = sendmmsg(fd, msgs + sent, n - sent, 0);
+		if (likely(ret > 0)) {
+			sent += ret;
+			continue;
+		}
+		if (ret < 0 && errno == EINTR) continue;
+		if (ret < 0 && (errno == ENOBUFS || errno == EAGAIN) && retry++ < SOCKETCAN_RETRY) {
+			poll(&pfd, 1, SOCKETCAN_RETRY_MS);
+			continue;
+		}
+		syslog(LOG_ERR, "can send %d/%d failed, error: %s", sent, n, strerror(errno));
+		break;
+	}
+
+	return sent > 0 ? sent : -errno;
+}
+
+/**************************************************************************************
+ * * FunctionName   : socketcan_close()
+ * * Description    : 关闭SocketCAN接口
+ * * EntryParameter : fd,CAN套接字
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void socketcan_close(int fd)
+{
+	if (fd >= 0) close(fd);
+}
@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gps.h"
+#include "minmea.h"
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_field()
+* Description    : 获取报文第n个字段
+* EntryParameter : sentence, NMEA报文指针, n,字段序号(报文类型为0)
+* ReturnValue    : 返回字段指针, 字段不存在时返回NULL
+**************************************************************************************/
+static inline const char *gps_epoch_field(const char *sentence, int n)
+{
+	while (n-- > 0) {
+		sentence = strchr(sentence, ',');
+		if (sentence == NULL) return NULL;
+		sentence++;
+	}
+	return sentence;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_utc()
+* Description    : 复制RMC/GGA的UTC时间字段
+* EntryParameter : sentence, NMEA报文指针, utc,输出时间字段
+* ReturnValue    : 返回时间字段长度, 没有时间时返回0
+**************************************************************************************/
+static inline int gps_epoch_utc(const char *sentence, char *utc)
+{
+	int len = 0;
+	const char *field = gps_epoch_field(sentence, 1);
+
+	if (field == NULL) return 0;
+	while (len < GPS_UTC_MAXLEN && field[len] != ',' && field[len] != '*' && field[len] != '\0') {
+		utc[len] = field[len];
+		len++;
+	}
+	utc[len] = '\0';
+
+	return len;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_emit()
+* Description    : 输出当前历元, 没有RMC的历元无法定位, 直接丢弃
+* EntryParameter : ep,历元组装器, complete,历元是否完整
+* ReturnValue    : None
+**************************************************************************************/
+static void gps_epoch_emit(struct gps_epoch *ep, int complete)
+{
+	ep->emitted = 1;
+	if (!(ep->info.mask & GPS_MASK(MINMEA_SENTENCE_RMC))) {
+		ep->dropped++;
+		return;
+	}
+
+	if (complete) ep->fixes++;
+	else ep->partial++;
+	if (ep->cb) ep->cb(&ep->info, ep->priv);
+}
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_open()
+* Description    : 结束当前历元并开始新历元
+* EntryParameter : ep,历元组装器, utc,新历元的UTC时间
+* ReturnValue    : None
+**************************************************************************************/
+static void gps_epoch_open(struct gps_epoch *ep, const char *utc)
+{
+	// 1.当前历元到边界时才能确定包含哪些报文, 作为后续历元是否完整的依据
+	if (ep->sentences > 0 && !ep->gsv_open && (ep->info.mask & GPS_MASK(MINMEA_SENTENCE_RMC))) {
+		ep->profile = ep->info.mask;
+		ep->profile_gsv = ep->gsv_seen;
+	}
+
+	// 2.没有输出过的历元在这里输出
+	if (ep->sentences > 0 && !ep->emitted) gps_epoch_emit(ep, 0);
+
+	// 3.每个历元从空数据开始, 不混用上一历元的字段, 卫星表跨历元保持
+	memset(&ep->info, 0, sizeof(struct gpsinfo));
+	ep->info.view = &ep->view;
+	strcpy(ep->utc, utc);
+	ep->gsv_seen = 0;
+	ep->gsv_open = 0;
+	ep->sentences = 0;
+	ep->emitted = 0;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_init()
+* Description    : 初始化历元组装器
+* EntryParameter : ep,历元组装器, timeout_ms,不完整历元超时时间, cb,定位数据回调, priv,回调私有数据
+* ReturnValue    : None
+**************************************************************************************/
+void gps_epoch_init(struct gps_epoch *ep, int timeout_ms, gps_fix_cb cb, void *priv)
+{
+	memset(ep, 0, sizeof(struct gps_epoch));
+	gps_satview_init(&ep->view);
+	ep->info.view = &ep->view;
+	ep->timeout_us = (uint64_t)timeout_ms * 1000;
+	ep->cb = cb;
+	ep->priv = priv;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_sentence()
+* Description    : 输入一条已校验的报文, UTC时间变化或报文重复时结束上一个历元,
+*                  当前历元包含上一个完整历元的全部报文时立即输出
+* EntryParameter : ep,历元组装器, sentence,NMEA报文, rx_us,报文接收时间(单调时钟us)
+* ReturnValue    : 返回报文ID
+**************************************************************************************/
+enum minmea_sentence_id gps_epoch_sentence(struct gps_epoch *ep, const char *sentence, uint64_t rx_us)
+{
+	const char *field;
+	char utc[GPS_UTC_MAXLEN + 1];
+	unsigned int talker = 0;
+	int msg_nr = 0, total_msgs = 0;
+	enum minmea_sentence_id id = gps_sentence_id(sentence);
+
+	// 1.判断报文是否属于新历元
+	switch (id) {
+	case MINMEA_SENTENCE_RMC:
+	case MINMEA_SENTENCE_GGA:
+		// 带时间的报文, 时间不同或同一时间重复收到时为新历元
+		if (gps_epoch_utc(sentence, utc) > 0) {
+			if (ep->utc[0] == '\0') {
+				if (ep->info.mask & GPS_MASK(id)) gps_epoch_open(ep, utc);
+				else strcpy(ep->utc, utc);
+			} else if (strcmp(ep->utc, utc) != 0 || (ep->info.mask & GPS_MASK(id))) {
+				gps_epoch_open(ep, utc);
+			}
+		} else if (ep->info.mask & GPS_MASK(id)) {
+			gps_epoch_open(ep, "");
+		}
+		break;
+	case MINMEA_SENTENCE_GSV:
+		// 同一系统再次收到第一页GSV时为新历元
+		talker = 1u << gps_talker(sentence);
+		field = gps_epoch_field(sentence, 1);
+		if (field) total_msgs = atoi(field);
+		field = gps_epoch_field(sentence, 2);
+		if (field) msg_nr = atoi(field);
+		if (msg_nr == 1 && (ep->gsv_seen & talker)) gps_epoch_open(ep, "");
+		break;
+	case MINMEA_SENTENCE_VTG:
+		if (ep->info.mask & GPS_MASK(id)) gps_epoch_open(ep, "");
+		break;
+	default:
+		// GSA每个系统各有一条, 不作为历元边界
+		break;
+	}
+
+	// 2.解析报文到当前历元
+	// 历元的时间戳取第一条报文的接收时间, 最接近定位时刻
+	if (ep->sentences++ == 0) {
+		ep->opened_us = rx_us;
+		ep->info.rx_us = rx_us;
+	}
+	id = gps_parse(&ep->info, sentence);
+	if (id == MINMEA_SENTENCE_GSV) {
+		ep->gsv_seen |= talker;
+		if (msg_nr >= total_msgs) ep->gsv_open &= ~talker;
+		else ep->gsv_open |= talker;
+	}
+
+	// 3.当前历元已包含上一个完整历元的全部报文, 立即输出, 不等到下一历元
+	if (!ep->emitted && ep->profile && !ep->gsv_open
+			&& (ep->info.mask & ep->profile) == ep->profile
+			&& (ep->gsv_seen & ep->profile_gsv) == ep->profile_gsv) {
+		gps_epoch_emit(ep, 1);
+	}
+
+	return id;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_poll()
+* Description    : 检查当前历元是否超时, 超时且有RMC时输出不完整历元
+* EntryParameter : ep,历元组装器, now,当前单调时间(us)
+* ReturnValue    : None
+**************************************************************************************/
+void gps_epoch_poll(struct gps_epoch *ep, uint64_t now)
+{
+	uint64_t deadline = gps_epoch_deadline(ep);
+
+	if (deadline && now >= deadline) gps_epoch_emit(ep, 0);
+}
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_deadline()
+* Description    : 获取当前历元的超时时间
+* EntryParameter : ep,历元组装器
+* ReturnValue    : 返回超时的单调时间(us), 没有等待输出的历元时返回0
+**************************************************************************************/
+uint64_t gps_epoch_deadline(struct gps_epoch *ep)
+{
+	if (ep->emitted || ep->sentences == 0) return 0;
+
+	return ep->opened_us + ep->timeout_us;
+}
@@ -1,99 +1,111 @@
+#include <string.h>
 #include "gps.h"
 #include "minmea.h"
+#include "nmea_scan.h"
 
 /**************************************************************************************
- * * Description    : 模块配置定义
- * **************************************************************************************/
-#define GPS_NMEA_MAXLEN        82                      // NMEA语句最大长度
-
-/**************************************************************************************
-* MacroName      : GPS_MOVE_STEPS()
-* Description    : 分离报文时移动步数
-* EntryParameter : data,被移动数据, len,数据长度, step,移动步数
+* MacroName      : GPS_DELAY()
+* Description    : 延时
+* EntryParameter : ms,延时毫秒数
 * ReturnValue    : None
 **************************************************************************************/
-#define GPS_MOVE_STEPS(data,len,step)  \
-do{                                     \
-	data += step;                       \
-	len  -= step;                       \
-}while(0)
+#define GPS_DELAY(ms)      time_delayms(ms)
 
 /**************************************************************************************
-* MacroName      : GPS_FILL_EOF()
-* Description    : 分离报文时填结束符
-* EntryParameter : data,被移动数据, len,数据长度
-* ReturnValue    : None
-**************************************************************************************/
-#define GPS_FILL_EOF(data,len)         \
-do{                                     \
-	data[len] = '\0';                   \
-}while(0)
+ * * Description    : 每次向量化扫描最多输出的报文数和扫描长度
+ * **************************************************************************************/
+#define NMEA_STREAM_SPANS      32
+#define NMEA_SCAN_MAXLEN       0xffff
 
 /**************************************************************************************
-* MacroName      : GPS_DELAY()
-* Description    : 延时
-* EntryParameter : ms,延时毫秒数
-* ReturnValue    : None
+* Description    : NMEA流解析状态
 **************************************************************************************/
-#define GPS_DELAY(ms)      time_delayms(ms)
+enum {
+	NMEA_STATE_IDLE = 0,                       // 等待'$'
+	NMEA_STATE_BODY,                           // 接收报文内容, 计算校验
+	NMEA_STATE_CSUM_HI,                        // 接收校验高4位
+	NMEA_STATE_CSUM_LO,                        // 接收校验低4位
+};
 
 /**************************************************************************************
-* FunctionName   : gps_begin()
-* Description    : 获取NMEA报文的起始偏移
-* EntryParameter : data,报文指针, len,报文长度
-* ReturnValue    : 返回报文起始偏移
+* FunctionName   : gps_hex2int()
+* Description    : 十六进制字符转换
+* EntryParameter : c,十六进制字符
+* ReturnValue    : 返回数值, 非法字符返回-1
 **************************************************************************************/
-static inline uint16_t gps_begin(uint8_t *data, uint16_t len)
+static inline int gps_hex2int(uint8_t c)
 {
-	uint16_t offset = 0;
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
 
-	while(*data != '$' && len > offset){
-		data++;
-		offset++;
+/**************************************************************************************
+* FunctionName   : gps_talker()
+* Description    : 获取报文的卫星系统编号
+* EntryParameter : sentence, NMEA报文指针
+* ReturnValue    : 返回卫星系统编号GPS_TALKER_xxx
+**************************************************************************************/
+int gps_talker(const char *sentence)
+{
+	switch (sentence[1] << 8 | sentence[2]) {
+	case 'G' << 8 | 'P': return GPS_TALKER_GP;
+	case 'G' << 8 | 'L': return GPS_TALKER_GL;
+	case 'G' << 8 | 'A': return GPS_TALKER_GA;
+	case 'B' << 8 | 'D':
+	case 'G' << 8 | 'B': return GPS_TALKER_BD;
+	case 'G' << 8 | 'Q': return GPS_TALKER_GQ;
+	case 'G' << 8 | 'I': return GPS_TALKER_GI;
 	}
-
-	return offset;
+	return GPS_TALKER_OTHER;
 }
 
 /**************************************************************************************
-* FunctionName   : gps_end()
-* Description    : 获取NMEA报文的尾部偏移
-* EntryParameter : data,报文指针, len,报文长度
-* ReturnValue    : 返回报文尾部偏移
+* FunctionName   : gps_sentence_id()
+* Description    : 获取已校验报文的ID, 不再重复计算校验
+* EntryParameter : sentence, NMEA报文指针
+* ReturnValue    : 返回报文ID
 **************************************************************************************/
-static inline uint16_t gps_end(uint8_t *data, uint16_t len)
+enum minmea_sentence_id gps_sentence_id(const char *sentence)
 {
-	uint16_t offset = 0;
-	
-	while(data[0] != '\r' && data[1] != '\n' && len > offset){
-		data++;
-		offset++;
-	}
-	
-	return offset;
+	const char *type = sentence + 3;
+
+	if (sentence[0] != '$' || strlen(sentence) < 6) return MINMEA_INVALID;
+
+	if (!strncmp(type, "RMC", 3)) return MINMEA_SENTENCE_RMC;
+	if (!strncmp(type, "GGA", 3)) return MINMEA_SENTENCE_GGA;
+	if (!strncmp(type, "GSA", 3)) return MINMEA_SENTENCE_GSA;
+	if (!strncmp(type, "GSV", 3)) return MINMEA_SENTENCE_GSV;
+	if (!strncmp(type, "VTG", 3)) return MINMEA_SENTENCE_VTG;
+
+	return MINMEA_UNKNOWN;
 }
 
 /**************************************************************************************
 * FunctionName   : gps_parse()
-* Description    : 解析NMEA报文数据
-* EntryParameter : sentence, NMEA报文指针
-* ReturnValue    : None
+* Description    : 解析NMEA报文数据, 报文由nmea_stream输出, 校验已经检查过
+* EntryParameter : info,GPS数据结构, sentence, NMEA报文指针
+* ReturnValue    : 返回报文ID
 **************************************************************************************/
-static inline void gps_parse(struct gpsinfo *info, void *sentence)
+enum minmea_sentence_id gps_parse(struct gpsinfo *info, const char *sentence)
 {
 	enum minmea_sentence_id nmea_id = 0;
-	
+	struct minmea_sentence_gsv gsv;
+
 	// 1.获取NEMA报文ID
-	nmea_id = minmea_sentence_id(sentence, false);
-	
+	nmea_id = gps_sentence_id(sentence);
+
 	// 2.解析NEMA报文
 	switch(nmea_id){
 	case MINMEA_SENTENCE_RMC:
 		if(true == minmea_parse_rmc(&info->rmc, sentence)){
+			info->mask |= GPS_MASK(nmea_id);
 		}
 		break;
 	case MINMEA_SENTENCE_GGA:
 		if(true == minmea_parse_gga(&info->gga, sentence)){
+			info->mask |= GPS_MASK(nmea_id);
 		}
 		break;
 	case MINMEA_SENTENCE_GSA:
@@ -101,65 +113,174 @@ static inline void gps_parse(struct gpsinfo *info, void *sentence)
 	//case MINMEA_SENTENCE_GPGSA:
 	//case MINMEA_SENTENCE_BDGSA:
 		if(minmea_parse_gsa(&info->gsa, sentence)){
+			info->mask |= GPS_MASK(nmea_id);
 		}
 		break;
 	case MINMEA_SENTENCE_GSV:
 	//case MINMEA_SENTENCE_GPGSV:
 	//case MINMEA_SENTENCE_BDGSV:
-		if(true == minmea_parse_gsv(&info->gsv[info->ngsv], sentence)){
-			info->ngsv++;
+		// GSV逐页更新卫星表, 不在gpsinfo中保存
+		if(info->view && minmea_parse_gsv(&gsv, sentence)){
+			gps_satview_update(info->view, gps_talker(sentence), &gsv);
+			info->mask |= GPS_MASK(nmea_id);
 		}
 		break;
 	case MINMEA_SENTENCE_VTG:
 		if(minmea_parse_vtg(&info->vtg, sentence)){
+			info->mask |= GPS_MASK(nmea_id);
 		}
 		break;
 	default:
 	    break;
 	}
+
+	return nmea_id;
 }
 
 /**************************************************************************************
-* FunctionName   : gpsbuffer_to_gpsinfo()
-* Description    : NMEA数据转换
-* EntryParameter :
+* FunctionName   : nmea_stream_init()
+* Description    : 初始化NMEA流解析器
+* EntryParameter : s,流解析器, cb,完整报文回调, priv,回调私有数据
 * ReturnValue    : None
 **************************************************************************************/
-void gpsbuffer_to_gpsinfo(struct gpsinfo *info, uint8_t *data, int16_t len)
+void nmea_stream_init(struct nmea_stream *s, nmea_sentence_cb cb, void *priv)
 {
-	uint16_t bpos = 0, epos = 0;
-	
-	// 1.分离报文
-	while(len > 0){
-		// 1.1.获取报文起始偏移
-		bpos = gps_begin(data, len);
-		if(bpos >= len - 1){
-			break;
+	memset(s, 0, sizeof(struct nmea_stream));
+	s->state = NMEA_STATE_IDLE;
+	s->cb = cb;
+	s->priv = priv;
+}
+
+/**************************************************************************************
+* FunctionName   : nmea_stream_emit()
+* Description    : 输出一条完整报文
+* EntryParameter : s,流解析器
+* ReturnValue    : None
+**************************************************************************************/
+static inline void nmea_stream_emit(struct nmea_stream *s)
+{
+	s->sentence[s->len] = '\0';
+	s->sentences++;
+	if (s->cb) s->cb(s->sentence, s->len, s->rx_us, s->priv);
+	s->state = NMEA_STATE_IDLE;
+	s->len = 0;
+}
+
+/**************************************************************************************
+* FunctionName   : nmea_stream_drop()
+* Description    : 丢弃当前报文
+* EntryParameter : s,流解析器
+* ReturnValue    : None
+**************************************************************************************/
+static inline void nmea_stream_drop(struct nmea_stream *s)
+{
+	s->dropped++;
+	s->state = NMEA_STATE_IDLE;
+	s->len = 0;
+}
+
+/**************************************************************************************
+* FunctionName   : nmea_stream_byte()
+* Description    : 逐字节处理跨输入的不完整报文
+* EntryParameter : s,流解析器, c,输入字节
+* ReturnValue    : None
+**************************************************************************************/
+static inline void nmea_stream_byte(struct nmea_stream *s, uint8_t c)
+{
+	int hex;
+
+	// 1.任何状态下收到'$'都表示新报文开始
+	if (c == '$') {
+		if (s->state != NMEA_STATE_IDLE) nmea_stream_drop(s);
+		s->state = NMEA_STATE_BODY;
+		s->csum = 0;
+		s->sentence[s->len++] = c;
+		return;
+	}
+
+	if (s->state == NMEA_STATE_IDLE) return;
+
+	// 2.报文超长，丢弃
+	if (s->len >= GPS_NMEA_MAXLEN) {
+		nmea_stream_drop(s);
+		return;
+	}
+
+	// 3.按状态处理当前字节
+	switch (s->state) {
+	case NMEA_STATE_BODY:
+		if (c == '\r' || c == '\n') {
+			// 没有校验码的报文，与minmea非严格模式一致，直接输出
+			nmea_stream_emit(s);
+			return;
 		}
-		
-		// 1.2.将报文指针移动到起始位置
-		GPS_MOVE_STEPS(data, len, bpos);
-		
-		// 1.3.获取报文尾部偏移
-		epos = gps_end(data, len);
-		if(epos >= len - 1){
-			break;
+		if (c < 0x20 || c > 0x7e) {
+			nmea_stream_drop(s);
+			return;
 		}
-		
-		// 1.4.检查报文长度是否正确
-		if(epos > GPS_NMEA_MAXLEN){
-			goto NEXT;
+		if (c == '*') s->state = NMEA_STATE_CSUM_HI;
+		else s->csum ^= c;
+		break;
+	case NMEA_STATE_CSUM_HI:
+		hex = gps_hex2int(c);
+		if (hex < 0) {
+			nmea_stream_drop(s);
+			return;
 		}
-		
-		// 1.5.填充结束符
-		GPS_FILL_EOF(data, epos);
-		
-		// 1.6.解析报文
-		gps_parse(info, data);
-		
-		NEXT:
-		
-		// 1.7.将报文指针移动到结束位置
-		GPS_MOVE_STEPS(data, len, epos);
+		s->expect = hex << 4;
+		s->state = NMEA_STATE_CSUM_LO;
+		break;
+	case NMEA_STATE_CSUM_LO:
+		hex = gps_hex2int(c);
+		if (hex < 0 || (s->expect | hex) != s->csum) {
+			nmea_stream_drop(s);
+			return;
+		}
+		s->sentence[s->len++] = c;
+		nmea_stream_emit(s);
+		return;
 	}
+	s->sentence[s->len++] = c;
+}
+
+/**************************************************************************************
+* FunctionName   : nmea_stream_feed()
+* Description    : 输入NMEA数据, 报文可以跨多次输入, 不修改输入数据
+*                  空闲时整段向量化扫描并校验, 末尾不完整的报文逐字节处理,
+*                  收到校验码最后一个字符时立即输出报文
+* EntryParameter : s,流解析器, data,NMEA数据, len,数据长度, rx_us,数据接收时间, 随报文输出
+* ReturnValue    : 返回本次输出的报文个数
+**************************************************************************************/
+int nmea_stream_feed(struct nmea_stream *s, const uint8_t *data, int len, uint64_t rx_us)
+{
+	int i = 0, k, n, consumed;
+	struct nmea_span spans[NMEA_STREAM_SPANS];
+	unsigned long emitted = s->sentences;
+
+	// 跨输入的报文在收全时输出, 使用收全那次输入的接收时间
+	s->rx_us = rx_us;
+
+	while (i < len) {
+		// 1.空闲状态下向量化扫描完整报文
+		if (s->state == NMEA_STATE_IDLE) {
+			n = nmea_scan(data + i, len - i > NMEA_SCAN_MAXLEN ? NMEA_SCAN_MAXLEN : len - i,
+					spans, NMEA_STREAM_SPANS, &consumed);
+			for (k = 0; k < n; k++) {
+				if (!spans[k].valid) {
+					s->dropped++;
+					continue;
+				}
+				memcpy(s->sentence, data + i + spans[k].offset, spans[k].len);
+				s->len = spans[k].len;
+				nmea_stream_emit(s);
+			}
+			i += consumed;
+			if (n == NMEA_STREAM_SPANS || i >= len) continue;
+		}
+
+		// 2.跨输入的不完整报文逐字节处理, 完成后回到空闲状态
+		nmea_stream_byte(s, data[i++]);
+	}
+
+	return (int)(s->sentences - emitted);
 }
@@ -86,7 +86,8 @@ bool minmea_check(const char *sentence, bool strict)
 }
 
 static inline bool minmea_isfield(char c) {
-    return isprint((unsigned char) c) && c != ',' && c != '*';
+    // Same as isprint() in the C locale, without the library call.
+    return c >= 0x20 && c <= 0x7e && c != ',' && c != '*';
 }
 
 bool minmea_scan(const char *sentence, const char *format, ...)
@@ -338,6 +339,211 @@ parse_error:
     return result;
 }
 
+/*
+ * Specialized field parsers for the hot-path sentences (RMC, GGA, GSA, GSV,
+ * VTG). Each helper implements exactly one minmea_scan() format character, so
+ * the results are identical to the format-string versions, but the format is
+ * resolved at compile time instead of through va_arg for every field.
+ *
+ * A field pointer of NULL means the sentence ran out of fields; helpers then
+ * store the same defaults minmea_scan() stores for optional fields.
+ */
+
+static inline const char *minmea_next_field(const char *field)
+{
+    if (!field)
+        return NULL;
+    while (minmea_isfield(*field))
+        field++;
+    return *field == ',' ? field + 1 : NULL;
+}
+
+static inline bool minmea_field_type(const char *field, const char *type)
+{
+    // 't': "$" followed by two talker characters and the sentence type.
+    if (!field || field[0] != '$')
+        return false;
+    if (!minmea_isfield(field[1]) || !minmea_isfield(field[2]))
+        return false;
+    return field[3] == type[0] && field[4] == type[1] && field[5] == type[2];
+}
+
+static inline bool minmea_field_char(const char *field, char *value)
+{
+    // 'c'
+    *value = (field && minmea_isfield(*field)) ? *field : '\0';
+    return true;
+}
+
+static inline bool minmea_field_direction(const char *field, int *value)
+{
+    // 'd'
+    *value = 0;
+    if (!field || !minmea_isfield(*field))
+        return true;
+    switch (*field) {
+        case 'N':
+        case 'E':
+            *value = 1;
+            return true;
+        case 'S':
+        case 'W':
+            *value = -1;
+            return true;
+    }
+    return false;
+}
+
+static inline bool minmea_field_float(const char *field, struct minmea_float *f)
+{
+    // 'f'
+    int sign = 0;
+    int_least32_t value = -1;
+    int_least32_t scale = 0;
+
+    if (field) {
+        for (; minmea_isfield(*field); field++) {
+            char c = *field;
+            if (c >= '0' && c <= '9') {
+                int digit = c - '0';
+                if (value == -1)
+                    value = 0;
+                if (value > (INT_LEAST32_MAX-digit) / 10) {
+                    if (scale)
+                        break;
+                    return false;
+                }
+                value = (10 * value) + digit;
+                if (scale)
+                    scale *= 10;
+            } else if (c == '.' && scale == 0) {
+                scale = 1;
+            } else if ((c == '+' || c == '-') && !sign && value == -1) {
+                sign = c == '+' ? 1 : -1;
+            } else if (c == ' ') {
+                if (sign != 0 || value != -1 || scale != 0)
+                    return false;
+            } else {
+                return false;
+            }
+        }
+    }
+
+    if ((sign || scale) && value == -1)
+        return false;
+
+    if (value == -1) {
+        value = 0;
+        scale = 0;
+    } else if (scale == 0) {
+        scale = 1;
+    }
+    if (sign)
+        value *= sign;
+
+    f->value = value;
+    f->scale = scale;
+    return true;
+}
+
+static inline bool minmea_field_int(const char *field, int *value)
+{
+    // 'i', following strtol(field, &end, 10) semantics.
+    const char *start = field;
+    long result = 0;
+    int negative = 0;
+    int digits = 0;
+
+    *value = 0;
+    if (!field)
+        return true;
+
+    while (*field == ' ')
+        field++;
+    if (*field == '+' || *field == '-')
+        negative = *field++ == '-';
+    for (; *field >= '0' && *field <= '9'; field++, digits++)
+        result = result * 10 + (*field - '0');
+    if (!digits)
+        field = start;
+    if (minmea_isfield(*field))
+        return false;
+
+    *value = negative ? -result : result;
+    return true;
+}
+
+static inline int minmea_field_2digits(const char *field)
+{
+    return (field[0] - '0') * 10 + (field[1] - '0');
+}
+
+static inline bool minmea_field_isdigits(const char *field, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        if (field[i] < '0' || field[i] > '9')
+            return false;
+    return true;
+}
+
+static inline bool minmea_field_date(const char *field, struct minmea_date *date)
+{
+    // 'D'
+    date->day = date->month = date->year = -1;
+    if (!field || !minmea_isfield(*field))
+        return true;
+    if (!minmea_field_isdigits(field, 6))
+        return false;
+    date->day = minmea_field_2digits(field);
+    date->month = minmea_field_2digits(field + 2);
+    date->year = minmea_field_2digits(field + 4);
+    return true;
+}
+
+static inline bool minmea_field_time(const char *field, struct minmea_time *time_)
+{
+    // 'T'
+    time_->hours = time_->minutes = time_->seconds = time_->microseconds = -1;
+    if (!field || !minmea_isfield(*field))
+        return true;
+    if (!minmea_field_isdigits(field, 6))
+        return false;
+    time_->hours = minmea_field_2digits(field);
+    time_->minutes = minmea_field_2digits(field + 2);
+    time_->seconds = minmea_field_2digits(field + 4);
+    field += 6;
+
+    if (*field++ == '.') {
+        uint32_t value = 0;
+        uint32_t scale = 1000000LU;
+        while (*field >= '0' && *field <= '9' && scale > 1) {
+            value = (value * 10) + (*field++ - '0');
+            scale /= 10;
+        }
+        time_->microseconds = value * scale;
+    } else {
+        time_->microseconds = 0;
+    }
+    return true;
+}
+
+// Mandatory field: fail if the sentence ran out of fields.
+#define MINMEA_FIELD(parse) \
+    do { \
+        if (!field || !(parse)) \
+            return false; \
+        field = minmea_next_field(field); \
+    } while (0)
+
+// Optional field (after ';' in the minmea_scan() format).
+#define MINMEA_OPTIONAL(parse) \
+    do { \
+        if (!(parse)) \
+            return false; \
+        field = minmea_next_field(field); \
+    } while (0)
+
 bool minmea_talker_id(char talker[3], const char *sentence)
 {
     char type[6];
@@ -356,25 +562,29 @@ enum minmea_sentence_id minmea_sentence_id(const char *sentence, bool strict)
     if (!minmea_check(sentence, strict))
         return MINMEA_INVALID;
 
-    char type[6];
-    if (!minmea_scan(sentence, "t", type))
+    // Same checks as minmea_scan(sentence, "t", type), without the copy.
+    if (sentence[0] != '$')
         return MINMEA_INVALID;
+    for (int f = 1; f <= 5; f++)
+        if (!minmea_isfield(sentence[f]))
+            return MINMEA_INVALID;
 
-    if (!strcmp(type+2, "RMC"))
+    const char *type = sentence + 1;
+    if (!strncmp(type+2, "RMC", 3))
         return MINMEA_SENTENCE_RMC;
-    if (!strcmp(type+2, "GGA"))
+    if (!strncmp(type+2, "GGA", 3))
         return MINMEA_SENTENCE_GGA;
-    if (!strcmp(type+2, "GSA"))
+    if (!strncmp(type+2, "GSA", 3))
         return MINMEA_SENTENCE_GSA;
-    if (!strcmp(type+2, "GLL"))
+    if (!strncmp(type+2, "GLL", 3))
         return MINMEA_SENTENCE_GLL;
-    if (!strcmp(type+2, "GST"))
+    if (!strncmp(type+2, "GST", 3))
         return MINMEA_SENTENCE_GST;
-    if (!strcmp(type+2, "GSV"))
+    if (!strncmp(type+2, "GSV", 3))
         return MINMEA_SENTENCE_GSV;
-    if (!strcmp(type+2, "VTG"))
+    if (!strncmp(type+2, "VTG", 3))
         return MINMEA_SENTENCE_VTG;
-    if (!strcmp(type+2, "ZDA"))
+    if (!strncmp(type+2, "ZDA", 3))
         return MINMEA_SENTENCE_ZDA;
 
     return MINMEA_UNKNOWN;
@@ -383,24 +593,25 @@ enum minmea_sentence_id minmea_sentence_id(const char *sentence, bool strict)
 bool minmea_parse_rmc(struct minmea_sentence_rmc *frame, const char *sentence)
 {
     // $GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62
-    char type[6];
+    // Equivalent to minmea_scan(sentence, "tTcfdfdffDfd", ...).
+    const char *field = sentence;
     char validity;
     int latitude_direction;
     int longitude_direction;
     int variation_direction;
-    if (!minmea_scan(sentence, "tTcfdfdffDfd",
-            type,
-            &frame->time,
-            &validity,
-            &frame->latitude, &latitude_direction,
-            &frame->longitude, &longitude_direction,
-            &frame->speed,
-            &frame->course,
-            &frame->date,
-            &frame->variation, &variation_direction))
-        return false;
-    if (strcmp(type+2, "RMC"))
-        return false;
+
+    MINMEA_FIELD(minmea_field_type(field, "RMC"));
+    MINMEA_FIELD(minmea_field_time(field, &frame->time));
+    MINMEA_FIELD(minmea_field_char(field, &validity));
+    MINMEA_FIELD(minmea_field_float(field, &frame->latitude));
+    MINMEA_FIELD(minmea_field_direction(field, &latitude_direction));
+    MINMEA_FIELD(minmea_field_float(field, &frame->longitude));
+    MINMEA_FIELD(minmea_field_direction(field, &longitude_direction));
+    MINMEA_FIELD(minmea_field_float(field, &frame->speed));
+    MINMEA_FIELD(minmea_field_float(field, &frame->course));
+    MINMEA_FIELD(minmea_field_date(field, &frame->date));
+    MINMEA_FIELD(minmea_field_float(field, &frame->variation));
+    MINMEA_FIELD(minmea_field_direction(field, &variation_direction));
 
     frame->valid = (validity == 'A');
     frame->latitude.value *= latitude_direction;
@@ -413,24 +624,26 @@ bool minmea_parse_rmc(struct minmea_sentence_rmc *frame, const char *sentence)
 bool minmea_parse_gga(struct minmea_sentence_gga *frame, const char *sentence)
 {
     // $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47
-    char type[6];
+    // Equivalent to minmea_scan(sentence, "tTfdfdiiffcfcf_", ...).
+    const char *field = sentence;
     int latitude_direction;
     int longitude_direction;
 
-    if (!minmea_scan(sentence, "tTfdfdiiffcfcf_",
-            type,
-            &frame->time,
-            &frame->latitude, &latitude_direction,
-            &frame->longitude, &longitude_direction,
-            &frame->fix_quality,
-            &frame->satellites_tracked,
-            &frame->hdop,
-            &frame->altitude, &frame->altitude_units,
-            &frame->height, &frame->height_units,
-            &frame->dgps_age))
-        return false;
-    if (strcmp(type+2, "GGA"))
-        return false;
+    MINMEA_FIELD(minmea_field_type(field, "GGA"));
+    MINMEA_FIELD(minmea_field_time(field, &frame->time));
+    MINMEA_FIELD(minmea_field_float(field, &frame->latitude));
+    MINMEA_FIELD(minmea_field_direction(field, &latitude_direction));
+    MINMEA_FIELD(minmea_field_float(field, &frame->longitude));
+    MINMEA_FIELD(minmea_field_direction(field, &longitude_direction));
+    MINMEA_FIELD(minmea_field_int(field, &frame->fix_quality));
+    MINMEA_FIELD(minmea_field_int(field, &frame->satellites_tracked));
+    MINMEA_FIELD(minmea_field_float(field, &frame->hdop));
+    MINMEA_FIELD(minmea_field_float(field, &frame->altitude));
+    MINMEA_FIELD(minmea_field_char(field, &frame->altitude_units));
+    MINMEA_FIELD(minmea_field_float(field, &frame->height));
+    MINMEA_FIELD(minmea_field_char(field, &frame->height_units));
+    MINMEA_FIELD(minmea_field_float(field, &frame->dgps_age));
+    MINMEA_FIELD(true);
 
     frame->latitude.value *= latitude_direction;
     frame->longitude.value *= longitude_direction;
@@ -441,30 +654,18 @@ bool minmea_parse_gga(struct minmea_sentence_gga *frame, const char *sentence)
 bool minmea_parse_gsa(struct minmea_sentence_gsa *frame, const char *sentence)
 {
     // $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39
-    char type[6];
+    // Equivalent to minmea_scan(sentence, "tciiiiiiiiiiiiifff", ...).
+    const char *field = sentence;
+    int i;
 
-    if (!minmea_scan(sentence, "tciiiiiiiiiiiiifff",
-            type,
-            &frame->mode,
-            &frame->fix_type,
-            &frame->sats[0],
-            &frame->sats[1],
-            &frame->sats[2],
-            &frame->sats[3],
-            &frame->sats[4],
-            &frame->sats[5],
-            &frame->sats[6],
-            &frame->sats[7],
-            &frame->sats[8],
-            &frame->sats[9],
-            &frame->sats[10],
-            &frame->sats[11],
-            &frame->pdop,
-            &frame->hdop,
-            &frame->vdop))
-        return false;
-    if (strcmp(type+2, "GSA"))
-        return false;
+    MINMEA_FIELD(minmea_field_type(field, "GSA"));
+    MINMEA_FIELD(minmea_field_char(field, &frame->mode));
+    MINMEA_FIELD(minmea_field_int(field, &frame->fix_type));
+    for (i = 0; i < 12; i++)
+        MINMEA_FIELD(minmea_field_int(field, &frame->sats[i]));
+    MINMEA_FIELD(minmea_field_float(field, &frame->pdop));
+    MINMEA_FIELD(minmea_field_float(field, &frame->hdop));
+    MINMEA_FIELD(minmea_field_float(field, &frame->vdop));
 
     return true;
 }
@@ -522,34 +723,20 @@ bool minmea_parse_gsv(struct minmea_sentence_gsv *frame, const char *sentence)
     // $GPGSV,4,2,11,08,51,203,30,09,45,215,28*75
     // $GPGSV,4,4,13,39,31,170,27*40
     // $GPGSV,4,4,13*7B
-    char type[6];
-
-    if (!minmea_scan(sentence, "tiii;iiiiiiiiiiiiiiii",
-            type,
-            &frame->total_msgs,
-            &frame->msg_nr,
-            &frame->total_sats,
-            &frame->sats[0].nr,
-            &frame->sats[0].elevation,
-            &frame->sats[0].azimuth,
-            &frame->sats[0].snr,
-            &frame->sats[1].nr,
-            &frame->sats[1].elevation,
-            &frame->sats[1].azimuth,
-            &frame->sats[1].snr,
-            &frame->sats[2].nr,
-            &frame->sats[2].elevation,
-            &frame->sats[2].azimuth,
-            &frame->sats[2].snr,
-            &frame->sats[3].nr,
-            &frame->sats[3].elevation,
-            &frame->sats[3].azimuth,
-            &frame->sats[3].snr
-            )) {
-        return false;
+    // Equivalent to minmea_scan(sentence, "tiii;iiiiiiiiiiiiiiii", ...).
+    const char *field = sentence;
+    int i;
+
+    MINMEA_FIELD(minmea_field_type(field, "GSV"));
+    MINMEA_FIELD(minmea_field_int(field, &frame->total_msgs));
+    MINMEA_FIELD(minmea_field_int(field, &frame->msg_nr));
+    MINMEA_FIELD(minmea_field_int(field, &frame->total_sats));
+    for (i = 0; i < 4; i++) {
+        MINMEA_OPTIONAL(minmea_field_int(field, &frame->sats[i].nr));
+        MINMEA_OPTIONAL(minmea_field_int(field, &frame->sats[i].elevation));
+        MINMEA_OPTIONAL(minmea_field_int(field, &frame->sats[i].azimuth));
+        MINMEA_OPTIONAL(minmea_field_int(field, &frame->sats[i].snr));
     }
-    if (strcmp(type+2, "GSV"))
-        return false;
 
     return true;
 }
@@ -560,23 +747,21 @@ bool minmea_parse_vtg(struct minmea_sentence_vtg *frame, const char *sentence)
     // $GPVTG,156.1,T,140.9,M,0.0,N,0.0,K*41
     // $GPVTG,096.5,T,083.5,M,0.0,N,0.0,K,D*22
     // $GPVTG,188.36,T,,M,0.820,N,1.519,K,A*3F
-    char type[6];
+    // Equivalent to minmea_scan(sentence, "tfcfcfcfc;c", ...).
+    const char *field = sentence;
     char c_true, c_magnetic, c_knots, c_kph, c_faa_mode;
 
-    if (!minmea_scan(sentence, "tfcfcfcfc;c",
-            type,
-            &frame->true_track_degrees,
-            &c_true,
-            &frame->magnetic_track_degrees,
-            &c_magnetic,
-            &frame->speed_knots,
-            &c_knots,
-            &frame->speed_kph,
-            &c_kph,
-            &c_faa_mode))
-        return false;
-    if (strcmp(type+2, "VTG"))
-        return false;
+    MINMEA_FIELD(minmea_field_type(field, "VTG"));
+    MINMEA_FIELD(minmea_field_float(field, &frame->true_track_degrees));
+    MINMEA_FIELD(minmea_field_char(field, &c_true));
+    MINMEA_FIELD(minmea_field_float(field, &frame->magnetic_track_degrees));
+    MINMEA_FIELD(minmea_field_char(field, &c_magnetic));
+    MINMEA_FIELD(minmea_field_float(field, &frame->speed_knots));
+    MINMEA_FIELD(minmea_field_char(field, &c_knots));
+    MINMEA_FIELD(minmea_field_float(field, &frame->speed_kph));
+    MINMEA_FIELD(minmea_field_char(field, &c_kph));
+    MINMEA_OPTIONAL(minmea_field_char(field, &c_faa_mode));
+
     // check chars
     if (c_true != 'T' ||
         c_magnetic != 'M' ||
@@ -0,0 +1,339 @@
+#include <string.h>
+#include "gps.h"
+#include "nmea_scan.h"
+
+/**************************************************************************************
+* Description    : 向量操作定义
+*                  NMEA_BLOCK       每次处理的字节数
+*                  NMEA_MASK_STRIDE nmea_vmask()结果中每个字节占用的位数
+*                  依次支持AVX2(32字节), SSE2/NEON(16字节), 其他平台使用64位整数(8字节)
+**************************************************************************************/
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NMEA_BLOCK                      32
+#define NMEA_MASK_STRIDE                1
+typedef __m256i nmea_vec;
+
+static inline nmea_vec nmea_vload(const uint8_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline nmea_vec nmea_vzero(void) { return _mm256_setzero_si256(); }
+static inline nmea_vec nmea_vxor(nmea_vec a, nmea_vec b) { return _mm256_xor_si256(a, b); }
+static inline nmea_vec nmea_vand(nmea_vec a, nmea_vec b) { return _mm256_and_si256(a, b); }
+static inline nmea_vec nmea_vandnot(nmea_vec a, nmea_vec b) { return _mm256_andnot_si256(b, a); }
+
+static inline uint64_t nmea_vmask(nmea_vec v, uint8_t c)
+{
+	return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+// 不在0x20~0x7e之间的字节, 有符号比较时0x80~0xff小于0x20
+static inline uint64_t nmea_vbad(nmea_vec v)
+{
+	__m256i bad = _mm256_or_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v),
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+
+	return (uint32_t)_mm256_movemask_epi8(bad);
+}
+
+static inline uint8_t nmea_vhxor(nmea_vec v)
+{
+	__m128i x = _mm_xor_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 8));
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 4));
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 2));
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 1));
+	return (uint8_t)_mm_cvtsi128_si32(x);
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NMEA_BLOCK                      16
+#define NMEA_MASK_STRIDE                1
+typedef __m128i nmea_vec;
+
+static inline nmea_vec nmea_vload(const uint8_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline nmea_vec nmea_vzero(void) { return _mm_setzero_si128(); }
+static inline nmea_vec nmea_vxor(nmea_vec a, nmea_vec b) { return _mm_xor_si128(a, b); }
+static inline nmea_vec nmea_vand(nmea_vec a, nmea_vec b) { return _mm_and_si128(a, b); }
+static inline nmea_vec nmea_vandnot(nmea_vec a, nmea_vec b) { return _mm_andnot_si128(b, a); }
+
+static inline uint64_t nmea_vmask(nmea_vec v, uint8_t c)
+{
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+// 不在0x20~0x7e之间的字节, 有符号比较时0x80~0xff小于0x20
+static inline uint64_t nmea_vbad(nmea_vec v)
+{
+	__m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)),
+			_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+
+	return (uint32_t)_mm_movemask_epi8(bad);
+}
+
+static inline uint8_t nmea_vhxor(nmea_vec x)
+{
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 8));
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 4));
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 2));
+	x = _mm_xor_si128(x, _mm_srli_si128(x, 1));
+	return (uint8_t)_mm_cvtsi128_si32(x);
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NMEA_BLOCK                      16
+#define NMEA_MASK_STRIDE                4
+typedef uint8x16_t nmea_vec;
+
+static inline nmea_vec nmea_vload(const uint8_t *p) { return vld1q_u8(p); }
+static inline nmea_vec nmea_vzero(void) { return vdupq_n_u8(0); }
+static inline nmea_vec nmea_vxor(nmea_vec a, nmea_vec b) { return veorq_u8(a, b); }
+static inline nmea_vec nmea_vand(nmea_vec a, nmea_vec b) { return vandq_u8(a, b); }
+static inline nmea_vec nmea_vandnot(nmea_vec a, nmea_vec b) { return vbicq_u8(a, b); }
+
+// NEON没有movemask, 通过移位窄化得到每字节4位的掩码
+static inline uint64_t nmea_vmask(nmea_vec v, uint8_t c)
+{
+	uint8x16_t eq = vceqq_u8(v, vdupq_n_u8(c));
+
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+// 不在0x20~0x7e之间的字节
+static inline uint64_t nmea_vbad(nmea_vec v)
+{
+	uint8x16_t bad = vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x20)), vcgtq_u8(v, vdupq_n_u8(0x7e)));
+
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(bad), 4)), 0);
+}
+
+static inline uint8_t nmea_vhxor(nmea_vec v)
+{
+	uint8x8_t x = veor_u8(vget_low_u8(v), vget_high_u8(v));
+	uint64_t w = vget_lane_u64(vreinterpret_u64_u8(x), 0);
+
+	w ^= w >> 32;
+	w ^= w >> 16;
+	w ^= w >> 8;
+	return (uint8_t)w;
+}
+#else
+#define NMEA_BLOCK                      8
+#define NMEA_MASK_STRIDE                8
+typedef uint64_t nmea_vec;
+
+static inline nmea_vec nmea_vload(const uint8_t *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+static inline nmea_vec nmea_vzero(void) { return 0; }
+static inline nmea_vec nmea_vxor(nmea_vec a, nmea_vec b) { return a ^ b; }
+static inline nmea_vec nmea_vand(nmea_vec a, nmea_vec b) { return a & b; }
+static inline nmea_vec nmea_vandnot(nmea_vec a, nmea_vec b) { return a & ~b; }
+
+// 等于c的字节最高位置1
+static inline uint64_t nmea_vmask(nmea_vec v, uint8_t c)
+{
+	uint64_t x = v ^ (0x0101010101010101ULL * c);
+	uint64_t t = ((x & 0x7f7f7f7f7f7f7f7fULL) + 0x7f7f7f7f7f7f7f7fULL) | x;
+
+	return ~t & 0x8080808080808080ULL;
+}
+
+// 不在0x20~0x7e之间的字节最高位置1: 低7位小于0x20且最高位为0, 或者低7位为0x7f, 或者最高位为1
+static inline uint64_t nmea_vbad(nmea_vec v)
+{
+	uint64_t low = v & 0x7f7f7f7f7f7f7f7fULL;
+	uint64_t lt = ~((low + 0x6060606060606060ULL) | v);
+	uint64_t ge = (low + 0x0101010101010101ULL) | v;
+
+	return (lt | ge) & 0x8080808080808080ULL;
+}
+
+static inline uint8_t nmea_vhxor(nmea_vec w)
+{
+	w ^= w >> 32;
+	w ^= w >> 16;
+	w ^= w >> 8;
+	return (uint8_t)w;
+}
+#endif
+
+/**************************************************************************************
+* Description    : 前NMEA_BLOCK字节为0xff, 后NMEA_BLOCK字节为0, 用于生成区间掩码
+**************************************************************************************/
+static const uint8_t nmea_below_tbl[2 * NMEA_BLOCK] = { [0 ... NMEA_BLOCK - 1] = 0xff };
+
+/**************************************************************************************
+* FunctionName   : nmea_vrange()
+* Description    : 保留块内[lo, hi)区间的字节, 其他字节清零
+* EntryParameter : v,数据块, lo,起始偏移, hi,结束偏移
+* ReturnValue    : 返回结果
+**************************************************************************************/
+static inline nmea_vec nmea_vrange(nmea_vec v, int lo, int hi)
+{
+	nmea_vec below_hi = nmea_vload(nmea_below_tbl + NMEA_BLOCK - hi);
+	nmea_vec below_lo = nmea_vload(nmea_below_tbl + NMEA_BLOCK - lo);
+
+	return nmea_vand(v, nmea_vandnot(below_hi, below_lo));
+}
+
+/**************************************************************************************
+* FunctionName   : nmea_mrange()
+* Description    : nmea_vmask()/nmea_vbad()结果中块内[lo, hi)区间字节对应的位
+* EntryParameter : lo,起始偏移, hi,结束偏移
+* ReturnValue    : 返回位掩码
+**************************************************************************************/
+static inline uint64_t nmea_mrange(int lo, int hi)
+{
+	uint64_t below_hi = hi * NMEA_MASK_STRIDE >= 64 ? ~0ULL : (1ULL << (hi * NMEA_MASK_STRIDE)) - 1;
+
+	// 块内最后一个字节是事件时lo为NMEA_BLOCK, 移位64位没有定义
+	if (lo * NMEA_MASK_STRIDE >= 64) return 0;
+
+	return below_hi & (~0ULL << (lo * NMEA_MASK_STRIDE));
+}
+
+/**************************************************************************************
+* FunctionName   : nmea_hex2int()
+* Description    : 十六进制字符转换
+* EntryParameter : c,十六进制字符
+* ReturnValue    : 返回数值, 非法字符返回-1
+**************************************************************************************/
+static inline int nmea_hex2int(uint8_t c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+/**************************************************************************************
+* Description    : 扫描状态
+**************************************************************************************/
+struct nmea_scan_state {
+	int start;                                 // 当前报文'$'偏移, -1表示不在报文中
+	uint8_t csum;                              // 标量部分的校验
+	uint8_t bad;                               // 报文中有0x20~0x7e以外的字节, 与逐字节解析一致丢弃
+	nmea_vec acc;                              // 向量部分的校验
+};
+
+/**************************************************************************************
+* FunctionName   : nmea_scan_event()
+* Description    : 处理'$'、'*'、回车换行, 调用前报文内容已经累加到校验中
+* EntryParameter : st,扫描状态, data,NMEA数据, len,数据长度, e,事件偏移, span,输出报文
+* ReturnValue    : 返回1表示输出了报文, 0表示没有, -1表示校验码不完整需等待更多数据
+**************************************************************************************/
+static inline int nmea_scan_event(struct nmea_scan_state *st, const uint8_t *data,
+		int len, int e, struct nmea_span *span)
+{
+	int hi, lo;
+	uint8_t c = data[e];
+
+	// 1.新报文开始，之前未完成的报文丢弃
+	if (c == '$') {
+		st->start = e;
+		st->csum = 0;
+		st->bad = 0;
+		st->acc = nmea_vzero();
+		return 0;
+	}
+	if (st->start < 0) return 0;
+
+	span->offset = st->start;
+	if (c == '*') {
+		// 2.校验码尚未收全
+		if (e + 2 >= len) return -1;
+		hi = nmea_hex2int(data[e + 1]);
+		lo = nmea_hex2int(data[e + 2]);
+		span->len = e + 3 - st->start;
+		span->valid = hi >= 0 && lo >= 0 && span->len <= GPS_NMEA_MAXLEN && !st->bad &&
+			((hi << 4) | lo) == (st->csum ^ nmea_vhxor(st->acc));
+	} else {
+		// 3.没有校验码的报文, 以回车换行结束
+		span->len = e - st->start;
+		span->valid = span->len <= GPS_NMEA_MAXLEN && !st->bad;
+	}
+	st->start = -1;
+
+	return 1;
+}
+
+/**************************************************************************************
+* FunctionName   : nmea_scan()
+* Description    : 按16/32字节块向量化查找'$'、'*'和回车换行, 同一遍扫描中计算校验,
+*                  报文中有0x20~0x7e以外的字节时无效(与逐字节解析一致)
+* EntryParameter : data,NMEA数据, len,数据长度, spans,输出报文位置, max,spans个数
+*                  consumed,输出已扫描完的长度(末尾不完整报文的'$'偏移, 或len)
+* ReturnValue    : 返回找到的完整报文个数
+**************************************************************************************/
+int nmea_scan(const uint8_t *data, int len, struct nmea_span *spans, int max, int *consumed)
+{
+	int n = 0, ret;
+	int p, i, from, shift;
+	uint64_t m, bad;
+	nmea_vec v;
+	struct nmea_scan_state st = { .start = -1, .csum = 0, .bad = 0 };
+
+	st.acc = nmea_vzero();
+
+	// 1.整块处理, 没有事件的块直接累加校验
+	for (p = 0; p + NMEA_BLOCK <= len; p += NMEA_BLOCK) {
+		v = nmea_vload(data + p);
+		m = nmea_vmask(v, '$') | nmea_vmask(v, '*') | nmea_vmask(v, '\r') | nmea_vmask(v, '\n');
+		bad = nmea_vbad(v);
+		if (m == 0) {
+			if (st.start >= 0) {
+				st.acc = nmea_vxor(st.acc, v);
+				if (bad) st.bad = 1;
+			}
+			continue;
+		}
+
+		// 1.1 按位置依次处理块内事件, 事件之间的字节按区间累加校验
+		for (from = 0; m != 0; from = i + 1) {
+			i = __builtin_ctzll(m) / NMEA_MASK_STRIDE;
+			shift = (i + 1) * NMEA_MASK_STRIDE;
+			m = shift >= 64 ? 0 : m & (~0ULL << shift);
+
+			if (st.start >= 0) {
+				st.acc = nmea_vxor(st.acc, nmea_vrange(v, from, i));
+				if (bad & nmea_mrange(from, i)) st.bad = 1;
+			}
+			ret = nmea_scan_event(&st, data, len, p + i, &spans[n]);
+			if (ret < 0) goto incomplete;
+			if (ret > 0 && ++n >= max) {
+				*consumed = spans[n - 1].offset + spans[n - 1].len;
+				return n;
+			}
+		}
+		if (st.start >= 0) {
+			st.acc = nmea_vxor(st.acc, nmea_vrange(v, from, NMEA_BLOCK));
+			if (bad & nmea_mrange(from, NMEA_BLOCK)) st.bad = 1;
+		}
+	}
+
+	// 2.不足一块的尾部逐字节处理
+	for (; p < len; p++) {
+		if (data[p] != '$' && data[p] != '*' && data[p] != '\r' && data[p] != '\n') {
+			st.csum ^= data[p];
+			if (data[p] < 0x20 || data[p] > 0x7e) st.bad = 1;
+			continue;
+		}
+		ret = nmea_scan_event(&st, data, len, p, &spans[n]);
+		if (ret < 0) goto incomplete;
+		if (ret > 0 && ++n >= max) {
+			*consumed = spans[n - 1].offset + spans[n - 1].len;
+			return n;
+		}
+	}
+
+incomplete:
+	*consumed = st.start >= 0 ? st.start : len;
+	return n;
+}
@@ -0,0 +1,219 @@
+#include <string.h>
+#include "gps.h"
+#include "minmea.h"
+
+/**************************************************************************************
+* FunctionName   : gps_satview_swap()
+* Description    : 交换最强卫星列表中的两个位置
+* EntryParameter : v,卫星表, a,b,列表位置
+* ReturnValue    : None
+**************************************************************************************/
+static inline void gps_satview_swap(struct gps_satview *v, int a, int b)
+{
+	uint8_t t = v->top[a];
+
+	v->top[a] = v->top[b];
+	v->top[b] = t;
+	v->sats[v->top[a]].rank = a + 1;
+	v->sats[v->top[b]].rank = b + 1;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_sift()
+* Description    : 信噪比变化后把卫星移动到列表中正确的位置(从大到小)
+* EntryParameter : v,卫星表, pos,列表位置
+* ReturnValue    : None
+**************************************************************************************/
+static void gps_satview_sift(struct gps_satview *v, int pos)
+{
+	while (pos > 0 && v->sats[v->top[pos]].snr > v->sats[v->top[pos - 1]].snr) {
+		gps_satview_swap(v, pos, pos - 1);
+		pos--;
+	}
+	while (pos + 1 < v->ntop && v->sats[v->top[pos]].snr < v->sats[v->top[pos + 1]].snr) {
+		gps_satview_swap(v, pos, pos + 1);
+		pos++;
+	}
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_best()
+* Description    : 查找不在列表中信噪比最强的卫星, 只在列表变弱时调用, 直接遍历
+* EntryParameter : v,卫星表, skip,不参与查找的卫星序号
+* ReturnValue    : 返回卫星序号, 没有时返回-1
+**************************************************************************************/
+static int gps_satview_best(struct gps_satview *v, int skip)
+{
+	int k, best = -1;
+
+	for (k = 0; k < v->count; k++) {
+		if (k == skip || v->sats[k].rank) continue;
+		if (best < 0 || v->sats[k].snr > v->sats[best].snr) best = k;
+	}
+
+	return best;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_refill()
+* Description    : 列表中最弱的卫星信噪比下降后, 与列表外最强的卫星比较并替换
+* EntryParameter : v,卫星表, i,列表中最弱的卫星序号
+* ReturnValue    : None
+**************************************************************************************/
+static void gps_satview_refill(struct gps_satview *v, int i)
+{
+	int best = gps_satview_best(v, -1);
+
+	if (best < 0 || v->sats[best].snr <= v->sats[i].snr) return;
+
+	v->sats[i].rank = 0;
+	v->top[GPS_TOP_SATS - 1] = best;
+	v->sats[best].rank = GPS_TOP_SATS;
+	gps_satview_sift(v, GPS_TOP_SATS - 1);
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_rank()
+* Description    : 卫星信噪比更新后维护最强卫星列表
+* EntryParameter : v,卫星表, i,卫星序号
+* ReturnValue    : None
+**************************************************************************************/
+static void gps_satview_rank(struct gps_satview *v, int i)
+{
+	struct gps_sat *sat = &v->sats[i];
+	int last = v->ntop - 1;
+
+	// 1.已在列表中，调整位置, 成为最弱的卫星时可能要被列表外的卫星替换
+	if (sat->rank) {
+		gps_satview_sift(v, sat->rank - 1);
+		if (sat->rank == GPS_TOP_SATS) gps_satview_refill(v, i);
+		return;
+	}
+
+	// 2.列表未满，直接加入
+	if (v->ntop < GPS_TOP_SATS) {
+		v->top[v->ntop++] = i;
+		sat->rank = v->ntop;
+		gps_satview_sift(v, v->ntop - 1);
+		return;
+	}
+
+	// 3.比列表中最弱的卫星强，替换最弱的卫星
+	if (sat->snr > v->sats[v->top[last]].snr) {
+		v->sats[v->top[last]].rank = 0;
+		v->top[last] = i;
+		sat->rank = last + 1;
+		gps_satview_sift(v, last);
+	}
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_unrank()
+* Description    : 卫星从列表中删除, 从不在列表中的卫星里补充最强的一颗
+* EntryParameter : v,卫星表, i,卫星序号
+* ReturnValue    : None
+**************************************************************************************/
+static void gps_satview_unrank(struct gps_satview *v, int i)
+{
+	int k, best;
+	int pos = v->sats[i].rank - 1;
+
+	// 1.后面的卫星前移
+	for (k = pos; k + 1 < v->ntop; k++) {
+		v->top[k] = v->top[k + 1];
+		v->sats[v->top[k]].rank = k + 1;
+	}
+	v->ntop--;
+	v->sats[i].rank = 0;
+
+	// 2.列表原来是满的才可能有未加入的卫星, 卫星删除很少发生
+	if (v->ntop + 1 < GPS_TOP_SATS) return;
+	best = gps_satview_best(v, i);
+	if (best >= 0) gps_satview_rank(v, best);
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_remove()
+* Description    : 删除一颗卫星, 用最后一颗卫星填补位置
+* EntryParameter : v,卫星表, i,卫星序号
+* ReturnValue    : None
+**************************************************************************************/
+static void gps_satview_remove(struct gps_satview *v, int i)
+{
+	struct gps_sat *sat = &v->sats[i];
+	int last = v->count - 1;
+
+	if (sat->rank) gps_satview_unrank(v, i);
+	v->index[sat->talker][sat->prn] = 0;
+
+	if (i != last) {
+		*sat = v->sats[last];
+		v->index[sat->talker][sat->prn] = i + 1;
+		if (sat->rank) v->top[sat->rank - 1] = i;
+	}
+	v->count--;
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_init()
+* Description    : 初始化卫星表
+* EntryParameter : v,卫星表
+* ReturnValue    : None
+**************************************************************************************/
+void gps_satview_init(struct gps_satview *v)
+{
+	memset(v, 0, sizeof(struct gps_satview));
+}
+
+/**************************************************************************************
+* FunctionName   : gps_satview_update()
+* Description    : 用一页GSV更新卫星表, 该系统的最后一页时删除本组未出现的卫星
+* EntryParameter : v,卫星表, talker,卫星系统编号, gsv,解析后的GSV报文
+* ReturnValue    : None
+**************************************************************************************/
+void gps_satview_update(struct gps_satview *v, int talker, const struct minmea_sentence_gsv *gsv)
+{
+	int k, i;
+	struct gps_sat *sat;
+
+	// 1.第一页开始新的一组
+	if (gsv->msg_nr == 1) {
+		v->gen[talker]++;
+		v->started |= 1u << talker;
+	}
+
+	// 2.逐颗卫星更新, 新卫星加到表尾
+	for (k = 0; k < 4; k++) {
+		if (gsv->sats[k].nr <= 0 || gsv->sats[k].nr >= GPS_MAX_PRN) continue;
+
+		i = v->index[talker][gsv->sats[k].nr] - 1;
+		if (i < 0) {
+			if (v->count >= GPS_MAX_SATS) continue;
+			i = v->count++;
+			sat = &v->sats[i];
+			memset(sat, 0, sizeof(struct gps_sat));
+			sat->talker = talker;
+			sat->prn = gsv->sats[k].nr;
+			sat->snr = -1;
+			v->index[talker][sat->prn] = i + 1;
+		}
+
+		sat = &v->sats[i];
+		sat->gen = v->gen[talker];
+		sat->elevation = gsv->sats[k].elevation;
+		sat->azimuth = gsv->sats[k].azimuth;
+		if (sat->snr != gsv->sats[k].snr) {
+			sat->snr = gsv->sats[k].snr;
+			gps_satview_rank(v, i);
+		}
+	}
+
+	// 3.收全一组后删除这组没有出现的卫星(已经不可见), 没收到第一页时不删除
+	if (gsv->msg_nr < gsv->total_msgs || !(v->started & (1u << talker))) return;
+	v->started &= ~(1u << talker);
+	for (i = v->count - 1; i >= 0; i--) {
+		if (v->sats[i].talker == talker && v->sats[i].gen != v->gen[talker]) {
+			gps_satview_remove(v, i);
+		}
+	}
+}
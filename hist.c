@@ -0,0 +1,139 @@
+#include <string.h>
+#include <syslog.h>
+#include "hist.h"
+#include "pbserial.h"
+
+/**************************************************************************************
+ * * FunctionName   : hist_bucket()
+ * * Description    : 计算样本所在的桶, 小于4的值各占一个桶, 之后每个2的幂区间分4个桶
+ * * EntryParameter : value,样本值
+ * * ReturnValue    : 返回桶序号
+ * **************************************************************************************/
+static inline int hist_bucket(uint64_t value)
+{
+	int msb;
+
+	if (value < 4) return (int)value;
+
+	msb = 63 - __builtin_clzll(value);
+	if (msb > HIST_BUCKETS / 4) return HIST_BUCKETS - 1;
+
+	return (msb - 1) * 4 + (int)((value >> (msb - 2)) & 3);
+}
+
+/**************************************************************************************
+ * * FunctionName   : hist_upper()
+ * * Description    : 计算桶的上限
+ * * EntryParameter : idx,桶序号
+ * * ReturnValue    : 返回桶内的最大值
+ * **************************************************************************************/
+static inline uint64_t hist_upper(int idx)
+{
+	int msb = idx / 4 + 1;
+
+	if (idx < 4) return idx;
+
+	return ((uint64_t)(4 + idx % 4 + 1) << (msb - 2)) - 1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : hist_clear()
+ * * Description    : 清零统计数据
+ * * EntryParameter : h,直方图
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void hist_clear(struct hist *h)
+{
+	h->count = 0;
+	h->sum = 0;
+	h->min = 0;
+	h->max = 0;
+	memset(h->buckets, 0, sizeof(h->buckets));
+}
+
+/**************************************************************************************
+ * * FunctionName   : hist_init()
+ * * Description    : 初始化直方图
+ * * EntryParameter : h,直方图, name,名字, unit,单位, interval_s,输出周期(秒), 0不自动输出
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void hist_init(struct hist *h, const char *name, const char *unit, int interval_s)
+{
+	hist_clear(h);
+	h->name = name;
+	h->unit = unit;
+	h->interval_us = interval_s > 0 ? (uint64_t)interval_s * 1000000 : 0;
+	h->last_us = monotonic_us();
+}
+
+/**************************************************************************************
+ * * FunctionName   : hist_add()
+ * * Description    : 添加一个样本, 到达输出周期时输出并清零
+ * * EntryParameter : h,直方图, value,样本值
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void hist_add(struct hist *h, uint64_t value)
+{
+	uint64_t now;
+
+	if (h->count == 0 || value < h->min) h->min = value;
+	if (value > h->max) h->max = value;
+	h->sum += value;
+	h->count++;
+	h->buckets[hist_bucket(value)]++;
+
+	if (h->interval_us == 0) return;
+	now = monotonic_us();
+	if (now - h->last_us >= h->interval_us) {
+		hist_report(h);
+		h->last_us = now;
+	}
+}
+
+/**************************************************************************************
+ * * FunctionName   : hist_percentile()
+ * * Description    : 计算百分位数, 精度为所在桶的宽度(约25%)
+ * * EntryParameter : h,直方图, permille,千分位(500为p50, 990为p99)
+ * * ReturnValue    : 返回百分位数
+ * **************************************************************************************/
+uint64_t hist_percentile(struct hist *h, int permille)
+{
+	int i;
+	unsigned long seen = 0;
+	unsigned long rank = (h->count * permille + 999) / 1000;
+
+	if (h->count == 0) return 0;
+	if (rank == 0) rank = 1;
+
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank) break;
+	}
+
+	// 桶上限不超过实际最大值
+	return hist_upper(i) < h->max ? hist_upper(i) : h->max;
+}
+
+/**************************************************************************************
+ * * FunctionName   : hist_report()
+ * * Description    : 输出直方图统计到日志并清零
+ * * EntryParameter : h,直方图
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void hist_report(struct hist *h)
+{
+	if (h->count == 0) return;
+
+	syslog(LOG_NOTICE, "%s: n=%lu min=%llu avg=%llu p50=%llu p90=%llu p99=%llu max=%llu %s\n",
+			h->name, h->count, (unsigned long long)h->min,
+			(unsigned long long)(h->sum / h->count),
+			(unsigned long long)hist_percentile(h, 500),
+			(unsigned long long)hist_percentile(h, 900),
+			(unsigned long long)hist_percentile(h, 990),
+			(unsigned long long)h->max, h->unit);
+	DEBUG("%s: n=%lu p50=%llu p99=%llu max=%llu %s\n", h->name, h->count,
+			(unsigned long long)hist_percentile(h, 500),
+			(unsigned long long)hist_percentile(h, 990),
+			(unsigned long long)h->max, h->unit)
+	hist_clear(h);
+}
@@ -0,0 +1,58 @@
+#ifndef _HIST_H_
+#define _HIST_H_
+
+#include "pbserial.h"
+
+/**************************************************************************************
+* Description    : 直方图桶个数, 每个2的幂区间分4个桶, 覆盖0~2^32
+**************************************************************************************/
+#define HIST_BUCKETS                    128
+
+/**************************************************************************************
+* Description    : 延迟直方图, 只在一个线程中使用, 按周期输出到日志后清零
+**************************************************************************************/
+struct hist {
+	const char *name;                         // 名字
+	const char *unit;                         // 单位
+	unsigned long count;                      // 样本个数
+	uint64_t sum;                             // 样本总和
+	uint64_t min;                             // 最小值
+	uint64_t max;                             // 最大值
+	uint64_t last_us;                         // 上次输出时间
+	uint64_t interval_us;                     // 输出周期, 0表示不自动输出
+	unsigned int buckets[HIST_BUCKETS];       // 各桶样本个数
+};
+
+/**************************************************************************************
+ * * FunctionName   : hist_init()
+ * * Description    : 初始化直方图
+ * * EntryParameter : h,直方图, name,名字, unit,单位, interval_s,输出周期(秒), 0不自动输出
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void hist_init(struct hist *h, const char *name, const char *unit, int interval_s);
+
+/**************************************************************************************
+ * * FunctionName   : hist_add()
+ * * Description    : 添加一个样本, 到达输出周期时输出并清零
+ * * EntryParameter : h,直方图, value,样本值
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void hist_add(struct hist *h, uint64_t value);
+
+/**************************************************************************************
+ * * FunctionName   : hist_percentile()
+ * * Description    : 计算百分位数, 精度为所在桶的宽度(约25%)
+ * * EntryParameter : h,直方图, permille,千分位(500为p50, 990为p99)
+ * * ReturnValue    : 返回百分位数
+ * **************************************************************************************/
+uint64_t hist_percentile(struct hist *h, int permille);
+
+/**************************************************************************************
+ * * FunctionName   : hist_report()
+ * * Description    : 输出直方图统计到日志并清零
+ * * EntryParameter : h,直方图
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void hist_report(struct hist *h);
+
+#endif /* _HIST_H_ */
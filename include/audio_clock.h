@@ -0,0 +1,95 @@
+#ifndef _AUDIO_CLOCK_H_
+#define _AUDIO_CLOCK_H_
+
+#include <stdint.h>
+#include "hist.h"
+
+/**************************************************************************************
+* Description    : 音频时钟参数
+**************************************************************************************/
+#define CLOCK_WINDOW_FRAMES             250          // 每5s(20ms帧)估计一次codec时钟
+#define CLOCK_BLOCK_US                  500          // 设备调用阻塞超过该时间认为在等待codec
+#define CLOCK_MAX_PPM                   2000         // 周期修正的最大范围
+#define CLOCK_STEP_PPM                  100          // 一直没有等待codec时每个窗口加快的量
+
+/**************************************************************************************
+* Description    : 音频帧时钟, CLOCK_MONOTONIC的timerfd按帧周期唤醒I/O线程
+*                  根据阻塞的录音/播放调用返回时刻(codec的帧边界)估计codec实际周期,
+*                  修正定时周期, 使定时与codec同步, 只在音频I/O线程中使用
+**************************************************************************************/
+struct audio_clock {
+	int fd;                                   // timerfd
+	int running;                              // 定时器运行中
+	int64_t nominal_ns;                       // 标称帧周期
+	int64_t period_ns;                        // 修正后的帧周期
+	uint64_t next_ns;                         // 下一帧的到期时间(绝对时间)
+	unsigned long frames;                     // 本次运行的帧数
+	unsigned long window;                     // 当前估计窗口的起始帧
+	unsigned long first_frame;                // 窗口内第一次等待codec的帧
+	unsigned long last_frame;                 // 窗口内最后一次等待codec的帧
+	uint64_t first_us;                        // 窗口内第一次等待codec结束的时间
+	uint64_t last_us;                         // 窗口内最后一次等待codec结束的时间
+	unsigned long late;                       // 唤醒时已经超过一帧周期的次数
+	struct hist wakeup;                       // 每帧唤醒延迟
+};
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_init()
+ * * Description    : 初始化音频时钟
+ * * EntryParameter : c,音频时钟, period_us,帧周期, interval,统计输出周期(秒)
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_clock_init(struct audio_clock *c, int period_us, int interval);
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_free()
+ * * Description    : 释放音频时钟
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_free(struct audio_clock *c);
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_start()
+ * * Description    : 开始定时, 第一帧立即到期, 保留上次的周期修正
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_start(struct audio_clock *c);
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_stop()
+ * * Description    : 停止定时, 空闲时线程不再被定时器唤醒
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_stop(struct audio_clock *c);
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_wait()
+ * * Description    : 等待下一帧到期, 并设置再下一帧的到期时间
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : 返回到期的单调时间(us)
+ * **************************************************************************************/
+uint64_t audio_clock_wait(struct audio_clock *c);
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_sync()
+ * * Description    : 每帧调用一次, 输入本帧阻塞的设备调用的开始和结束时间, 修正帧周期
+ * * EntryParameter : c,音频时钟, begin,调用开始时间(us), end,调用结束时间(us)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_clock_sync(struct audio_clock *c, uint64_t begin, uint64_t end);
+
+/**************************************************************************************
+ * * FunctionName   : audio_clock_ppm()
+ * * Description    : 获取当前周期修正量
+ * * EntryParameter : c,音频时钟
+ * * ReturnValue    : 返回修正量(ppm), 正数表示codec比单调时钟慢
+ * **************************************************************************************/
+static inline int audio_clock_ppm(struct audio_clock *c)
+{
+	return (int)((c->period_ns - c->nominal_ns) * 1000000 / c->nominal_ns);
+}
+
+#endif /* _AUDIO_CLOCK_H_ */
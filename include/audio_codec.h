@@ -0,0 +1,136 @@
+#ifndef _AUDIO_CODEC_H_
+#define _AUDIO_CODEC_H_
+
+#include <stdint.h>
+#include <speex/speex.h>
+
+/**************************************************************************************
+* Description    : 压缩音频数据由若干帧记录组成, 每条记录对应20ms,
+*                  记录头为类型(1字节)+长度(1字节), 后面是该帧编码后的数据
+**************************************************************************************/
+#define AUDIO_REC_HEAD                  2            // 记录头长度
+#define AUDIO_REC_MAXLEN                255          // 记录数据最大长度
+#define AUDIO_REC_VOICE                 0            // 一帧编码后的语音
+#define AUDIO_REC_SILENCE               1            // 连续静音: 帧数(2字节,小端)+舒适噪声电平(1字节)
+#define AUDIO_REC_SILENCE_LEN           3
+
+/**************************************************************************************
+* Description    : 舒适噪声电平, 单位为-dBFS, 127表示完全静音
+**************************************************************************************/
+#define AUDIO_CNG_MUTE                  127
+
+/**************************************************************************************
+* Description    : IMA-ADPCM每帧数据: 预测值(2字节,小端)+步长序号(1字节)+每个采样4位
+*                  每帧带起始状态, 可以独立解码, 丢帧不影响后续帧
+**************************************************************************************/
+#define ADPCM_HEAD                      3
+#define ADPCM_FRAME_SIZE(samples)       (ADPCM_HEAD + ((samples) + 1) / 2)
+
+/**************************************************************************************
+* Description    : 缺省speex编码质量(0~10), 8对应窄带15kbit/s(每帧38字节), 宽带27.8kbit/s(每帧70字节)
+**************************************************************************************/
+#define SPEEX_QUALITY                   8
+
+/**************************************************************************************
+* Description    : IMA-ADPCM编解码状态
+**************************************************************************************/
+struct adpcm_state {
+	int pred;                                 // 预测值
+	int index;                                // 步长序号
+};
+
+/**************************************************************************************
+* Description    : 音频编码器, 每次输入一帧PCM, 输出一帧编码数据
+**************************************************************************************/
+struct audio_encoder {
+	int codec;                                // 编码方式CODEC__xxx
+	int samples;                              // 每帧采样数
+	void *speex;                              // speex编码器
+	SpeexBits bits;                           // speex码流
+	struct adpcm_state adpcm;                 // ADPCM编码状态
+};
+
+/**************************************************************************************
+* Description    : 音频解码器, 每次输入一帧编码数据, 输出一帧PCM
+**************************************************************************************/
+struct audio_decoder {
+	int samples;                              // 每帧采样数
+	uint32_t seed;                            // 舒适噪声随机数种子
+	void *speex;                              // speex解码器
+	SpeexBits bits;                           // speex码流
+};
+
+/**************************************************************************************
+ * * FunctionName   : audio_codec_lookup()
+ * * Description    : 根据名字获取编码方式
+ * * EntryParameter : name,编码名字(speex/adpcm/raw)
+ * * ReturnValue    : 返回CODEC__xxx, 不支持时返回-1
+ * **************************************************************************************/
+int audio_codec_lookup(const char *name);
+
+/**************************************************************************************
+ * * FunctionName   : audio_encoder_init()
+ * * Description    : 初始化编码器
+ * * EntryParameter : enc,编码器, codec,编码方式CODEC__xxx, samples,每帧采样数, quality,speex编码质量
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_encoder_init(struct audio_encoder *enc, int codec, int samples, int quality);
+
+/**************************************************************************************
+ * * FunctionName   : audio_encoder_reset()
+ * * Description    : 开始新的录音时复位编码状态
+ * * EntryParameter : enc,编码器
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_encoder_reset(struct audio_encoder *enc);
+
+/**************************************************************************************
+ * * FunctionName   : audio_encoder_free()
+ * * Description    : 释放编码器
+ * * EntryParameter : enc,编码器
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_encoder_free(struct audio_encoder *enc);
+
+/**************************************************************************************
+ * * FunctionName   : audio_encode()
+ * * Description    : 编码一帧PCM, 不带记录头
+ * * EntryParameter : enc,编码器, pcm,一帧PCM, out,输出缓冲区, size,缓冲区大小
+ * * ReturnValue    : 返回编码后的长度, 失败返回-1
+ * **************************************************************************************/
+int audio_encode(struct audio_encoder *enc, int16_t *pcm, uint8_t *out, int size);
+
+/**************************************************************************************
+ * * FunctionName   : audio_decoder_init()
+ * * Description    : 初始化解码器, 支持所有编码方式
+ * * EntryParameter : dec,解码器, samples,每帧采样数
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_decoder_init(struct audio_decoder *dec, int samples);
+
+/**************************************************************************************
+ * * FunctionName   : audio_decoder_free()
+ * * Description    : 释放解码器
+ * * EntryParameter : dec,解码器
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_decoder_free(struct audio_decoder *dec);
+
+/**************************************************************************************
+ * * FunctionName   : audio_cng_level()
+ * * Description    : 计算一帧静音的舒适噪声电平
+ * * EntryParameter : pcm,一帧PCM, samples,采样数
+ * * ReturnValue    : 返回电平(-dBFS), 0~AUDIO_CNG_MUTE
+ * **************************************************************************************/
+int audio_cng_level(const int16_t *pcm, int samples);
+
+/**************************************************************************************
+ * * FunctionName   : audio_decode()
+ * * Description    : 解码一帧数据(不带记录头), 输出samples个采样
+ *                    codec为CODEC__NONE时data[0]为舒适噪声电平, 输出该电平的噪声
+ * * EntryParameter : dec,解码器, codec,编码方式CODEC__xxx, data,编码数据, len,数据长度, pcm,输出PCM
+ * * ReturnValue    : 成功返回0, 数据错误或不支持的编码返回-1
+ * **************************************************************************************/
+int audio_decode(struct audio_decoder *dec, int codec, const uint8_t *data, int len, int16_t *pcm);
+
+#endif /* _AUDIO_CODEC_H_ */
@@ -0,0 +1,46 @@
+#ifndef _AUDIO_DSP_H_
+#define _AUDIO_DSP_H_
+
+#include <speex/speex_echo.h>
+#include "speex/speex_preprocess.h"
+
+/**************************************************************************************
+* Description    : 上行语音处理参数
+**************************************************************************************/
+#define ECHO_TAIL_MS                    300          // 回声消除的尾长, 8k时2400个采样
+
+/**************************************************************************************
+* Description    : 上行语音处理(回声消除, 噪声抑制和VAD), 只在DSP线程中使用
+**************************************************************************************/
+struct audio_dsp {
+	SpeexEchoState *e_st;                     // 回音消除器
+	SpeexPreprocessState *d_st;               // 噪音消除器
+	int samples;                              // 每帧采样数
+	int rate;                                 // 采样率
+};
+
+/**************************************************************************************
+ * * FunctionName   : audio_dsp_init()
+ * * Description    : 创建并配置回音消除器和噪音消除器, 音频模块和基准测试使用同一配置
+ * * EntryParameter : dsp,语音处理, samples,每帧采样数, rate,采样率
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int audio_dsp_init(struct audio_dsp *dsp, int samples, int rate);
+
+/**************************************************************************************
+ * * FunctionName   : audio_dsp_reset()
+ * * Description    : 录音结束时复位回音消除器和噪音消除器, 下次录音不使用上次的回声路径和噪声估计
+ * * EntryParameter : dsp,语音处理
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_dsp_reset(struct audio_dsp *dsp);
+
+/**************************************************************************************
+ * * FunctionName   : audio_dsp_free()
+ * * Description    : 释放回音消除器和噪音消除器
+ * * EntryParameter : dsp,语音处理
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void audio_dsp_free(struct audio_dsp *dsp);
+
+#endif /* _AUDIO_DSP_H_ */
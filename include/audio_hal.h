@@ -0,0 +1,35 @@
+#ifndef _AUDIO_HAL_H_
+#define _AUDIO_HAL_H_
+
+#include <stdint.h>
+
+/**************************************************************************************
+* Description    : 音频设备接口, 录音和播放都以20ms帧为单位, 调用阻塞到设备可以接收或者
+*                  产生一帧为止(与codec同步), 只在音频I/O线程中调用(open/close除外)
+**************************************************************************************/
+struct audio_hal {
+	const char *name;                                      // 后端名字, 对应配置[AUDIO] device
+	int (*open)(int rate, int frame_size);                 // 打开播放设备, 配置混音器
+	void (*close)(void);                                   // 关闭播放设备
+	int (*record_open)(void);                              // 开始录音
+	int (*record_read)(int16_t *pcm);                      // 读取一帧录音, 返回字节数
+	void (*record_close)(void);                            // 结束录音
+	int (*play)(const int16_t *pcm);                       // 播放一帧, 返回字节数
+};
+
+/**************************************************************************************
+* Description    : 音频设备后端, 模块上使用移远SDK, 主机上使用WAV文件录音和文件/空播放
+*                  audio_hal_quectel在hal_quectel.c中定义, 主机编译不链接该文件时为NULL
+**************************************************************************************/
+extern const struct audio_hal audio_hal_quectel __attribute__((weak));
+extern const struct audio_hal audio_hal_file;
+
+/**************************************************************************************
+ * * FunctionName   : audio_hal_select()
+ * * Description    : 按名字选择并打开音频设备后端, 名字错误或者后端没有编译进来时失败
+ * * EntryParameter : name,后端名字(quectel/file), rate,采样率, frame_size,一帧字节数
+ * * ReturnValue    : 返回打开的后端, 后端不存在或者打开失败返回NULL
+ * **************************************************************************************/
+const struct audio_hal *audio_hal_select(const char *name, int rate, int frame_size);
+
+#endif /* _AUDIO_HAL_H_ */
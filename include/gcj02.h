@@ -0,0 +1,44 @@
+#ifndef _GCJ02_H_
+#define _GCJ02_H_
+
+/**************************************************************************************
+* Description    : 经纬度坐标(度)
+**************************************************************************************/
+struct geo_point {
+	double lat;
+	double lon;
+};
+
+/**************************************************************************************
+ * * FunctionName   : gcj02_init()
+ * * Description    : 生成偏移查找表, 转换前调用一次, 重复调用直接返回
+ * * EntryParameter : None
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void gcj02_init(void);
+
+/**************************************************************************************
+ * * FunctionName   : wgs84_to_gcj02()
+ * * Description    : WGS84坐标转换为GCJ02坐标, 查表插值实现, 国外坐标不转换
+ * * EntryParameter : in,WGS84坐标, out,输出GCJ02坐标(可以与in相同)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void wgs84_to_gcj02(const struct geo_point *in, struct geo_point *out);
+
+/**************************************************************************************
+ * * FunctionName   : wgs84_to_gcj02_batch()
+ * * Description    : 批量转换WGS84坐标为GCJ02坐标
+ * * EntryParameter : in,WGS84坐标数组, out,输出GCJ02坐标数组(可以与in相同), n,坐标个数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void wgs84_to_gcj02_batch(const struct geo_point *in, struct geo_point *out, int n);
+
+/**************************************************************************************
+ * * FunctionName   : wgs84_to_gcj02_ref()
+ * * Description    : WGS84坐标转换为GCJ02坐标, 三角函数参考实现, 用于校验和基准测试
+ * * EntryParameter : in,WGS84坐标, out,输出GCJ02坐标(可以与in相同)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void wgs84_to_gcj02_ref(const struct geo_point *in, struct geo_point *out);
+
+#endif /* _GCJ02_H_ */
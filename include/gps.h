@@ -3,21 +3,204 @@
 
 #include "minmea.h"
 
+/**************************************************************************************
+ * * Description    : 模块配置定义
+ * **************************************************************************************/
+#define GPS_NMEA_MAXLEN        82                      // NMEA语句最大长度
+#define GPS_MAX_SATS           96                      // 卫星表最多保存的卫星个数(多系统)
+#define GPS_TOP_SATS           20                      // 输出给电子地图的信噪比最强卫星个数
+#define GPS_MAX_PRN            256                     // 卫星编号范围
+#define GPS_UTC_MAXLEN         11                      // UTC时间字段最大长度(hhmmss.sss)
+#define GPS_MASK(id)           (1u << (id))            // 报文ID对应的掩码位
+
+/**************************************************************************************
+* Description    : 卫星系统编号(NMEA talker)
+**************************************************************************************/
+enum {
+	GPS_TALKER_GP = 0,                         // GPS
+	GPS_TALKER_GL,                             // GLONASS
+	GPS_TALKER_GA,                             // Galileo
+	GPS_TALKER_BD,                             // 北斗(BD/GB)
+	GPS_TALKER_GQ,                             // QZSS
+	GPS_TALKER_GI,                             // NavIC
+	GPS_TALKER_OTHER,                          // 其他
+	GPS_TALKERS,
+};
+
+/**************************************************************************************
+* Description    : 卫星表中的一颗卫星
+**************************************************************************************/
+struct gps_sat {
+	uint8_t talker;                            // 卫星系统
+	uint8_t gen;                               // 最后一次出现在该系统第几组GSV
+	uint8_t rank;                              // 在最强卫星列表中的位置+1, 0表示不在列表中
+	short prn;                                 // 卫星编号
+	short elevation;                           // 仰角
+	short azimuth;                             // 方位角
+	short snr;                                 // 信噪比
+};
+
+/**************************************************************************************
+* Description    : 多系统卫星表, 按talker+PRN索引, 随GSV逐页增量更新,
+*                  同时维护按信噪比从大到小排序的最强卫星列表
+**************************************************************************************/
+struct gps_satview {
+	int count;                                 // 卫星个数
+	int ntop;                                  // 最强卫星列表中的卫星个数
+	uint8_t gen[GPS_TALKERS];                  // 各系统当前GSV组序号
+	unsigned int started;                      // 收到第一页GSV的系统
+	uint8_t top[GPS_TOP_SATS];                 // 最强卫星列表, 卫星在sats中的序号
+	uint8_t index[GPS_TALKERS][GPS_MAX_PRN];   // talker+PRN到sats序号+1的索引, 0表示没有
+	struct gps_sat sats[GPS_MAX_SATS];         // 卫星数据
+};
+
 struct gpsinfo {
-	int ngsv;
+	unsigned int mask;                         // 已解析的报文, GPS_MASK(MINMEA_SENTENCE_xxx)
 	struct minmea_sentence_rmc rmc;
 	struct minmea_sentence_gsa gsa;
-	struct minmea_sentence_gsv gsv[5];
 	struct minmea_sentence_gga gga;
 	struct minmea_sentence_vtg vtg;
+	uint64_t rx_us;                            // 第一条报文的接收时间(单调时钟us)
+	struct gps_satview *view;                  // 卫星表, 跨历元保持, 为NULL时不解析GSV
 };
 
 /**************************************************************************************
-* FunctionName   : gpsbuffer_to_gpsinfo()
-* Description    : NMEA数据转换
-* EntryParameter :
+* Description    : NMEA完整报文回调, sentence以'\0'结尾
+**************************************************************************************/
+typedef void (*nmea_sentence_cb)(const char *sentence, int len, uint64_t rx_us, void *priv);
+
+/**************************************************************************************
+* Description    : NMEA流解析器, 在多次输入之间保持状态
+**************************************************************************************/
+struct nmea_stream {
+	int state;                                 // 解析状态
+	int len;                                   // 当前报文长度
+	uint8_t csum;                              // 当前报文计算的校验
+	uint8_t expect;                            // 报文携带的校验
+	char sentence[GPS_NMEA_MAXLEN + 1];        // 当前报文
+	nmea_sentence_cb cb;                       // 完整报文回调
+	void *priv;                                // 回调私有数据
+	uint64_t rx_us;                            // 当前输入的接收时间
+	unsigned long sentences;                   // 输出的报文个数
+	unsigned long dropped;                     // 丢弃的报文个数
+};
+
+/**************************************************************************************
+* Description    : 历元组装器输出的定位数据回调, 每个历元只输出一次
+**************************************************************************************/
+typedef void (*gps_fix_cb)(struct gpsinfo *info, void *priv);
+
+/**************************************************************************************
+* Description    : GNSS历元组装器, 按UTC时间把RMC/GGA/GSA/GSV/VTG组合成一个完整定位
+**************************************************************************************/
+struct gps_epoch {
+	struct gpsinfo info;                       // 当前历元数据
+	struct gps_satview view;                   // 卫星表, 跨历元增量更新
+	char utc[GPS_UTC_MAXLEN + 1];              // 当前历元UTC时间(RMC/GGA原始时间字段)
+	unsigned int gsv_seen;                     // 已收到GSV的系统(按talker)
+	unsigned int gsv_open;                     // GSV未收全的系统
+	unsigned int profile;                      // 上一个完整历元包含的报文
+	unsigned int profile_gsv;                  // 上一个完整历元包含GSV的系统
+	int sentences;                             // 当前历元的报文个数
+	int emitted;                               // 当前历元已经输出
+	uint64_t timeout_us;                       // 不完整历元的超时时间
+	uint64_t opened_us;                        // 当前历元第一条报文的接收时间
+	gps_fix_cb cb;                             // 定位数据回调
+	void *priv;                                // 回调私有数据
+	unsigned long fixes;                       // 输出的完整历元个数
+	unsigned long partial;                     // 超时或被打断后输出的不完整历元个数
+	unsigned long dropped;                     // 没有RMC而丢弃的历元个数
+};
+
+/**************************************************************************************
+* FunctionName   : gps_talker()
+* Description    : 获取报文的卫星系统编号
+* EntryParameter : sentence, NMEA报文指针
+* ReturnValue    : 返回卫星系统编号GPS_TALKER_xxx
+**************************************************************************************/
+int gps_talker(const char *sentence);
+
+/**************************************************************************************
+* FunctionName   : gps_satview_init()
+* Description    : 初始化卫星表
+* EntryParameter : v,卫星表
 * ReturnValue    : None
 **************************************************************************************/
-void gpsbuffer_to_gpsinfo(struct gpsinfo *info, uint8_t *data, int16_t len);
+void gps_satview_init(struct gps_satview *v);
+
+/**************************************************************************************
+* FunctionName   : gps_satview_update()
+* Description    : 用一页GSV更新卫星表, 该系统的最后一页时删除本组未出现的卫星
+* EntryParameter : v,卫星表, talker,卫星系统编号, gsv,解析后的GSV报文
+* ReturnValue    : None
+**************************************************************************************/
+void gps_satview_update(struct gps_satview *v, int talker, const struct minmea_sentence_gsv *gsv);
+
+/**************************************************************************************
+* FunctionName   : gps_sentence_id()
+* Description    : 获取已校验报文的ID, 不再重复计算校验
+* EntryParameter : sentence, NMEA报文指针
+* ReturnValue    : 返回报文ID
+**************************************************************************************/
+enum minmea_sentence_id gps_sentence_id(const char *sentence);
+
+/**************************************************************************************
+* FunctionName   : gps_parse()
+* Description    : 解析NMEA报文数据, 报文由nmea_stream输出, 校验已经检查过
+* EntryParameter : info,GPS数据结构, sentence, NMEA报文指针
+* ReturnValue    : 返回报文ID
+**************************************************************************************/
+enum minmea_sentence_id gps_parse(struct gpsinfo *info, const char *sentence);
+
+/**************************************************************************************
+* FunctionName   : nmea_stream_init()
+* Description    : 初始化NMEA流解析器
+* EntryParameter : s,流解析器, cb,完整报文回调, priv,回调私有数据
+* ReturnValue    : None
+**************************************************************************************/
+void nmea_stream_init(struct nmea_stream *s, nmea_sentence_cb cb, void *priv);
+
+/**************************************************************************************
+* FunctionName   : nmea_stream_feed()
+* Description    : 输入NMEA数据, 报文可以跨多次输入, 不修改输入数据
+*                  空闲时整段向量化扫描并校验, 末尾不完整的报文逐字节处理,
+*                  收到校验码最后一个字符时立即输出报文
+* EntryParameter : s,流解析器, data,NMEA数据, len,数据长度, rx_us,数据接收时间, 随报文输出
+* ReturnValue    : 返回本次输出的报文个数
+**************************************************************************************/
+int nmea_stream_feed(struct nmea_stream *s, const uint8_t *data, int len, uint64_t rx_us);
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_init()
+* Description    : 初始化历元组装器
+* EntryParameter : ep,历元组装器, timeout_ms,不完整历元超时时间, cb,定位数据回调, priv,回调私有数据
+* ReturnValue    : None
+**************************************************************************************/
+void gps_epoch_init(struct gps_epoch *ep, int timeout_ms, gps_fix_cb cb, void *priv);
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_sentence()
+* Description    : 输入一条已校验的报文, UTC时间变化或报文重复时结束上一个历元,
+*                  当前历元包含上一个完整历元的全部报文时立即输出
+* EntryParameter : ep,历元组装器, sentence,NMEA报文, rx_us,报文接收时间(单调时钟us)
+* ReturnValue    : 返回报文ID
+**************************************************************************************/
+enum minmea_sentence_id gps_epoch_sentence(struct gps_epoch *ep, const char *sentence, uint64_t rx_us);
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_poll()
+* Description    : 检查当前历元是否超时, 超时且有RMC时输出不完整历元
+* EntryParameter : ep,历元组装器, now,当前单调时间(us)
+* ReturnValue    : None
+**************************************************************************************/
+void gps_epoch_poll(struct gps_epoch *ep, uint64_t now);
+
+/**************************************************************************************
+* FunctionName   : gps_epoch_deadline()
+* Description    : 获取当前历元的超时时间
+* EntryParameter : ep,历元组装器
+* ReturnValue    : 返回超时的单调时间(us), 没有等待输出的历元时返回0
+**************************************************************************************/
+uint64_t gps_epoch_deadline(struct gps_epoch *ep);
 
 #endif
@@ -0,0 +1,23 @@
+#ifndef _GPS_PREDICT_H_
+#define _GPS_PREDICT_H_
+
+#include "iav2hp.h"
+
+/**************************************************************************************
+ * * FunctionName   : gps_predict()
+ * * Description    : 按航向(m_orient)和速度(m_speed)从上一个定位推算dt秒后的位置,
+ * *                  短时间内按匀速直线运动, 使用局部平面近似
+ * * EntryParameter : from,上一个定位, dt,推算时间(秒), to,输出推算的定位(可以与from相同)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void gps_predict(const av2hp_gpsInfo *from, double dt, av2hp_gpsInfo *to);
+
+/**************************************************************************************
+ * * FunctionName   : gps_distance()
+ * * Description    : 计算两个定位之间的水平距离, 局部平面近似, 适用于几百米以内
+ * * EntryParameter : a,b,定位
+ * * ReturnValue    : 返回距离(米)
+ * **************************************************************************************/
+double gps_distance(const av2hp_gpsInfo *a, const av2hp_gpsInfo *b);
+
+#endif /* _GPS_PREDICT_H_ */
@@ -0,0 +1,106 @@
+#ifndef _JITTER_H_
+#define _JITTER_H_
+
+#include <stdint.h>
+#include "hist.h"
+
+/**************************************************************************************
+* Description    : 抖动缓冲参数
+**************************************************************************************/
+#define JITTER_MAX_SAMPLES              320          // 每帧最大采样数(16k/20ms)
+#define JITTER_CONCEAL_FRAMES           3            // 欠载时重复上一帧并淡出的帧数
+#define JITTER_END_FRAMES               10           // 连续欠载超过该帧数认为语音结束
+#define JITTER_SLACK_FRAMES             2            // 缓冲超过目标深度该帧数时丢弃静音帧
+#define JITTER_DRIFT_US                 50           // 每条消息基准延迟的回升量, 跟随两端时钟漂移
+
+/**************************************************************************************
+* Description    : 抖动缓冲状态
+**************************************************************************************/
+enum {
+	JITTER_IDLE = 0,                          // 没有语音
+	JITTER_BUFFERING,                         // 开始播放或者欠载后缓冲到目标深度
+	JITTER_PLAYING,                           // 正常播放
+	JITTER_CONCEAL,                           // 欠载, 重复上一帧并淡出, 之后播放静音
+};
+
+/**************************************************************************************
+* Description    : 每帧的处理方式
+**************************************************************************************/
+enum {
+	JITTER_NONE = 0,                          // 不播放
+	JITTER_PLAY,                              // 播放队列中的第一帧, 播放后调用jitter_played()
+	JITTER_SKIP,                              // 丢弃队列中的第一帧(缓冲过深时的静音帧)
+	JITTER_FILL,                              // 播放jitter_fill()生成的补偿帧或静音
+};
+
+/**************************************************************************************
+* Description    : 自适应抖动缓冲, 只在音频I/O线程中使用
+*                  按消息到达时间与媒体时间的差估计抖动, 目标深度跟随抖动峰值
+**************************************************************************************/
+struct jitter {
+	int state;                                // 状态JITTER_xxx
+	int samples;                              // 每帧采样数
+	int frame_us;                             // 每帧时长(us)
+	int min_frames;                           // 最小目标深度(帧)
+	int max_frames;                           // 最大目标深度(帧)
+	int target;                               // 当前目标深度(帧)
+	int gap;                                  // 连续欠载的帧数
+	unsigned long index;                      // 本段语音已播放的帧数, 即媒体时间
+	uint64_t last_rx;                         // 上一帧的接收时间, 用于判断消息边界
+	int64_t base;                             // 最小传输延迟(接收时间-媒体时间)
+	int64_t jitter;                           // 抖动峰值估计(us)
+	unsigned long underruns;                  // 欠载次数
+	unsigned long skips;                      // 缓冲过深丢弃的静音帧数
+	struct hist latency;                      // 每帧从接收到播放的延迟
+	struct hist underrun;                     // 每次欠载的帧数
+	struct hist estimate;                     // 每条消息到达时的抖动估计
+	char names[3][32];                        // 统计名字, 多路播放时区分各路
+	int16_t last[JITTER_MAX_SAMPLES];         // 上一帧播放的数据, 欠载时重复
+	int16_t fill[JITTER_MAX_SAMPLES];         // 补偿帧
+};
+
+/**************************************************************************************
+ * * FunctionName   : jitter_init()
+ * * Description    : 初始化抖动缓冲
+ * * EntryParameter : jb,抖动缓冲, name,统计名字前缀, samples,每帧采样数, frame_us,每帧时长, min_ms,max_ms,目标延迟范围,
+ *                    interval,统计输出周期(秒)
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void jitter_init(struct jitter *jb, const char *name, int samples, int frame_us, int min_ms, int max_ms, int interval);
+
+/**************************************************************************************
+ * * FunctionName   : jitter_action()
+ * * Description    : 每帧周期调用一次, 决定本周期的处理方式
+ * * EntryParameter : jb,抖动缓冲, depth,队列中的帧数, head_rx,第一帧接收时间, head_silent,第一帧是否为静音, now,当前时间
+ * * ReturnValue    : 返回JITTER_xxx
+ * **************************************************************************************/
+int jitter_action(struct jitter *jb, int depth, uint64_t head_rx, int head_silent, uint64_t now);
+
+/**************************************************************************************
+ * * FunctionName   : jitter_played()
+ * * Description    : 队列中的一帧已播放, 更新抖动估计和目标深度
+ * * EntryParameter : jb,抖动缓冲, pcm,播放的数据, rx_us,接收时间, now,当前时间
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void jitter_played(struct jitter *jb, const int16_t *pcm, uint64_t rx_us, uint64_t now);
+
+/**************************************************************************************
+ * * FunctionName   : jitter_fill()
+ * * Description    : 生成补偿帧, 欠载开始时重复上一帧并淡出, 之后为静音
+ * * EntryParameter : jb,抖动缓冲
+ * * ReturnValue    : 返回补偿帧
+ * **************************************************************************************/
+int16_t *jitter_fill(struct jitter *jb);
+
+/**************************************************************************************
+ * * FunctionName   : jitter_active()
+ * * Description    : 是否在播放一段语音(包括缓冲和欠载补偿)
+ * * EntryParameter : jb,抖动缓冲
+ * * ReturnValue    : 返回1表示正在播放
+ * **************************************************************************************/
+static inline int jitter_active(struct jitter *jb)
+{
+	return jb->state != JITTER_IDLE;
+}
+
+#endif /* _JITTER_H_ */
@@ -0,0 +1,64 @@
+#ifndef _MIXER_H_
+#define _MIXER_H_
+
+#include <stdint.h>
+
+/**************************************************************************************
+* Description    : 混音参数, 增益为Q15定点数
+**************************************************************************************/
+#define MIXER_UNITY                     32767        // 增益1.0(不衰减)
+#define MIXER_DUCK_ATTACK               2            // 压低其他流的帧数(40ms)
+#define MIXER_DUCK_RELEASE              10           // 恢复其他流的帧数(200ms)
+
+/**************************************************************************************
+ * * FunctionName   : mixer_scale_add()
+ * * Description    : 一帧乘以增益后饱和累加到混音结果, acc = sat(acc + pcm * gain)
+ *                    增益为MIXER_UNITY时直接饱和相加, 单路播放时结果与原始数据相同
+ * * EntryParameter : acc,混音结果, pcm,一帧数据, gain,Q15增益, n,采样数
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void mixer_scale_add(int16_t *acc, const int16_t *pcm, int gain, int n);
+
+/**************************************************************************************
+ * * FunctionName   : mixer_gain_db()
+ * * Description    : 分贝转换为Q15增益, 不大于0dB
+ * * EntryParameter : db,分贝
+ * * ReturnValue    : 返回Q15增益
+ * **************************************************************************************/
+int mixer_gain_db(int db);
+
+/**************************************************************************************
+ * * FunctionName   : mixer_gain_mul()
+ * * Description    : 两个Q15增益相乘, 任一个为MIXER_UNITY时返回另一个,
+ *                    保证音量和压低增益都不衰减时结果仍为MIXER_UNITY(直接相加)
+ * * EntryParameter : a,Q15增益, b,Q15增益
+ * * ReturnValue    : 返回Q15增益
+ * **************************************************************************************/
+static inline int mixer_gain_mul(int a, int b)
+{
+	if (a >= MIXER_UNITY) return b;
+	if (b >= MIXER_UNITY) return a;
+
+	return (a * b + 0x4000) >> 15;
+}
+
+/**************************************************************************************
+ * * FunctionName   : mixer_duck_step()
+ * * Description    : 压低增益每帧向目标靠近一步, 压低MIXER_DUCK_ATTACK帧完成, 恢复MIXER_DUCK_RELEASE帧完成
+ * * EntryParameter : cur,当前增益, target,目标增益
+ * * ReturnValue    : 返回本帧增益
+ * **************************************************************************************/
+static inline int mixer_duck_step(int cur, int target)
+{
+	int step;
+
+	if (cur > target) {
+		step = (MIXER_UNITY + MIXER_DUCK_ATTACK - 1) / MIXER_DUCK_ATTACK;
+		return cur - step < target ? target : cur - step;
+	}
+	step = (MIXER_UNITY + MIXER_DUCK_RELEASE - 1) / MIXER_DUCK_RELEASE;
+
+	return cur + step > target ? target : cur + step;
+}
+
+#endif /* _MIXER_H_ */
@@ -0,0 +1,22 @@
+#ifndef _NMEA_LOCAL_H_
+#define _NMEA_LOCAL_H_
+
+/**************************************************************************************
+ * * FunctionName   : nmea_local_open()
+ * * Description    : 打开本地NMEA数据源, 根据路径类型选择打开方式:
+ * *                  串口设备按波特率配置, FIFO以读写方式打开(写端关闭时不会读到EOF),
+ * *                  Unix套接字连接到服务端
+ * * EntryParameter : path,数据源路径, baud,串口波特率(其他类型忽略)
+ * * ReturnValue    : 返回非阻塞句柄或者错误码
+ * **************************************************************************************/
+int nmea_local_open(const char *path, int baud);
+
+/**************************************************************************************
+ * * FunctionName   : nmea_local_close()
+ * * Description    : 关闭本地NMEA数据源
+ * * EntryParameter : fd,数据源句柄
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void nmea_local_close(int fd);
+
+#endif /* _NMEA_LOCAL_H_ */
@@ -0,0 +1,25 @@
+#ifndef _NMEA_SCAN_H_
+#define _NMEA_SCAN_H_
+
+#include <stdint.h>
+
+/**************************************************************************************
+* Description    : 扫描出的NMEA报文位置
+**************************************************************************************/
+struct nmea_span {
+	uint16_t offset;                           // '$'在缓冲区中的偏移
+	uint16_t len;                              // 报文长度, 包含'$'和校验码, 不包含回车换行
+	uint8_t valid;                             // 校验正确且全部为可打印字符(无校验码的报文不检查校验)
+};
+
+/**************************************************************************************
+* FunctionName   : nmea_scan()
+* Description    : 按16/32字节块向量化查找'$'、'*'和回车换行, 同一遍扫描中计算校验,
+*                  报文中有0x20~0x7e以外的字节时无效(与逐字节解析一致)
+* EntryParameter : data,NMEA数据, len,数据长度, spans,输出报文位置, max,spans个数
+*                  consumed,输出已扫描完的长度(末尾不完整报文的'$'偏移, 或len)
+* ReturnValue    : 返回找到的完整报文个数
+**************************************************************************************/
+int nmea_scan(const uint8_t *data, int len, struct nmea_span *spans, int max, int *consumed);
+
+#endif /* _NMEA_SCAN_H_ */
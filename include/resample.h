@@ -0,0 +1,70 @@
+#ifndef _RESAMPLE_H_
+#define _RESAMPLE_H_
+
+#include <stdint.h>
+
+/**************************************************************************************
+* Description    : 采样率转换参数
+*                  每个相位RESAMPLE_TAPS个系数, 延迟RESAMPLE_TAPS/2个输入采样(8k时4ms)
+**************************************************************************************/
+#define RESAMPLE_TAPS                   64           // 每个相位的系数个数, 8的倍数
+#define RESAMPLE_CUTOFF                 0.9          // 截止频率相对于较低采样率奈奎斯特频率的比例
+
+/**************************************************************************************
+* Description    : 多相FIR采样率转换, 输出率/输入率 = up/down(约分后)
+*                  按固定时长的帧处理, 每帧输入in_samples个采样, 输出out_samples个采样,
+*                  帧边界上相位对齐, 只需要保留上一帧末尾的RESAMPLE_TAPS-1个采样
+**************************************************************************************/
+struct resampler {
+	int in_samples;                           // 每帧输入采样数
+	int out_samples;                          // 每帧输出采样数
+	int up;                                   // 插值倍数(相位数)
+	int down;                                 // 抽取倍数
+	int16_t *coef;                            // Q15系数, up个相位, 每个相位倒序存放, 采样率相同时为NULL
+	int16_t *hist;                            // RESAMPLE_TAPS-1个历史采样和一帧输入
+};
+
+/**************************************************************************************
+ * * FunctionName   : resampler_init()
+ * * Description    : 初始化采样率转换, 按加Blackman窗的sinc生成各相位系数, 运行中不再分配内存
+ * * EntryParameter : rs,采样率转换, in_rate,输入采样率, out_rate,输出采样率, frame_ms,帧长(ms)
+ * * ReturnValue    : 成功返回0, 失败返回-1
+ * **************************************************************************************/
+int resampler_init(struct resampler *rs, int in_rate, int out_rate, int frame_ms);
+
+/**************************************************************************************
+ * * FunctionName   : resampler_free()
+ * * Description    : 释放采样率转换
+ * * EntryParameter : rs,采样率转换
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void resampler_free(struct resampler *rs);
+
+/**************************************************************************************
+ * * FunctionName   : resampler_reset()
+ * * Description    : 清除历史采样, 新的一段语音开始时调用
+ * * EntryParameter : rs,采样率转换
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void resampler_reset(struct resampler *rs);
+
+/**************************************************************************************
+ * * FunctionName   : resampler_process()
+ * * Description    : 转换一帧, 采样率相同时直接复制
+ * * EntryParameter : rs,采样率转换, in,in_samples个输入采样, out,out_samples个输出采样
+ * * ReturnValue    : 返回输出采样数
+ * **************************************************************************************/
+int resampler_process(struct resampler *rs, const int16_t *in, int16_t *out);
+
+/**************************************************************************************
+ * * FunctionName   : resampler_active()
+ * * Description    : 是否需要转换(输入输出采样率不同)
+ * * EntryParameter : rs,采样率转换
+ * * ReturnValue    : 返回1表示需要转换
+ * **************************************************************************************/
+static inline int resampler_active(const struct resampler *rs)
+{
+	return rs->coef != NULL;
+}
+
+#endif /* _RESAMPLE_H_ */
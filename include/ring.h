@@ -0,0 +1,119 @@
+#ifndef _RING_H_
+#define _RING_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+/**************************************************************************************
+* Description    : 单生产者单消费者无锁环形队列, 槽位大小固定, 初始化时一次分配
+*                  head只由生产者写, tail只由消费者写, 分别放在不同的cache行
+**************************************************************************************/
+struct ring {
+	unsigned int count;                       // 槽位个数, 2的幂
+	unsigned int mask;                        // 槽位序号掩码
+	unsigned int slot;                        // 槽位大小(字节)
+	char *buf;                                // 槽位数据
+	unsigned int head __attribute__((aligned(64)));    // 生产者写入位置
+	unsigned int tail __attribute__((aligned(64)));    // 消费者读取位置
+};
+
+/**************************************************************************************
+* FunctionName   : ring_init()
+* Description    : 初始化环形队列, 槽位个数向上取整为2的幂
+* EntryParameter : r,环形队列, count,槽位个数, slot,槽位大小(字节)
+* ReturnValue    : 成功返回0, 失败返回-1
+**************************************************************************************/
+static inline int ring_init(struct ring *r, unsigned int count, unsigned int slot)
+{
+	unsigned int n = 1;
+
+	while (n < count) n <<= 1;
+
+	memset(r, 0, sizeof(struct ring));
+	r->buf = (char *)calloc(n, slot);
+	if (r->buf == NULL) return -1;
+
+	r->count = n;
+	r->mask = n - 1;
+	r->slot = slot;
+
+	return 0;
+}
+
+/**************************************************************************************
+* FunctionName   : ring_free()
+* Description    : 释放环形队列
+* EntryParameter : r,环形队列
+* ReturnValue    : None
+**************************************************************************************/
+static inline void ring_free(struct ring *r)
+{
+	free(r->buf);
+	r->buf = NULL;
+	r->count = 0;
+}
+
+/**************************************************************************************
+* FunctionName   : ring_used()
+* Description    : 获取队列中的数据个数, 两端都可以调用, 结果是调用时刻的近似值
+* EntryParameter : r,环形队列
+* ReturnValue    : 返回已写入未读取的槽位个数
+**************************************************************************************/
+static inline unsigned int ring_used(struct ring *r)
+{
+	return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+/**************************************************************************************
+* FunctionName   : ring_write_slot()
+* Description    : 生产者获取下一个可写槽位, 写完后调用ring_push()提交
+* EntryParameter : r,环形队列
+* ReturnValue    : 返回槽位指针, 队列满时返回NULL
+**************************************************************************************/
+static inline void *ring_write_slot(struct ring *r)
+{
+	unsigned int head = r->head;
+
+	if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= r->count) return NULL;
+
+	return r->buf + (size_t)(head & r->mask) * r->slot;
+}
+
+/**************************************************************************************
+* FunctionName   : ring_push()
+* Description    : 生产者提交ring_write_slot()获取的槽位
+* EntryParameter : r,环形队列
+* ReturnValue    : None
+**************************************************************************************/
+static inline void ring_push(struct ring *r)
+{
+	__atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+/**************************************************************************************
+* FunctionName   : ring_read_slot()
+* Description    : 消费者获取最早写入的槽位, 用完后调用ring_pop()释放
+* EntryParameter : r,环形队列
+* ReturnValue    : 返回槽位指针, 队列空时返回NULL
+**************************************************************************************/
+static inline void *ring_read_slot(struct ring *r)
+{
+	unsigned int tail = r->tail;
+
+	if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail) return NULL;
+
+	return r->buf + (size_t)(tail & r->mask) * r->slot;
+}
+
+/**************************************************************************************
+* FunctionName   : ring_pop()
+* Description    : 消费者释放ring_read_slot()获取的槽位
+* EntryParameter : r,环形队列
+* ReturnValue    : None
+**************************************************************************************/
+static inline void ring_pop(struct ring *r)
+{
+	__atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* _RING_H_ */
@@ -0,0 +1,36 @@
+#ifndef _SOCKETCAN_H_
+#define _SOCKETCAN_H_
+
+#include <stdint.h>
+#include <linux/can.h>
+
+/**************************************************************************************
+* Description    : 单次批量发送的最大CAN帧数
+**************************************************************************************/
+#define SOCKETCAN_MAX_BATCH             64
+
+/**************************************************************************************
+ * * FunctionName   : socketcan_open()
+ * * Description    : 打开SocketCAN接口(只发送, 不接收)
+ * * EntryParameter : ifname,CAN接口名字(如can0, vcan0)
+ * * ReturnValue    : 返回套接字或者错误码
+ * **************************************************************************************/
+int socketcan_open(const char *ifname);
+
+/**************************************************************************************
+ * * FunctionName   : socketcan_send_batch()
+ * * Description    : 批量发送CAN帧, 一次系统调用发送多帧
+ * * EntryParameter : fd,CAN套接字, frames,指向CAN帧数组, n,帧个数
+ * * ReturnValue    : 返回成功发送的帧数或者错误码
+ * **************************************************************************************/
+int socketcan_send_batch(int fd, struct can_frame *frames, int n);
+
+/**************************************************************************************
+ * * FunctionName   : socketcan_close()
+ * * Description    : 关闭SocketCAN接口
+ * * EntryParameter : fd,CAN套接字
+ * * ReturnValue    : None
+ * **************************************************************************************/
+void socketcan_close(int fd);
+
+#endif /* _SOCKETCAN_H_ */
@@ -11,15 +11,29 @@
 #include <syslog.h>
 #include <execinfo.h>
 #include "serial.h"
+#include "config.h"
+#include "rtsched.h"
 #include "pbserial.h"
 
 #define LOG_TAG                         "pbserial" // 日志名字
 #define BUFFER_FIFO_SIZE                (2048*6)    // 缓存暂时没有收全的protobuf数据包
 #define BACKTRACE_SIZE                  100
+#define MAX_WATCH                       16          // 主循环最多监听的文件句柄个数
+
+/**************************************************************************************
+ * * Description    : 主循环监听的文件句柄
+ * **************************************************************************************/
+struct watch {
+	int fd;
+	watch_handler handler;
+	void *priv;
+};
 
 int _debug = 0;                           // 调试开关
 static int m_fd = -1;                           // 串口套接字
 static struct id_proto *id_list = NULL;         // 指向所有id列表
+static int n_watch = 0;                         // 监听的文件句柄个数
+static struct watch watches[MAX_WATCH];         // 监听的文件句柄
 
 /**************************************************************************************
  * * FunctionName   : chksum_xor()
@@ -59,13 +73,69 @@ int id_register(struct id_proto *id)
 	return 0;
 }
 
+/**************************************************************************************
+ * * FunctionName   : watch_add()
+ * * Description    : 在主循环中监听文件句柄, 可读时调用回调, 与串口数据在同一线程处理
+ * * EntryParameter : fd,文件句柄, handler,可读回调, priv,回调私有数据
+ * * ReturnValue    : 返回0或者错误码
+ * **************************************************************************************/
+int watch_add(int fd, watch_handler handler, void *priv)
+{
+	if (unlikely(fd < 0 || fd >= FD_SETSIZE || handler == NULL)) return -EINVAL;
+	if (unlikely(n_watch >= MAX_WATCH)) return -ENOSPC;
+
+	watches[n_watch].fd = fd;
+	watches[n_watch].handler = handler;
+	watches[n_watch].priv = priv;
+	n_watch++;
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : watch_del()
+ * * Description    : 取消监听文件句柄
+ * * EntryParameter : fd,文件句柄
+ * * ReturnValue    : 返回0或者错误码
+ * **************************************************************************************/
+int watch_del(int fd)
+{
+	int i;
+
+	for (i = 0; i < n_watch; i++) {
+		if (watches[i].fd != fd) continue;
+		watches[i] = watches[--n_watch];
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+/**************************************************************************************
+ * * FunctionName   : watch_dispatch()
+ * * Description    : 处理可读的监听句柄
+ * * EntryParameter : readfds,select返回的可读句柄
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void watch_dispatch(fd_set *readfds)
+{
+	int i;
+
+	// 倒序遍历，回调中删除自己不影响未处理的句柄
+	for (i = n_watch - 1; i >= 0; i--) {
+		if (i < n_watch && FD_ISSET(watches[i].fd, readfds)) {
+			watches[i].handler(watches[i].fd, watches[i].priv);
+		}
+	}
+}
+
 /**************************************************************************************
  * * FunctionName   : iddata_send()
  * * Description    : 将通信数据传送给对应ID处理函数
- * * EntryParameter : fd, 串口句柄， id,指向id,data,id将要处理的数据，len，数据长度
+ * * EntryParameter : fd, 串口句柄， id,指向id,data,id将要处理的数据，len，数据长度, rx_us,接收时间
  * * ReturnValue    : 返回0
  * **************************************************************************************/
-static int iddata_send(int fd, uint8_t id, char *data, int len)
+static int iddata_send(int fd, uint8_t id, char *data, int len, uint64_t rx_us)
 {
 	struct id_proto *proto = id_list;
 
@@ -76,7 +146,7 @@ static int iddata_send(int fd, uint8_t id, char *data, int len)
 		}
 
 		// 对应ID处理数据
-		return proto->handler(fd, data, len);
+		return proto->handler(fd, data, len, rx_us);
 	}
 	DEBUG("%d not registered\n", id)
 	return -1;
@@ -85,10 +155,10 @@ static int iddata_send(int fd, uint8_t id, char *data, int len)
 /**************************************************************************************
  * * FunctionName   : do_packages()
  * * Description    : modem接收数据处理
- * * EntryParameter : data，指向MPU发送的数据， len,指向MPU发送数据长度
+ * * EntryParameter : data，指向MPU发送的数据， len,指向MPU发送数据长度, rx_us,串口数据接收时间
  * * ReturnValue    : 返回None
  * **************************************************************************************/
-static int do_packages(int fd, char *data, int len)
+static int do_packages(int fd, char *data, int len, uint64_t rx_us)
 {
 	uint8_t id = 0;
     int32_t pos = 0;
@@ -127,7 +197,8 @@ static int do_packages(int fd, char *data, int len)
 		// 数据校验可靠性检测， 错误就重新尝试
 		if(tdata->csum == chksum_xor((uint8_t *)tdata->data, length)) {
 			//DEBUG("recv %d length:%d\n", id, length)
-			iddata_send(fd, id, (char *)tdata->data, length);
+			// 数据包在本次读取时收全，使用本次的接收时间
+			iddata_send(fd, id, (char *)tdata->data, length, rx_us);
 		} else {
 			syslog(LOG_ERR,"recv data(%d) chksum fail !!!\n", id, length);
 		}
@@ -150,26 +221,42 @@ static int do_packages(int fd, char *data, int len)
  * ************************************************************************************/
 int packages_send(int fd, uint8_t id, char *data, int len)
 {
-	int32_t tdata_len = 0;
 	struct transport *tdata = NULL;
 
-	// 1.打包protobuf数据头部
-	tdata_len = sizeof(struct transport) + len;
-	tdata = (struct transport *)malloc(tdata_len);
+	// 1.分配传输头部和数据
+	tdata = (struct transport *)malloc(sizeof(struct transport) + len);
 	if(unlikely(tdata == NULL)) return -ENOMEM;
 
-	// 2.初始化头部数据结构
-	pack_be8(id, &tdata->id);
-	pack_be32(len, &tdata->length);
-	pack_be32(TRANS_MAGIC, &tdata->magic);
-
+	// 2.复制数据后发送
 	memcpy(tdata->data, data, len);
+	len = packages_send_inplace(fd, id, tdata, len);
+
+	free(tdata);
+	return len;
+}
+
+/**************************************************************************************
+ * * FunctionName   : packages_send_inplace()
+ * * Description    : MCU发送数据到MPU, 数据已经存放在tdata->data中, 只填写传输头部, 不分配不复制
+ * * EntryParameter : fd,串口句柄, id,数据ID, tdata,传输头部及之后的数据, len,数据长度
+ * * ReturnValue    : 返回发送状态或者长度
+ * ************************************************************************************/
+int packages_send_inplace(int fd, uint8_t id, struct transport *tdata, int len)
+{
+	uint32_t magic, length;
+
+	// 1.初始化头部数据结构, 原地发送时头部地址不一定4字节对齐, 32位字段按字节复制
+	pack_be32(TRANS_MAGIC, &magic);
+	pack_be32(len, &length);
+	memcpy(&tdata->magic, &magic, sizeof(magic));
+	memcpy(&tdata->length, &length, sizeof(length));
+	pack_be8(id, &tdata->id);
 	tdata->csum = chksum_xor((uint8_t *)tdata->data, len);
-	// 3.发送数据到串口
-	serial_write(fd, (char *)tdata, tdata_len);
+
+	// 2.发送数据到串口
+	serial_write(fd, (char *)tdata, sizeof(struct transport) + len);
 	//DEBUG("ID%d send data length:%d\n", id, len)
 
-	free(tdata);
 	return len;
 }
 
@@ -280,7 +367,7 @@ static void setup_protoid(int fd)
  * ************************************************************************************/
 static void usage(const char *app)
 {
-	fprintf(stderr, "Usage: %s -d device [-b 115200/9600] [-v] [-D]\n", app);
+	fprintf(stderr, "Usage: %s -d device [-b 115200/9600] [-f config] [-v] [-D]\n", app);
 	exit(0);
 }
 
@@ -292,21 +379,26 @@ static void usage(const char *app)
  * ************************************************************************************/
 int main(int argc, char *argv[])
 {
-	int opt;
-	int fd = 0;
+	int i, opt;
+	int fd = 0, maxfd;
 	size_t len = 0;
 	fd_set readfds;
+	uint64_t rx_us;
 	char buffer[1024];
 	int baud = 115200;
 	int daemonize = 0;
 	char *device = NULL;
+	char *config = CONFIG_DEFAULT_FILE;
 
 	// 1.解析命令行参数
-	while (-1 != (opt = getopt(argc, argv, "d:b:vD"))) {
+	while (-1 != (opt = getopt(argc, argv, "d:b:f:vD"))) {
 		switch (opt) {
 			case 'd':
 				device = optarg;
 				break;
+			case 'f':
+				config = optarg;
+				break;
 			case 'v':
 				_debug = 1;
 				break;
@@ -340,8 +432,12 @@ int main(int argc, char *argv[])
 	// 4.打开日志
 	openlog(LOG_TAG, LOG_CONS, LOG_DAEMON);
 
-	// 5.安装信号接收函数
+	// 5.安装信号接收函数, 加载配置
 	setup_signals();
+	config_load(config);
+
+	// 锁定内存, 之后的分配和创建的线程继承锁定
+	sched_setup();
 
 	// 6.初始化串口
 	fd = device_init(device, baud);
@@ -353,22 +449,37 @@ int main(int argc, char *argv[])
 	// 7.初始化各ID
 	setup_protoid(fd);
 
+	// 各ID的线程(包括电子地图引擎的线程)创建之后再设置RX线程(串口接收和电子地图事件循环)的调度,
+	// 引擎线程保持创建时的普通调度和亲和性
+	sched_apply("rx");
+
 	// 8.任务处理
 	m_fd = fd;
 	for (;;) {
 		FD_ZERO(&readfds);
 		FD_SET(fd, &readfds);
+		maxfd = fd;
+		for (i = 0; i < n_watch; i++) {
+			FD_SET(watches[i].fd, &readfds);
+			if (watches[i].fd > maxfd) maxfd = watches[i].fd;
+		}
 
 		// 检测是否有数据读
-		if(unlikely(select(fd+1, &readfds, NULL, NULL, NULL) < 0)) {
+		if(unlikely(select(maxfd+1, &readfds, NULL, NULL, NULL) < 0)) {
+			if (errno == EINTR) continue;
 			break;
 		}
+		rx_us = monotonic_us();
+		// 处理定时器等其他句柄
+		watch_dispatch(&readfds);
+		if (!FD_ISSET(fd, &readfds)) continue;
+
 		// 读取数据
 		memset(buffer, 0, 1024);
 		len = serial_read(fd, buffer, 1024);
 		if(unlikely(len <= 0)) continue;
 		// 处理数据
-		do_packages(fd, buffer, len);
+		do_packages(fd, buffer, len, rx_us);
 	}
 	// 9.关闭
 	close(fd);
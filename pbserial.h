@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <syslog.h>
+#include <time.h>
 
 /**************************************************************************************
 * Description    : 字节交换函数
@@ -26,10 +27,10 @@
 #define TRANS_MAGIC         0x55443322
 
 /**************************************************************************************
- * * Description    : 定义协议处理回调
+ * * Description    : 定义协议处理回调, handler_t最后一个参数为数据接收时间(monotonic_us)
  * **************************************************************************************/
 typedef int (*id_handler)(int);
-typedef int (*handler_t)(int, char *,int);
+typedef int (*handler_t)(int, char *,int, uint64_t);
 
 /**************************************************************************************
  * * Description    : 协议链表定义
@@ -180,6 +181,29 @@ static inline int8_t pack_le64(const uint64_t src, uint64_t *dst)
     return sizeof(uint64_t);
 }
 
+/**************************************************************************************
+* FunctionName   : pack_varint()
+* Description    : protobuf varint格式打包, 用于在缓冲区中直接生成protobuf头部
+* EntryParameter : src,原始数据, *dst,目标数据指针(最多PB_VARINT_MAX字节)
+* Returnsrcue    : 返回打包后数据长度
+**************************************************************************************/
+#define PB_VARINT_MAX                   5            // 32位varint最大长度
+#define PB_WIRE_VARINT                  0            // varint字段
+#define PB_WIRE_BYTES                   2            // 长度+数据字段(bytes/string/message)
+#define PB_KEY(field, wire)             ((uint8_t)((field) << 3 | (wire)))   // 字段号小于16时为1字节
+static inline int8_t pack_varint(uint32_t src, uint8_t *dst)
+{
+    int8_t n = 0;
+
+    while (src >= 0x80) {
+        dst[n++] = (uint8_t)(src | 0x80);
+        src >>= 7;
+    }
+    dst[n++] = (uint8_t)src;
+
+    return n;
+}
+
 /**************************************************************************************
 * FunctionName   : unpack_be8()
 * Description    : 8位大端格式解包
@@ -320,6 +344,41 @@ static inline int8_t unpack_le64(const uint64_t src, uint64_t *dst)
 	(void *)p;                   \
 })
 
+/**************************************************************************************
+ * * FunctionName   : monotonic_us()
+ * * Description    : 获取单调时钟时间, 用于接收时间戳和延迟统计
+ * * EntryParameter : None
+ * * ReturnValue    : 返回微秒数
+ * **************************************************************************************/
+static inline uint64_t monotonic_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**************************************************************************************
+ * * Description    : 主循环中监听的文件句柄回调(定时器、本地数据源等)
+ * **************************************************************************************/
+typedef int (*watch_handler)(int fd, void *priv);
+
+/**************************************************************************************
+ * * FunctionName   : watch_add()
+ * * Description    : 在主循环中监听文件句柄, 可读时调用回调, 与串口数据在同一线程处理
+ * * EntryParameter : fd,文件句柄, handler,可读回调, priv,回调私有数据
+ * * ReturnValue    : 返回0或者错误码
+ * **************************************************************************************/
+int watch_add(int fd, watch_handler handler, void *priv);
+
+/**************************************************************************************
+ * * FunctionName   : watch_del()
+ * * Description    : 取消监听文件句柄
+ * * EntryParameter : fd,文件句柄
+ * * ReturnValue    : 返回0或者错误码
+ * **************************************************************************************/
+int watch_del(int fd);
+
 /**************************************************************************************
  * * FunctionName   : id_register()
  * * Description    : 注册通信数据ID
@@ -336,6 +395,14 @@ int id_register(struct id_proto *id);
  * ************************************************************************************/
 int packages_send(int fd, uint8_t id, char *data, int len);
 
+/**************************************************************************************
+ * * FunctionName   : packages_send_inplace()
+ * * Description    : MCU发送数据到MPU, 数据已经存放在tdata->data中, 只填写传输头部, 不分配不复制
+ * * EntryParameter : fd,串口句柄, id,数据ID, tdata,传输头部及之后的数据, len,数据长度
+ * * ReturnValue    : 返回发送状态或者长度
+ * ************************************************************************************/
+int packages_send_inplace(int fd, uint8_t id, struct transport *tdata, int len);
+
 /**************************************************************************************
 * Description    : 定义协议注册函数
 **************************************************************************************/
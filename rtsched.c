@@ -0,0 +1,187 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <sys/mman.h>
+#include "config.h"
+#include "rtsched.h"
+
+/**************************************************************************************
+* Description    : 进程内存是否已锁定
+**************************************************************************************/
+static int locked = 0;
+
+/**************************************************************************************
+ * * FunctionName   : sched_parse_cpus()
+ * * Description    : 解析CPU列表, 如"3", "2-3", "0,2"
+ * * EntryParameter : s,CPU列表, set,输出CPU集合
+ * * ReturnValue    : 成功返回0, 格式错误或者为空返回-1
+ * **************************************************************************************/
+static int sched_parse_cpus(const char *s, cpu_set_t *set)
+{
+	char *end;
+	long from, to;
+
+	CPU_ZERO(set);
+	while (*s) {
+		from = strtol(s, &end, 10);
+		if (end == s || from < 0 || from >= CPU_SETSIZE) return -1;
+		to = from;
+		if (*end == '-') {
+			s = end + 1;
+			to = strtol(s, &end, 10);
+			if (end == s || to < from || to >= CPU_SETSIZE) return -1;
+		}
+		for (; from <= to; from++) CPU_SET(from, set);
+
+		s = end;
+		while (*s == ',' || *s == ' ') s++;
+	}
+
+	return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+/**************************************************************************************
+ * * FunctionName   : sched_format_cpus()
+ * * Description    : CPU集合格式化为列表
+ * * EntryParameter : set,CPU集合, buf,输出缓冲, size,缓冲大小
+ * * ReturnValue    : 返回buf
+ * **************************************************************************************/
+static char *sched_format_cpus(cpu_set_t *set, char *buf, int size)
+{
+	int cpu, len = 0;
+
+	buf[0] = '\0';
+	for (cpu = 0; cpu < CPU_SETSIZE && len < size; cpu++) {
+		if (!CPU_ISSET(cpu, set)) continue;
+		len += snprintf(buf + len, size - len, "%s%d", len ? "," : "", cpu);
+	}
+
+	return buf;
+}
+
+/**************************************************************************************
+ * * FunctionName   : sched_prefault()
+ * * Description    : 逐页访问栈空间, 锁定内存后栈增长不再产生缺页
+ * * EntryParameter : kb,访问的栈大小
+ * * ReturnValue    : None
+ * **************************************************************************************/
+static void __attribute__((noinline)) sched_prefault(int kb)
+{
+	int i;
+	char stack[kb * 1024];
+	volatile char *p = stack;
+
+	for (i = 0; i < kb * 1024; i += 4096) p[i] = 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : sched_setup()
+ * * Description    : 按[SCHED]配置锁定进程内存(mlockall), 在config_load()之后创建线程之前调用
+ * * EntryParameter : None
+ * * ReturnValue    : 成功返回0, 失败返回-1(继续运行, 不锁定内存)
+ * **************************************************************************************/
+int sched_setup(void)
+{
+	if (!config_get_int("SCHED", "mlock", 0)) return 0;
+
+#ifdef MCL_ONFAULT
+	// 只锁定已经访问过的页, 电子地图引擎未使用的线程栈和地图数据映射不锁定(Linux 4.4以上)
+	if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0) {
+		locked = 1;
+		return 0;
+	}
+#endif
+	// 内核不支持MCL_ONFAULT时锁定全部映射, 包括电子地图引擎的线程栈(每个8M)
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		syslog(LOG_WARNING, "sched mlockall failed: %s\n", strerror(errno));
+		return -1;
+	}
+	syslog(LOG_NOTICE, "sched mlockall without MCL_ONFAULT, all mappings locked\n");
+	locked = 1;
+
+	return 0;
+}
+
+/**************************************************************************************
+ * * FunctionName   : sched_thread_attr()
+ * * Description    : 初始化线程属性, 锁定内存时使用较小的栈, 避免每个线程锁定8M缺省栈
+ * * EntryParameter : attr,线程属性
+ * * ReturnValue    : 返回attr
+ * **************************************************************************************/
+pthread_attr_t *sched_thread_attr(pthread_attr_t *attr)
+{
+	struct sched_param param;
+
+	// 不继承创建线程的调度, 新线程为SCHED_OTHER, 由线程入口的sched_apply()按角色设置
+	memset(&param, 0, sizeof(param));
+	pthread_attr_init(attr);
+	pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(attr, SCHED_OTHER);
+	pthread_attr_setschedparam(attr, &param);
+	if (locked) {
+		pthread_attr_setstacksize(attr, config_get_int("SCHED", "stack_kb", SCHED_STACK_KB) * 1024);
+	}
+
+	return attr;
+}
+
+/**************************************************************************************
+ * * FunctionName   : sched_apply()
+ * * Description    : 按[SCHED]中<name>_priority和<name>_cpus设置当前线程的调度策略和CPU亲和性,
+ *                    预先访问线程栈, 并输出实际生效的设置, 在线程入口调用
+ * * EntryParameter : name,线程角色(rx/audio/dsp/tx)
+ * * ReturnValue    : 全部设置成功返回0, 否则返回-1(保持原有调度继续运行)
+ * **************************************************************************************/
+int sched_apply(const char *name)
+{
+	int ret = 0, err, policy, prio;
+	char key[32], cpus[64];
+	const char *list;
+	cpu_set_t set;
+	struct sched_param param;
+
+	// 1.优先级1~99使用SCHED_FIFO, 0不修改(sched_thread_attr()创建的线程为SCHED_OTHER)
+	snprintf(key, sizeof(key), "%s_priority", name);
+	prio = config_get_int("SCHED", key, 0);
+	if (prio > 0) {
+		if (prio < sched_get_priority_min(SCHED_FIFO)) prio = sched_get_priority_min(SCHED_FIFO);
+		if (prio > sched_get_priority_max(SCHED_FIFO)) prio = sched_get_priority_max(SCHED_FIFO);
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = prio;
+		err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (err != 0) {
+			syslog(LOG_WARNING, "sched %s SCHED_FIFO %d failed: %s\n", name, prio, strerror(err));
+			ret = -1;
+		}
+	}
+
+	// 2.CPU亲和性, 不配置时不修改
+	snprintf(key, sizeof(key), "%s_cpus", name);
+	list = config_get_string("SCHED", key, "");
+	if (*list) {
+		if (sched_parse_cpus(list, &set) < 0) {
+			syslog(LOG_ERR, "sched %s invalid cpus '%s'\n", name, list);
+			ret = -1;
+		} else if ((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0) {
+			syslog(LOG_WARNING, "sched %s cpus %s failed: %s\n", name, list, strerror(err));
+			ret = -1;
+		}
+	}
+
+	// 3.锁定内存时预先访问一半的线程栈, 另一半留给调用栈
+	if (locked) sched_prefault(config_get_int("SCHED", "stack_kb", SCHED_STACK_KB) / 2);
+
+	// 4.输出实际生效的设置
+	pthread_getschedparam(pthread_self(), &policy, &param);
+	CPU_ZERO(&set);
+	pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+	syslog(LOG_NOTICE, "sched %s: %s priority %d, cpus %s, memory %s\n", name,
+			policy == SCHED_FIFO ? "SCHED_FIFO" : policy == SCHED_RR ? "SCHED_RR" : "SCHED_OTHER",
+			param.sched_priority, sched_format_cpus(&set, cpus, sizeof(cpus)), locked ? "locked" : "unlocked");
+
+	return ret;
+}
@@ -0,0 +1,39 @@
+#ifndef _RTSCHED_H_
+#define _RTSCHED_H_
+
+#include <pthread.h>
+#include "pbserial.h"
+
+/**************************************************************************************
+* Description    : 线程调度缺省参数
+**************************************************************************************/
+#define SCHED_STACK_KB                  256          // 锁定内存时线程栈大小, 线程入口预先访问一半
+
+/**************************************************************************************
+ * * FunctionName   : sched_setup()
+ * * Description    : 按[SCHED]配置锁定进程内存(mlockall), 在config_load()之后创建线程之前调用,
+ *                    内核支持时使用MCL_ONFAULT, 只锁定访问过的页
+ * * EntryParameter : None
+ * * ReturnValue    : 成功返回0, 失败返回-1(继续运行, 不锁定内存)
+ * **************************************************************************************/
+int sched_setup(void);
+
+/**************************************************************************************
+ * * FunctionName   : sched_thread_attr()
+ * * Description    : 初始化线程属性, 新线程为SCHED_OTHER(不继承rx线程的实时调度),
+ *                    锁定内存时使用较小的栈, 避免每个线程锁定8M缺省栈
+ * * EntryParameter : attr,线程属性
+ * * ReturnValue    : 返回attr
+ * **************************************************************************************/
+pthread_attr_t *sched_thread_attr(pthread_attr_t *attr);
+
+/**************************************************************************************
+ * * FunctionName   : sched_apply()
+ * * Description    : 按[SCHED]中<name>_priority和<name>_cpus设置当前线程的调度策略和CPU亲和性,
+ *                    预先访问线程栈, 并输出实际生效的设置, 在线程入口调用
+ * * EntryParameter : name,线程角色(rx/audio/dsp/tx)
+ * * ReturnValue    : 全部设置成功返回0, 否则返回-1(保持原有调度继续运行)
+ * **************************************************************************************/
+int sched_apply(const char *name);
+
+#endif /* _RTSCHED_H_ */
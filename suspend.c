@@ -17,10 +17,10 @@ static int handle_suspend_data(int fd)
 /**************************************************************************************
  * * FunctionName   : suspend_handler()
  * * Description    : suspend数据处理函数
- * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度
+ * * EntryParameter : fd, 串口句柄， data，指向数据， len,数据长度, rx_us,接收时间
  * * ReturnValue    : 返回错误码
  * **************************************************************************************/
-static int suspend_handler(int fd, char *data, int len)
+static int suspend_handler(int fd, char *data, int len, uint64_t rx_us)
 {
 	Subid *msg = NULL;
 